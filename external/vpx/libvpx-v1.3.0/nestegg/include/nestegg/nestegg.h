@@ -110,6 +110,16 @@ typedef struct {
 
   /** User supplied pointer to be passed to the IO callbacks. */
   void * userdata;
+
+  /** Optional zero-copy read callback, may be NULL.
+      @param length   Number of bytes to read.
+      @param userdata The #userdata supplied by the user.
+      @returns Pointer to the next @a length bytes of the stream, the
+               position advances past them.  The memory must stay valid
+               until the context and all its packets are destroyed.
+      @retval NULL Data not available, the position is unchanged and
+                   nestegg falls back to #read. */
+  unsigned char const * (* view)(size_t length, void * userdata);
 } nestegg_io;
 
 /** Parameters specific to a video track. */
@@ -181,6 +191,28 @@ int nestegg_track_count(nestegg * context, unsigned int * tracks);
     @retval -1 Error. */
 int nestegg_track_seek(nestegg * context, unsigned int track, uint64_t tstamp);
 
+/** Seek to the Cluster element starting at @a offset.  Reading continues
+    with the first block of that cluster.
+    @param context Stream context initialized by #nestegg_init.
+    @param offset  Absolute file offset of the Cluster element, e.g. from
+                   #nestegg_packet_cluster_offset or #nestegg_get_cue_point.
+    @retval  0 Success.
+    @retval -1 Error. */
+int nestegg_offset_seek(nestegg * context, uint64_t offset);
+
+/** Query the cue point at @a index, loading the Cues element if needed.
+    @param context        Stream context initialized by #nestegg_init.
+    @param track          Zero based track number.
+    @param index          Zero based index of the cue point.
+    @param tstamp         Storage for the timestamp in nanoseconds.
+    @param cluster_offset Storage for the absolute file offset of the
+                          cluster that holds the cued block of @a track.
+    @retval  0 Success.
+    @retval  1 The cue point has no position for @a track.
+    @retval -1 Error, no Cues or @a index out of range. */
+int nestegg_get_cue_point(nestegg * context, unsigned int track, unsigned int index,
+                          uint64_t * tstamp, uint64_t * cluster_offset);
+
 /** Query the type specified by @a track.
     @param context Stream context initialized by #nestegg_init.
     @param track   Zero based track number.
@@ -268,6 +300,30 @@ int nestegg_packet_track(nestegg_packet * packet, unsigned int * track);
     @retval -1 Error. */
 int nestegg_packet_tstamp(nestegg_packet * packet, uint64_t * tstamp);
 
+/** Query the absolute file offset of the Cluster element holding @a packet.
+    @param packet Packet initialized by #nestegg_read_packet.
+    @param offset Storage for the queried offset.
+    @retval  0 Success.
+    @retval -1 Error. */
+int nestegg_packet_cluster_offset(nestegg_packet * packet, uint64_t * offset);
+
+/** Query the absolute file offset and size of the Block or SimpleBlock
+    element holding @a packet, including the element header.
+    @param packet Packet initialized by #nestegg_read_packet.
+    @param offset Storage for the queried offset.
+    @param length Storage for the queried size in bytes.
+    @retval  0 Success.
+    @retval -1 Error. */
+int nestegg_packet_offset(nestegg_packet * packet, uint64_t * offset, uint64_t * length);
+
+/** Query the absolute file offset of chunk number @a item of packet data.
+    @param packet Packet initialized by #nestegg_read_packet.
+    @param item   Zero based chunk item number.
+    @param offset Storage for the queried offset.
+    @retval  0 Success.
+    @retval -1 Error. */
+int nestegg_packet_data_offset(nestegg_packet * packet, unsigned int item, uint64_t * offset);
+
 /** Query the number of data chunks contained in @a packet.
     @param packet Packet initialized by #nestegg_read_packet.
     @param count  Storage for the queried timestamp in nanoseconds.
@@ -274,11 +274,14 @@ struct saved_state {
   struct list_node * ancestor;
   uint64_t last_id;
   uint64_t last_size;
+  int64_t last_offset;
 };
 
 struct frame {
   unsigned char * data;
   size_t length;
+  int64_t offset; /* file offset of data */
+  int borrowed; /* data points into memory owned by io->view */
   struct frame * next;
 };
 
@@ -294,11 +297,16 @@ struct nestegg {
   struct segment segment;
   int64_t segment_offset;
   unsigned int track_count;
+  int64_t last_offset;    /* file offset of the last peeked element */
+  int64_t cluster_offset; /* file offset of the current cluster element */
 };
 
 struct nestegg_packet {
   uint64_t track;
   uint64_t timecode;
+  int64_t cluster_offset;
+  int64_t offset; /* file offset of the block element */
+  uint64_t length; /* size of the block element including its header */
   struct frame * frame;
 };
 
@@ -513,6 +521,9 @@ ne_io_read_skip(nestegg_io * io, size_t length)
   unsigned char buf[8192];
   int r = 1;
 
+  if (io->view && io->view(length, io->userdata))
+    return 1;
+
   while (length > 0) {
     get = length < sizeof(buf) ? length : sizeof(buf);
     r = ne_io_read(io, buf, get);
@@ -808,6 +819,7 @@ ne_ctx_save(nestegg * ctx, struct saved_state * s)
   s->ancestor = ctx->ancestor;
   s->last_id = ctx->last_id;
   s->last_size = ctx->last_size;
+  s->last_offset = ctx->last_offset;
   return 0;
 }
 
@@ -822,6 +834,7 @@ ne_ctx_restore(nestegg * ctx, struct saved_state * s)
   ctx->ancestor = s->ancestor;
   ctx->last_id = s->last_id;
   ctx->last_size = s->last_size;
+  ctx->last_offset = s->last_offset;
   return 0;
 }
 
@@ -838,6 +851,8 @@ ne_peek_element(nestegg * ctx, uint64_t * id, uint64_t * size)
     return 1;
   }
 
+  ctx->last_offset = ne_io_tell(ctx->io);
+
   r = ne_read_id(ctx->io, &ctx->last_id, NULL);
   if (r != 1)
     return r;
@@ -998,6 +1013,9 @@ ne_parse(nestegg * ctx, struct ebml_element_desc * top_level)
       if (r != 1)
         break;
 
+      if (id == ID_CLUSTER)
+        ctx->cluster_offset = ctx->last_offset;
+
       if (element->flags & DESC_FLAG_OFFSET) {
         data_offset = (int64_t *) (ctx->ancestor->data + element->data_offset);
         *data_offset = ne_io_tell(ctx->io);
@@ -1181,7 +1199,7 @@ static int
 ne_read_block(nestegg * ctx, uint64_t block_id, uint64_t block_size, nestegg_packet ** data)
 {
   int r;
-  int64_t timecode, abs_timecode;
+  int64_t timecode, abs_timecode, block_offset, data_offset;
   nestegg_packet * pkt;
   struct cluster * cluster;
   struct frame * f, * last;
@@ -1196,6 +1214,12 @@ ne_read_block(nestegg * ctx, uint64_t block_id, uint64_t block_size, nestegg_pac
   if (block_size > LIMIT_BLOCK)
     return -1;
 
+  /* the block element was peeked last, its payload starts here */
+  block_offset = ctx->last_offset;
+  data_offset = ne_io_tell(ctx->io);
+  if (block_offset < 0 || data_offset < block_offset)
+    return -1;
+
   r = ne_read_vint(ctx->io, &track, &length);
   if (r != 1)
     return r;
@@ -1293,6 +1317,9 @@ ne_read_block(nestegg * ctx, uint64_t block_id, uint64_t block_size, nestegg_pac
   pkt = ne_alloc(sizeof(*pkt));
   pkt->track = track - 1;
   pkt->timecode = (uint64_t)(abs_timecode * tc_scale * track_scale);
+  pkt->cluster_offset = ctx->cluster_offset;
+  pkt->offset = block_offset;
+  pkt->length = (uint64_t)(data_offset - block_offset) + block_size;
 
   ctx->log(ctx, NESTEGG_LOG_DEBUG, "%sblock t %lld pts %f f %llx frames: %llu",
            block_id == ID_BLOCK ? "" : "simple", pkt->track, pkt->timecode / 1e9, flags, frames);
@@ -1304,11 +1331,20 @@ ne_read_block(nestegg * ctx, uint64_t block_id, uint64_t block_size, nestegg_pac
       return -1;
     }
     f = ne_alloc(sizeof(*f));
-    f->data = ne_alloc(frame_sizes[i]);
     f->length = frame_sizes[i];
-    r = ne_io_read(ctx->io, f->data, frame_sizes[i]);
+    f->offset = ne_io_tell(ctx->io);
+    f->data = ctx->io->view ?
+      (unsigned char *) ctx->io->view(frame_sizes[i], ctx->io->userdata) : NULL;
+    if (f->data) {
+      f->borrowed = 1;
+      r = 1;
+    } else {
+      f->data = ne_alloc(frame_sizes[i]);
+      r = ne_io_read(ctx->io, f->data, frame_sizes[i]);
+    }
     if (r != 1) {
-      free(f->data);
+      if (!f->borrowed)
+        free(f->data);
       free(f);
       nestegg_free_packet(pkt);
       return -1;
@@ -1530,73 +1566,71 @@ nestegg_track_count(nestegg * ctx, unsigned int * tracks)
   return 0;
 }
 
-int
-nestegg_track_seek(nestegg * ctx, unsigned int track, uint64_t tstamp)
+static int
+ne_init_cue_points(nestegg * ctx)
 {
   int r;
-  struct cue_point * cue_point;
-  struct cue_track_positions * pos;
   struct saved_state state;
   struct seek * found;
-  uint64_t seek_pos, tc_scale, t, id;
-  struct ebml_list_node * node = ctx->segment.cues.cue_point.head;
+  uint64_t seek_pos, id;
 
   /* If there are no cues loaded, check for cues element in the seek head
      and load it. */
-  if (!node) {
-    found = ne_find_seek_for_id(ctx->segment.seek_head.head, ID_CUES);
-    if (!found)
-      return -1;
-
-    if (ne_get_uint(found->position, &seek_pos) != 0)
-      return -1;
+  if (ctx->segment.cues.cue_point.head)
+    return 0;
 
-    /* Save old parser state. */
-    r = ne_ctx_save(ctx, &state);
-    if (r != 0)
-      return -1;
+  found = ne_find_seek_for_id(ctx->segment.seek_head.head, ID_CUES);
+  if (!found)
+    return -1;
 
-    /* Seek and set up parser state for segment-level element (Cues). */
-    r = ne_io_seek(ctx->io, ctx->segment_offset + seek_pos, NESTEGG_SEEK_SET);
-    if (r != 0)
-      return -1;
-    ctx->last_id = 0;
-    ctx->last_size = 0;
+  if (ne_get_uint(found->position, &seek_pos) != 0)
+    return -1;
 
-    r = ne_read_element(ctx, &id, NULL);
-    if (r != 1)
-      return -1;
+  /* Save old parser state. */
+  r = ne_ctx_save(ctx, &state);
+  if (r != 0)
+    return -1;
 
-    if (id != ID_CUES)
-      return -1;
+  /* Seek and set up parser state for segment-level element (Cues). */
+  r = ne_io_seek(ctx->io, ctx->segment_offset + seek_pos, NESTEGG_SEEK_SET);
+  if (r != 0)
+    return -1;
+  ctx->last_id = 0;
+  ctx->last_size = 0;
 
-    ctx->ancestor = NULL;
-    ne_ctx_push(ctx, ne_top_level_elements, ctx);
-    ne_ctx_push(ctx, ne_segment_elements, &ctx->segment);
-    ne_ctx_push(ctx, ne_cues_elements, &ctx->segment.cues);
-    /* parser will run until end of cues element. */
-    ctx->log(ctx, NESTEGG_LOG_DEBUG, "seek: parsing cue elements");
-    r = ne_parse(ctx, ne_cues_elements);
-    while (ctx->ancestor)
-      ne_ctx_pop(ctx);
+  r = ne_read_element(ctx, &id, NULL);
+  if (r != 1)
+    return -1;
 
-    /* Reset parser state to original state and seek back to old position. */
-    if (ne_ctx_restore(ctx, &state) != 0)
-      return -1;
+  if (id != ID_CUES)
+    return -1;
 
-    if (r < 0)
-      return -1;
-  }
+  ctx->ancestor = NULL;
+  ne_ctx_push(ctx, ne_top_level_elements, ctx);
+  ne_ctx_push(ctx, ne_segment_elements, &ctx->segment);
+  ne_ctx_push(ctx, ne_cues_elements, &ctx->segment.cues);
+  /* parser will run until end of cues element. */
+  ctx->log(ctx, NESTEGG_LOG_DEBUG, "seek: parsing cue elements");
+  r = ne_parse(ctx, ne_cues_elements);
+  while (ctx->ancestor)
+    ne_ctx_pop(ctx);
 
-  tc_scale = ne_get_timecode_scale(ctx);
+  /* Reset parser state to original state and seek back to old position. */
+  if (ne_ctx_restore(ctx, &state) != 0)
+    return -1;
 
-  cue_point = ne_find_cue_point_for_tstamp(ctx->segment.cues.cue_point.head, tc_scale, tstamp);
-  if (!cue_point)
+  if (r < 0)
     return -1;
 
-  node = cue_point->cue_track_positions.head;
+  return ctx->segment.cues.cue_point.head ? 0 : -1;
+}
 
-  seek_pos = 0;
+static int
+ne_cue_cluster_offset(nestegg * ctx, struct cue_point * cue_point, unsigned int track, uint64_t * offset)
+{
+  struct cue_track_positions * pos;
+  uint64_t t, seek_pos;
+  struct ebml_list_node * node = cue_point->cue_track_positions.head;
 
   while (node) {
     assert(node->id == ID_CUE_TRACK_POSITIONS);
@@ -1604,13 +1638,22 @@ nestegg_track_seek(nestegg * ctx, unsigned int track, uint64_t tstamp)
     if (ne_get_uint(pos->track, &t) == 0 && t - 1 == track) {
       if (ne_get_uint(pos->cluster_position, &seek_pos) != 0)
         return -1;
-      break;
+      *offset = ctx->segment_offset + seek_pos;
+      return 0;
     }
     node = node->next;
   }
 
+  return -1;
+}
+
+static int
+ne_seek_cluster(nestegg * ctx, uint64_t offset)
+{
+  int r;
+
   /* Seek and set up parser state for segment-level element (Cluster). */
-  r = ne_io_seek(ctx->io, ctx->segment_offset + seek_pos, NESTEGG_SEEK_SET);
+  r = ne_io_seek(ctx->io, offset, NESTEGG_SEEK_SET);
   if (r != 0)
     return -1;
   ctx->last_id = 0;
@@ -1632,6 +1675,61 @@ nestegg_track_seek(nestegg * ctx, unsigned int track, uint64_t tstamp)
   return 0;
 }
 
+int
+nestegg_track_seek(nestegg * ctx, unsigned int track, uint64_t tstamp)
+{
+  struct cue_point * cue_point;
+  uint64_t seek_pos, tc_scale;
+
+  if (ne_init_cue_points(ctx) != 0)
+    return -1;
+
+  tc_scale = ne_get_timecode_scale(ctx);
+
+  cue_point = ne_find_cue_point_for_tstamp(ctx->segment.cues.cue_point.head, tc_scale, tstamp);
+  if (!cue_point)
+    return -1;
+
+  if (ne_cue_cluster_offset(ctx, cue_point, track, &seek_pos) != 0)
+    return -1;
+
+  return ne_seek_cluster(ctx, seek_pos);
+}
+
+int
+nestegg_offset_seek(nestegg * ctx, uint64_t offset)
+{
+  return ne_seek_cluster(ctx, offset);
+}
+
+int
+nestegg_get_cue_point(nestegg * ctx, unsigned int track, unsigned int index,
+                      uint64_t * tstamp, uint64_t * cluster_offset)
+{
+  struct cue_point * cue_point;
+  uint64_t time;
+  struct ebml_list_node * node;
+
+  if (ne_init_cue_points(ctx) != 0)
+    return -1;
+
+  node = ctx->segment.cues.cue_point.head;
+  while (node && index > 0) {
+    node = node->next;
+    index -= 1;
+  }
+  if (!node)
+    return -1;
+
+  assert(node->id == ID_CUE_POINT);
+  cue_point = node->data;
+  if (ne_get_uint(cue_point->time, &time) != 0)
+    return -1;
+  *tstamp = time * ne_get_timecode_scale(ctx);
+
+  return ne_cue_cluster_offset(ctx, cue_point, track, cluster_offset) == 0 ? 0 : 1;
+}
+
 int
 nestegg_track_type(nestegg * ctx, unsigned int track)
 {
@@ -1882,7 +1980,8 @@ nestegg_free_packet(nestegg_packet * pkt)
   while (pkt->frame) {
     frame = pkt->frame;
     pkt->frame = frame->next;
-    free(frame->data);
+    if (!frame->borrowed)
+      free(frame->data);
     free(frame);
   }
 
@@ -1903,6 +2002,45 @@ nestegg_packet_tstamp(nestegg_packet * pkt, uint64_t * tstamp)
   return 0;
 }
 
+int
+nestegg_packet_cluster_offset(nestegg_packet * pkt, uint64_t * offset)
+{
+  if (pkt->cluster_offset < 0)
+    return -1;
+  *offset = (uint64_t)pkt->cluster_offset;
+  return 0;
+}
+
+int
+nestegg_packet_offset(nestegg_packet * pkt, uint64_t * offset, uint64_t * length)
+{
+  if (pkt->offset < 0)
+    return -1;
+  *offset = (uint64_t)pkt->offset;
+  *length = pkt->length;
+  return 0;
+}
+
+int
+nestegg_packet_data_offset(nestegg_packet * pkt, unsigned int item, uint64_t * offset)
+{
+  struct frame * f = pkt->frame;
+  unsigned int count = 0;
+
+  while (f) {
+    if (count == item) {
+      if (f->offset < 0)
+        return -1;
+      *offset = (uint64_t)f->offset;
+      return 0;
+    }
+    count += 1;
+    f = f->next;
+  }
+
+  return -1;
+}
+
 int
 nestegg_packet_count(nestegg_packet * pkt, unsigned int * count)
 {
@@ -668,6 +668,67 @@ static vpx_codec_err_t get_frame_corrupted(vpx_codec_alg_priv_t *ctx,
   }
 }
 
+static vpx_codec_err_t get_block_info(vpx_codec_alg_priv_t *ctx,
+                                      int ctrl_id,
+                                      va_list args) {
+  vp9_block_info *info = va_arg(args, vp9_block_info *);
+  VP9D_COMP *pbi = (VP9D_COMP *)ctx->pbi;
+  const VP9_COMMON *cm;
+  MODE_INFO **grid;
+  const MODE_INFO *last = NULL;
+  unsigned char block_size = 0, modes = 0, ref_frames = 0, flags = 0;
+  uint32_t mv0 = 0, mv1 = 0;
+  int row, col, i = 0;
+
+  if (!info)
+    return VPX_CODEC_INVALID_PARAM;
+  if (!pbi)
+    return VPX_CODEC_ERROR;
+
+  cm = &pbi->common;
+  info->mi_rows = cm->mi_rows;
+  info->mi_cols = cm->mi_cols;
+  if (!info->block_size)
+    return VPX_CODEC_OK;
+  if (!info->modes || !info->ref_frames || !info->flags || !info->mvs ||
+      info->capacity < cm->mi_rows * cm->mi_cols)
+    return VPX_CODEC_INVALID_PARAM;
+
+  // a shown frame has swapped its mode info into prev_mi
+  grid = cm->last_show_frame ? cm->prev_mi_grid_visible : cm->mi_grid_visible;
+  for (row = 0; row < cm->mi_rows; ++row) {
+    MODE_INFO **const line = grid + row * cm->mode_info_stride;
+    for (col = 0; col < cm->mi_cols; ++col, ++i) {
+      const MODE_INFO *const mi = line[col];
+      if (!mi) {
+        // not decoded, e.g. after a corrupt tile
+        block_size = modes = ref_frames = flags = 0;
+        mv0 = mv1 = 0;
+        last = NULL;
+      } else if (mi != last) {
+        // larger blocks share one MODE_INFO, only convert it once
+        const MB_MODE_INFO *const mbmi = &mi->mbmi;
+        block_size = (unsigned char)mbmi->sb_type;
+        modes = (unsigned char)(mbmi->mode | (mbmi->uv_mode << 4));
+        ref_frames = (unsigned char)((mbmi->ref_frame[0] + 1) |
+                                     ((mbmi->ref_frame[1] + 1) << 4));
+        flags = (unsigned char)(mbmi->tx_size | (mbmi->skip_coeff << 2) |
+                                (mbmi->segment_id << 3));
+        mv0 = mbmi->mv[0].as_int;
+        mv1 = mbmi->mv[1].as_int;
+        last = mi;
+      }
+      info->block_size[i] = block_size;
+      info->modes[i] = modes;
+      info->ref_frames[i] = ref_frames;
+      info->flags[i] = flags;
+      memcpy(info->mvs + 4 * i, &mv0, sizeof(mv0));
+      memcpy(info->mvs + 4 * i + 2, &mv1, sizeof(mv1));
+    }
+  }
+  return VPX_CODEC_OK;
+}
+
 static vpx_codec_err_t set_invert_tile_order(vpx_codec_alg_priv_t *ctx,
                                              int ctr_id,
                                              va_list args) {
@@ -687,6 +748,7 @@ static vpx_codec_ctrl_fn_map_t ctf_maps[] = {
   {VP8D_GET_FRAME_CORRUPTED,      get_frame_corrupted},
   {VP9_GET_REFERENCE,             get_reference},
   {VP9_INVERT_TILE_DECODE_ORDER,  set_invert_tile_order},
+  {VP9D_GET_BLOCK_INFO,           get_block_info},
   { -1, NULL},
 };
 
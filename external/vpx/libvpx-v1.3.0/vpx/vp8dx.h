@@ -76,6 +76,11 @@ enum vp8_dec_control_id {
   /** For testing. */
   VP9_INVERT_TILE_DECODE_ORDER,
 
+  /** control function to copy the mode info of the 8x8 blocks of the last
+   *  decoded frame. Takes a vp9_block_info.
+   */
+  VP9D_GET_BLOCK_INFO,
+
   VP8_DECODER_CTRL_ID_MAX
 };
 
@@ -93,6 +98,25 @@ typedef struct vp8_decrypt_init {
     void *decrypt_state;
 } vp8_decrypt_init;
 
+/*!\brief Structure to receive the mode info of the 8x8 blocks
+ *
+ * Filled by VP9D_GET_BLOCK_INFO. The arrays are provided by the caller and
+ * receive mi_rows * mi_cols entries in raster order, blocks larger than 8x8
+ * repeat their values in all 8x8 blocks they cover. Blocks smaller than 8x8
+ * report the mode and motion vectors of their last 4x4 block. With
+ * block_size set to NULL only mi_rows and mi_cols are returned.
+ */
+typedef struct vp9_block_info {
+  int mi_rows;                /**< out: rows of 8x8 blocks */
+  int mi_cols;                /**< out: columns of 8x8 blocks */
+  int capacity;               /**< in: entries each array can hold */
+  unsigned char *block_size;  /**< BLOCK_SIZE */
+  unsigned char *modes;       /**< mode | uv_mode << 4 */
+  unsigned char *ref_frames;  /**< (ref_frame[0] + 1) | (ref_frame[1] + 1) << 4 */
+  unsigned char *flags;       /**< tx_size | skip_coeff << 2 | segment_id << 3 */
+  short *mvs;                 /**< row and column of mv[0] and mv[1], 4 per block */
+} vp9_block_info;
+
 /*!\brief VP8 decoder control function parameter type
  *
  * Defines the data types that VP8D control functions take. Note that
@@ -106,6 +130,7 @@ VPX_CTRL_USE_TYPE(VP8D_GET_FRAME_CORRUPTED,    int *)
 VPX_CTRL_USE_TYPE(VP8D_GET_LAST_REF_USED,      int *)
 VPX_CTRL_USE_TYPE(VP8D_SET_DECRYPTOR,          vp8_decrypt_init *)
 VPX_CTRL_USE_TYPE(VP9_INVERT_TILE_DECODE_ORDER, int)
+VPX_CTRL_USE_TYPE(VP9D_GET_BLOCK_INFO,         vp9_block_info *)
 
 /*! @} - end defgroup vp8_decoder */
 
@@ -0,0 +1,292 @@
+//-----------------------------------------------------------------------------------------------// 
+// AnalysisJob.cpp
+//-----------------------------------------------------------------------------------------------// 
+
+#include <AnalysisJob.h>
+#include <ByteSource.h>
+#include <Demux.h>
+#include <FileIndex.h>
+#include <FrameHeader.h>
+#include <Timer.h>
+#include <Trace.h>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// Job state
+//-----------------------------------------------------------------------------------------------// 
+class AnalysisJob::State
+{
+public:
+	// a batch is handed out after this many packets or this much time, whatever comes first
+	static const size_t BatchPackets = 4096;
+	static const int BatchMs = 50;
+
+	State(std::string file, const DecoderOptions& options)
+		: file(file)
+		, options(options)
+		, cancelled(false)
+		, stopped(false)
+		, publishedPackets(0)
+		, publishedChunks(0)
+		, publishedFrames(0)
+		, hasPending(false)
+	{
+	}
+
+	~State()
+	{
+		cancelled = true;
+		if(worker.joinable())
+			worker.join();
+	}
+
+	void run();
+	void decodeFirstFrame();
+	void scan(FileIndex& rIndex);
+
+	// counts the frames added to the index since the last call
+	void countFrames(const FileIndex& index, size_t firstFrame);
+
+	// hands the packets and frames of the index that weren't handed out yet to the consumer
+	void publish(const FileIndex& index);
+
+	std::string file;
+	DecoderOptions options;
+	Timer timer; // since openFile()
+
+	std::atomic<bool> cancelled;
+	std::atomic<bool> stopped;
+	std::thread worker;
+
+	// the worker's counts, copied into pending.progress by publish()
+	AnalysisProgress progress;
+	size_t publishedPackets;
+	size_t publishedChunks;
+	size_t publishedFrames;
+
+	// guarded by the mutex
+	mutable std::mutex mutex;
+	AnalysisUpdate pending;
+	bool hasPending;
+	std::exception_ptr error;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+void AnalysisJob::State::decodeFirstFrame()
+{
+	MPX_TRACE_SCOPE("AnalysisJob first frame");
+
+	// from the start of the file, no index needed
+	Decoder decoder;
+	decoder.openFile(file, options);
+	if(!decoder.decodeNextFrame())
+		return;
+
+	auto pFrame = std::make_shared<I420Frame>();
+	decoder.copyCurrentFrame(*pFrame);
+	progress.firstFrameMs = timer.elapsedMs();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	pending.pFirstFrame = pFrame;
+	pending.progress.firstFrameMs = progress.firstFrameMs;
+	hasPending = true;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void AnalysisJob::State::countFrames(const FileIndex& index, size_t firstFrame)
+{
+	const std::vector<FrameHeader>& frames = index.bitStream.frames;
+	for(size_t frameIdx = firstFrame; frameIdx < frames.size(); frameIdx++)
+	{
+		const FrameHeader& header = frames[frameIdx];
+		progress.frameCount++;
+		progress.shownCount += header.shown() ? 1 : 0;
+		progress.keyFrameCount += header.keyFrame() ? 1 : 0;
+		progress.frameBytes += header.size;
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void AnalysisJob::State::scan(FileIndex& rIndex)
+{
+	MPX_TRACE_SCOPE("AnalysisJob scan");
+	Demuxer demuxer;
+	demuxer.openFile(file, options.ioBackend);
+
+	FrameHeaderParser parser;
+	DemuxPacket packet;
+	Timer batchTimer;
+	while(!cancelled && demuxer.readPacket(packet))
+	{
+		size_t firstFrame = rIndex.bitStream.frames.size();
+		addToBitStream(packet, parser, rIndex.bitStream);
+		rIndex.keyFrameIndex.addPacket(packet);
+		countFrames(rIndex, firstFrame);
+		progress.packetCount++;
+		progress.scannedBytes = packet.range.end;
+
+		if(rIndex.bitStream.packets.size() - publishedPackets >= BatchPackets || batchTimer.elapsedMs() >= BatchMs)
+		{
+			publish(rIndex);
+			batchTimer.restart();
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void AnalysisJob::State::publish(const FileIndex& index)
+{
+	const BitStream& bitStream = index.bitStream;
+	progress.elapsedMs = timer.elapsedMs();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	pending.packets.insert(pending.packets.end(), bitStream.packets.begin() + publishedPackets, bitStream.packets.end());
+	pending.chunks.insert(pending.chunks.end(), bitStream.chunks.begin() + publishedChunks, bitStream.chunks.end());
+	pending.frames.insert(pending.frames.end(), bitStream.frames.begin() + publishedFrames, bitStream.frames.end());
+	pending.progress = progress;
+	hasPending = true;
+	publishedPackets = bitStream.packets.size();
+	publishedChunks = bitStream.chunks.size();
+	publishedFrames = bitStream.frames.size();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void AnalysisJob::State::run()
+{
+	setTraceThreadName("analysis");
+	try
+	{
+		int64_t writeTime = 0;
+		if(!fileStamp(file, progress.fileSize, writeTime))
+			throw DecoderError("Can't open file");
+
+		decodeFirstFrame();
+
+		FileIndex index;
+		if(!cancelled && loadSidecar(file, index))
+		{
+			countFrames(index, 0);
+			progress.packetCount = index.bitStream.packets.size();
+			progress.scannedBytes = progress.fileSize;
+			progress.fromSidecar = true;
+		}
+		else if(!cancelled)
+		{
+			scan(index);
+			if(!cancelled)
+				saveSidecar(file, index);
+		}
+
+		progress.cancelled = cancelled;
+		progress.finished = !cancelled;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pending.pKeyFrameIndex = std::make_shared<KeyFrameIndex>(std::move(index.keyFrameIndex));
+		}
+		publish(index);
+	}
+	catch(...)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		error = std::current_exception();
+	}
+	stopped = true;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// AnalysisJob
+//-----------------------------------------------------------------------------------------------// 
+
+AnalysisJob::AnalysisJob()
+{
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+AnalysisJob::~AnalysisJob()
+{
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void AnalysisJob::openFile(std::string file, const DecoderOptions& options)
+{
+	// stops the job of the previous file
+	m_pState.reset();
+
+	auto pState = std::make_unique<State>(file, options);
+	State* p = pState.get();
+	p->worker = std::thread([p] { p->run(); });
+	m_pState = std::move(pState);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool AnalysisJob::takeUpdate(AnalysisUpdate& rUpdate)
+{
+	if(!m_pState)
+		return false;
+
+	State& rState = *m_pState;
+	std::lock_guard<std::mutex> lock(rState.mutex);
+	if(rState.hasPending)
+	{
+		rUpdate.pFirstFrame = std::move(rState.pending.pFirstFrame);
+		rUpdate.packets.clear();
+		rUpdate.packets.swap(rState.pending.packets);
+		rUpdate.chunks.clear();
+		rUpdate.chunks.swap(rState.pending.chunks);
+		rUpdate.frames.clear();
+		rUpdate.frames.swap(rState.pending.frames);
+		rUpdate.progress = rState.pending.progress;
+		rUpdate.pKeyFrameIndex = std::move(rState.pending.pKeyFrameIndex);
+		rState.pending.pFirstFrame = nullptr;
+		rState.pending.pKeyFrameIndex = nullptr;
+		rState.hasPending = false;
+		return true;
+	}
+
+	if(rState.error)
+	{
+		std::exception_ptr error = rState.error;
+		rState.error = nullptr;
+		std::rethrow_exception(error);
+	}
+	return false;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool AnalysisJob::done() const
+{
+	if(!m_pState)
+		return true;
+
+	// stopped is set after the last publish, a pending update or error keeps the job open until
+	// takeUpdate() has handed it out
+	const State& rState = *m_pState;
+	std::lock_guard<std::mutex> lock(rState.mutex);
+	return rState.stopped && !rState.hasPending && !rState.error;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void AnalysisJob::cancel()
+{
+	if(m_pState)
+		m_pState->cancelled = true;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
\ No newline at end of file
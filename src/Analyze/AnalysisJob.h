@@ -0,0 +1,91 @@
+//-----------------------------------------------------------------------------------------------// 
+// AnalysisJob.h
+//-----------------------------------------------------------------------------------------------// 
+#ifndef MPX_ANALYZE_ANALYSIS_JOB_H
+#define MPX_ANALYZE_ANALYSIS_JOB_H
+
+#include <BitStream.h>
+#include <Decode.h>
+#include <KeyFrameIndex.h>
+#include <YUVFrame.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// How far an AnalysisJob has come.
+//-----------------------------------------------------------------------------------------------// 
+struct AnalysisProgress
+{
+	uint64_t fileSize = 0;
+	uint64_t scannedBytes = 0; // the scan has read the file up to here
+	uint64_t packetCount = 0;
+	uint64_t frameCount = 0; // all frames, hidden ones included
+	uint64_t shownCount = 0;
+	uint64_t keyFrameCount = 0;
+	uint64_t frameBytes = 0;
+	double firstFrameMs = -1; // from openFile() until the first frame was decoded, -1 before
+	double elapsedMs = 0;
+	bool fromSidecar = false; // the index was loaded instead of scanned
+	bool finished = false; // the whole file is in the model
+	bool cancelled = false;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+// What an AnalysisJob has found since the last update. The packets, chunks and frames continue
+// the ones of the updates before, in file order, so appending them builds the model of the file.
+// The chunk blocks of the packets count from the first chunk of the file.
+//-----------------------------------------------------------------------------------------------// 
+struct AnalysisUpdate
+{
+	std::shared_ptr<const I420Frame> pFirstFrame; // only in the update that brings it
+	std::vector<BitStream::Packet> packets;
+	std::vector<BitStream::Chunk> chunks;
+	std::vector<FrameHeader> frames;
+	AnalysisProgress progress;
+
+	// Only in the last update, finished or cancelled. Exact for the part of the file that was
+	// scanned, for the decoders of the viewer, which would have to scan for their own otherwise.
+	std::shared_ptr<const KeyFrameIndex> pKeyFrameIndex;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+// Analyses a file on a background thread. The first frame is decoded before anything else, so
+// a view has a picture at once. Then the container is scanned and the packets and frame
+// headers are handed out in batches while the scan goes on. A finished scan is saved as the
+// sidecar of the file, which the next open and the keyframe index of the decoders then load.
+// Opening another file or destroying the job cancels it.
+//-----------------------------------------------------------------------------------------------// 
+class AnalysisJob
+{
+public:
+	AnalysisJob();
+	~AnalysisJob();
+
+	// starts a job, one that is still running is cancelled first
+	void openFile(std::string file, const DecoderOptions& options = DecoderOptions());
+
+	// Moves everything new since the last call into rUpdate, doesn't block. False if there is
+	// nothing new. Errors of the job are rethrown here.
+	bool takeUpdate(AnalysisUpdate& rUpdate);
+
+	// the job has stopped and everything it found is taken, true without a job
+	bool done() const;
+
+	// stops the job, can be called from any thread
+	void cancel();
+
+private:
+	class State;
+	std::unique_ptr<State> m_pState;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
+
+//-----------------------------------------------------------------------------------------------// 
+
+#endif
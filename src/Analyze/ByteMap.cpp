@@ -0,0 +1,174 @@
+//-----------------------------------------------------------------------------------------------// 
+// ByteMap.cpp
+//-----------------------------------------------------------------------------------------------// 
+
+#include <ByteMap.h>
+#include <algorithm>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+
+void ByteBucket::merge(const ByteBucket& other)
+{
+	bytes += other.bytes;
+	frameBytes += other.frameBytes;
+	keyFrameBytes += other.keyFrameBytes;
+	hiddenFrameBytes += other.hiddenFrameBytes;
+	maxPacketSize = std::max(maxPacketSize, other.maxPacketSize);
+	packetCount += other.packetCount;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+ByteMap::ByteMap()
+	: m_fileSize(0)
+	, m_baseShift(MinBaseShift)
+{
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void ByteMap::clear()
+{
+	m_fileSize = 0;
+	m_baseShift = MinBaseShift;
+	m_levels.clear();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void ByteMap::build(const BitStream& bitStream, uint64_t fileSize)
+{
+	for(const BitStream::Packet& packet : bitStream.packets)
+		fileSize = std::max(fileSize, packet.range.end);
+	reset(fileSize);
+	addPackets(bitStream, 0);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void ByteMap::reset(uint64_t fileSize)
+{
+	clear();
+	m_fileSize = fileSize;
+	if(fileSize == 0)
+		return;
+
+	while((fileSize - 1) >> m_baseShift >= MaxBaseBuckets)
+		m_baseShift++;
+	uint64_t bucketSize = baseBucketSize();
+
+	m_levels.emplace_back(size_t((fileSize + bucketSize - 1) >> m_baseShift));
+	std::vector<ByteBucket>& rBase = m_levels[0];
+	for(ByteBucket& rBucket : rBase)
+		rBucket.bytes = bucketSize;
+	rBase.back().bytes = fileSize - (uint64_t(rBase.size() - 1) << m_baseShift);
+
+	// each level sums pairs of the one below, the last bucket of an odd count stays alone
+	while(m_levels.back().size() > 1)
+	{
+		const std::vector<ByteBucket>& below = m_levels.back();
+		std::vector<ByteBucket> above((below.size() + 1) / 2);
+		for(size_t bucketIdx = 0; bucketIdx < below.size(); bucketIdx++)
+			above[bucketIdx / 2].merge(below[bucketIdx]);
+		m_levels.push_back(std::move(above));
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void ByteMap::addPackets(const BitStream& bitStream, size_t firstPacket)
+{
+	if(m_levels.empty())
+		return;
+
+	std::vector<ByteBucket>& rBase = m_levels[0];
+	size_t firstTouched = rBase.size();
+	size_t lastTouched = 0;
+	for(size_t packetPos = firstPacket; packetPos < bitStream.packets.size(); packetPos++)
+	{
+		// the part past the end of the map is dropped, build() makes the map large enough
+		const BitStream::Packet& packet = bitStream.packets[packetPos];
+		uint64_t packetEnd = std::min(packet.range.end, m_fileSize);
+		if(packetEnd <= packet.range.begin)
+			continue;
+
+		uint32_t packetSize = uint32_t(std::min<uint64_t>(packet.range.end - packet.range.begin, UINT32_MAX));
+		size_t firstBucket = size_t(packet.range.begin >> m_baseShift);
+		size_t lastBucket = size_t((packetEnd - 1) >> m_baseShift);
+		rBase[firstBucket].packetCount++;
+		for(size_t bucketIdx = firstBucket; bucketIdx <= lastBucket; bucketIdx++)
+			rBase[bucketIdx].maxPacketSize = std::max(rBase[bucketIdx].maxPacketSize, packetSize);
+		firstTouched = std::min(firstTouched, firstBucket);
+		lastTouched = std::max(lastTouched, lastBucket);
+
+		for(uint chunkIdx = 0; chunkIdx < packet.chunks.size; chunkIdx++)
+		{
+			const BitStream::Chunk& chunk = bitStream.chunk(packet, chunkIdx);
+			// the chunk's bytes in each bucket it overlaps
+			uint64_t pos = chunk.range.begin;
+			uint64_t chunkEnd = std::min(chunk.range.end, m_fileSize);
+			while(pos < chunkEnd)
+			{
+				size_t bucketIdx = size_t(pos >> m_baseShift);
+				uint64_t bucketEnd = (uint64_t(bucketIdx) + 1) << m_baseShift;
+				uint64_t bytes = std::min(chunkEnd, bucketEnd) - pos;
+				ByteBucket& rBucket = rBase[bucketIdx];
+				rBucket.frameBytes += bytes;
+				if(chunk.keyFrame)
+					rBucket.keyFrameBytes += bytes;
+				if(!chunk.shown)
+					rBucket.hiddenFrameBytes += bytes;
+				pos += bytes;
+			}
+		}
+	}
+
+	// only the buckets above the touched ones are summed again, a scan adds packets in file
+	// order so that's a short run on every level
+	for(size_t levelIdx = 1; levelIdx < m_levels.size() && firstTouched <= lastTouched; levelIdx++)
+	{
+		const std::vector<ByteBucket>& below = m_levels[levelIdx - 1];
+		std::vector<ByteBucket>& rAbove = m_levels[levelIdx];
+		firstTouched /= 2;
+		lastTouched /= 2;
+		for(size_t bucketIdx = firstTouched; bucketIdx <= lastTouched; bucketIdx++)
+		{
+			ByteBucket sum = below[bucketIdx * 2];
+			if(bucketIdx * 2 + 1 < below.size())
+				sum.merge(below[bucketIdx * 2 + 1]);
+			rAbove[bucketIdx] = sum;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void ByteMap::aggregate(uint64_t begin, uint64_t end, int columnCount, std::vector<ByteBucket>& rColumns) const
+{
+	rColumns.assign(size_t(std::max(columnCount, 0)), ByteBucket());
+	end = std::min(end, m_fileSize);
+	if(m_levels.empty() || columnCount <= 0 || begin >= end)
+		return;
+
+	// the coarsest level with buckets no larger than a column, so every column gets one or two
+	uint64_t columnBytes = std::max<uint64_t>((end - begin) / uint64_t(columnCount), 1);
+	int levelIdx = 0;
+	while(levelIdx + 1 < levelCount() && (uint64_t(1) << (m_baseShift + levelIdx + 1)) <= columnBytes)
+		levelIdx++;
+
+	int shift = m_baseShift + levelIdx;
+	const std::vector<ByteBucket>& buckets = m_levels[levelIdx];
+	size_t lastBucket = std::min(size_t((end - 1) >> shift), buckets.size() - 1);
+	for(size_t bucketIdx = size_t(begin >> shift); bucketIdx <= lastBucket; bucketIdx++)
+	{
+		uint64_t bucketBegin = std::max(uint64_t(bucketIdx) << shift, begin);
+		int column = int((bucketBegin - begin) * uint64_t(columnCount) / (end - begin));
+		rColumns[size_t(column)].merge(buckets[bucketIdx]);
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
\ No newline at end of file
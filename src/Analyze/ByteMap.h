@@ -0,0 +1,100 @@
+//-----------------------------------------------------------------------------------------------// 
+// ByteMap.h
+//-----------------------------------------------------------------------------------------------// 
+#ifndef MPX_ANALYZE_BYTE_MAP_H
+#define MPX_ANALYZE_BYTE_MAP_H
+
+#include <BitStream.h>
+#include <cstddef>
+#include <vector>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// What lies in a byte range of the file. Chunks that cross a bucket border count to each
+// bucket with the bytes inside it. The bytes that aren't frame data are container overhead,
+// e.g. headers, cues and other tracks.
+//-----------------------------------------------------------------------------------------------// 
+struct ByteBucket
+{
+	uint64_t bytes = 0; // size of the range
+	uint64_t frameBytes = 0; // all frame chunks, the two below included
+	uint64_t keyFrameBytes = 0;
+	uint64_t hiddenFrameBytes = 0; // chunks that don't output a frame, e.g. alt-ref frames
+	uint32_t maxPacketSize = 0; // of the packets that overlap the bucket
+	uint32_t packetCount = 0; // packets that begin in the bucket
+
+	void merge(const ByteBucket& other);
+};
+
+//-----------------------------------------------------------------------------------------------// 
+// The packets of a file summed into buckets of a fixed byte size, and the same again with
+// twice the bucket size on every level above, until one bucket covers the file. A view of any
+// byte range and width reads the level whose buckets are just smaller than a pixel, so the cost
+// depends on the width and not on the number of packets.
+//-----------------------------------------------------------------------------------------------// 
+class ByteMap
+{
+public:
+	// level 0 has at most this many buckets, its bucket size is the smallest power of two that
+	// fits the file
+	static const uint64_t MaxBaseBuckets = 1 << 18;
+	static const int MinBaseShift = 10; // 1 KB
+
+	ByteMap();
+
+	void build(const BitStream& bitStream, uint64_t fileSize);
+	void clear();
+
+	// An empty map of the file, for a scan that adds the packets as it finds them. Packets
+	// past the file size are cut off.
+	void reset(uint64_t fileSize);
+
+	// adds bitStream.packets from firstPacket on, the ones before it must be in the map
+	void addPackets(const BitStream& bitStream, size_t firstPacket);
+
+	// after build() at least the end of the last packet
+	uint64_t fileSize() const
+	{
+		return m_fileSize;
+	}
+
+	// the finest resolution, a view shouldn't show less than this per pixel
+	uint64_t baseBucketSize() const
+	{
+		return uint64_t(1) << m_baseShift;
+	}
+
+	int levelCount() const
+	{
+		return int(m_levels.size());
+	}
+
+	const std::vector<ByteBucket>& level(int levelIdx) const
+	{
+		return m_levels[levelIdx];
+	}
+
+	// largest packet of the file, for scaling
+	uint32_t maxPacketSize() const
+	{
+		return m_levels.empty() ? 0 : m_levels.back()[0].maxPacketSize;
+	}
+
+	// The range [begin, end) split into columnCount columns of equal byte size, each bucket
+	// goes to the column it begins in. rColumns is resized to columnCount.
+	void aggregate(uint64_t begin, uint64_t end, int columnCount, std::vector<ByteBucket>& rColumns) const;
+
+private:
+	uint64_t m_fileSize;
+	int m_baseShift; // log2 of the level 0 bucket size
+	std::vector<std::vector<ByteBucket>> m_levels;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
+
+//-----------------------------------------------------------------------------------------------// 
+
+#endif
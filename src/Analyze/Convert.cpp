@@ -0,0 +1,522 @@
+//-----------------------------------------------------------------------------------------------// 
+// Convert.cpp
+//-----------------------------------------------------------------------------------------------// 
+
+#include <Convert.h>
+#include <ThreadPool.h>
+#include <Timer.h>
+#include <Trace.h>
+#include <algorithm>
+#include <cstdlib>
+
+// The kernels only need the intrinsics and MPX_TARGET, so they follow the compiler's target and
+// not the configuration of libvpx, which is generic when it is built without yasm.
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define MPX_CONVERT_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#pragma warning (disable: 4996) // getenv
+#else
+#include <cpuid.h>
+#endif
+#else
+#define MPX_CONVERT_X86 0
+#endif
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// Scalar reference kernel
+//-----------------------------------------------------------------------------------------------// 
+
+static void convertRowScalar(const uint8_t* pY,
+							 const uint8_t* pU,
+							 const uint8_t* pV,
+							 RGB8* pDest,
+							 int width)
+{
+	for(int i = 0; i < width; i++)
+	{
+		YUV8 yuv = { pY[i], pU[i >> 1], pV[i >> 1] };
+		pDest[i] = toRGB(yuv);
+	}
+}
+
+#if MPX_CONVERT_X86
+
+//-----------------------------------------------------------------------------------------------// 
+// SIMD kernels
+//
+// All of them evaluate the 14-bit fixed point formula of toRGB(YUV8) with 32-bit madd
+// products, so the results are identical. The clamping of toByte() is done by the saturating
+// packs: values >= 2^22 end up as >= 256 after the shift and negative ones stay negative.
+// 33050 * u does not fit a signed 16-bit coefficient and is computed as 16525 * 2u.
+//-----------------------------------------------------------------------------------------------// 
+
+// two 16-bit madd coefficients in every 32-bit lane
+static MPX_INLINE int coeffPair(int lo, int hi)
+{
+	return int(uint32_t(uint16_t(lo)) | (uint32_t(uint16_t(hi)) << 16));
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+// 8 pixels in 16-bit lanes, chroma already upsampled
+MPX_TARGET("sse2") static MPX_INLINE void toRGB8(__m128i y, __m128i u, __m128i v,
+												 __m128i& r, __m128i& g, __m128i& b)
+{
+	const __m128i kR = _mm_set1_epi32(coeffPair(19077, 26149));
+	const __m128i kG0 = _mm_set1_epi32(coeffPair(19077, -6419));
+	const __m128i kG1 = _mm_set1_epi32(coeffPair(-13320, 0));
+	const __m128i kB = _mm_set1_epi32(coeffPair(19077, 16525));
+	const __m128i cR = _mm_set1_epi32(-3644112);
+	const __m128i cG = _mm_set1_epi32(2229552);
+	const __m128i cB = _mm_set1_epi32(-4527440);
+	const __m128i zero = _mm_setzero_si128();
+	__m128i u2 = _mm_add_epi16(u, u);
+
+	__m128i yvLo = _mm_unpacklo_epi16(y, v);
+	__m128i yvHi = _mm_unpackhi_epi16(y, v);
+	__m128i yuLo = _mm_unpacklo_epi16(y, u);
+	__m128i yuHi = _mm_unpackhi_epi16(y, u);
+	__m128i yu2Lo = _mm_unpacklo_epi16(y, u2);
+	__m128i yu2Hi = _mm_unpackhi_epi16(y, u2);
+	__m128i v0Lo = _mm_unpacklo_epi16(v, zero);
+	__m128i v0Hi = _mm_unpackhi_epi16(v, zero);
+
+	__m128i rLo = _mm_add_epi32(_mm_madd_epi16(yvLo, kR), cR);
+	__m128i rHi = _mm_add_epi32(_mm_madd_epi16(yvHi, kR), cR);
+	__m128i gLo = _mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(yuLo, kG0), _mm_madd_epi16(v0Lo, kG1)), cG);
+	__m128i gHi = _mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(yuHi, kG0), _mm_madd_epi16(v0Hi, kG1)), cG);
+	__m128i bLo = _mm_add_epi32(_mm_madd_epi16(yu2Lo, kB), cB);
+	__m128i bHi = _mm_add_epi32(_mm_madd_epi16(yu2Hi, kB), cB);
+
+	r = _mm_packs_epi32(_mm_srai_epi32(rLo, 14), _mm_srai_epi32(rHi, 14));
+	g = _mm_packs_epi32(_mm_srai_epi32(gLo, 14), _mm_srai_epi32(gHi, 14));
+	b = _mm_packs_epi32(_mm_srai_epi32(bLo, 14), _mm_srai_epi32(bHi, 14));
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+// 16 pixels, 8 chroma samples from the lower half of u and v, bytes per channel
+MPX_TARGET("sse2") static MPX_INLINE void toRGB16(__m128i y, __m128i u, __m128i v,
+												  __m128i& r, __m128i& g, __m128i& b)
+{
+	const __m128i zero = _mm_setzero_si128();
+	u = _mm_unpacklo_epi8(u, u);
+	v = _mm_unpacklo_epi8(v, v);
+
+	__m128i r0, g0, b0, r1, g1, b1;
+	toRGB8(_mm_unpacklo_epi8(y, zero), _mm_unpacklo_epi8(u, zero), _mm_unpacklo_epi8(v, zero),
+		   r0, g0, b0);
+	toRGB8(_mm_unpackhi_epi8(y, zero), _mm_unpackhi_epi8(u, zero), _mm_unpackhi_epi8(v, zero),
+		   r1, g1, b1);
+
+	r = _mm_packus_epi16(r0, r1);
+	g = _mm_packus_epi16(g0, g1);
+	b = _mm_packus_epi16(b0, b1);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+// interleave 16 pixels to packed RGB888 with byte shuffles
+MPX_TARGET("ssse3") static MPX_INLINE void storeRGB16(RGB8* pDest, __m128i r, __m128i g, __m128i b)
+{
+	const char z = -128; // shuffle index that produces zero
+	const __m128i kR0 = _mm_setr_epi8(0, z, z, 1, z, z, 2, z, z, 3, z, z, 4, z, z, 5);
+	const __m128i kG0 = _mm_setr_epi8(z, 0, z, z, 1, z, z, 2, z, z, 3, z, z, 4, z, z);
+	const __m128i kB0 = _mm_setr_epi8(z, z, 0, z, z, 1, z, z, 2, z, z, 3, z, z, 4, z);
+	const __m128i kR1 = _mm_setr_epi8(z, z, 6, z, z, 7, z, z, 8, z, z, 9, z, z, 10, z);
+	const __m128i kG1 = _mm_setr_epi8(5, z, z, 6, z, z, 7, z, z, 8, z, z, 9, z, z, 10);
+	const __m128i kB1 = _mm_setr_epi8(z, 5, z, z, 6, z, z, 7, z, z, 8, z, z, 9, z, z);
+	const __m128i kR2 = _mm_setr_epi8(z, 11, z, z, 12, z, z, 13, z, z, 14, z, z, 15, z, z);
+	const __m128i kG2 = _mm_setr_epi8(z, z, 11, z, z, 12, z, z, 13, z, z, 14, z, z, 15, z);
+	const __m128i kB2 = _mm_setr_epi8(10, z, z, 11, z, z, 12, z, z, 13, z, z, 14, z, z, 15);
+
+	__m128i out0 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, kR0), _mm_shuffle_epi8(g, kG0)),
+								_mm_shuffle_epi8(b, kB0));
+	__m128i out1 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, kR1), _mm_shuffle_epi8(g, kG1)),
+								_mm_shuffle_epi8(b, kB1));
+	__m128i out2 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, kR2), _mm_shuffle_epi8(g, kG2)),
+								_mm_shuffle_epi8(b, kB2));
+
+	__m128i* pOut = reinterpret_cast<__m128i*>(pDest);
+	_mm_storeu_si128(pOut + 0, out0);
+	_mm_storeu_si128(pOut + 1, out1);
+	_mm_storeu_si128(pOut + 2, out2);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+MPX_TARGET("sse2") static void convertRowSSE2(const uint8_t* pY,
+											  const uint8_t* pU,
+											  const uint8_t* pV,
+											  RGB8* pDest,
+											  int width)
+{
+	int i = 0;
+	for(; i + 16 <= width; i += 16)
+	{
+		__m128i r, g, b;
+		toRGB16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pY + i)),
+				_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pU + i / 2)),
+				_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pV + i / 2)),
+				r, g, b);
+
+		// no byte shuffle before ssse3, interleave through memory
+		uint8_t rgb[3][16];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(rgb[0]), r);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(rgb[1]), g);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(rgb[2]), b);
+		for(int k = 0; k < 16; k++)
+		{
+			RGB8 pixel = { rgb[0][k], rgb[1][k], rgb[2][k] };
+			pDest[i + k] = pixel;
+		}
+	}
+
+	convertRowScalar(pY + i, pU + i / 2, pV + i / 2, pDest + i, width - i);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+MPX_TARGET("ssse3") static void convertRowSSSE3(const uint8_t* pY,
+												const uint8_t* pU,
+												const uint8_t* pV,
+												RGB8* pDest,
+												int width)
+{
+	int i = 0;
+	for(; i + 16 <= width; i += 16)
+	{
+		__m128i r, g, b;
+		toRGB16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pY + i)),
+				_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pU + i / 2)),
+				_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pV + i / 2)),
+				r, g, b);
+		storeRGB16(pDest + i, r, g, b);
+	}
+
+	convertRowScalar(pY + i, pU + i / 2, pV + i / 2, pDest + i, width - i);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+// 16 pixels in 16-bit lanes, same as toRGB8() on full registers. The unpacks and packs both
+// work per 128-bit lane, so the pixel order is preserved.
+MPX_TARGET("avx2") static MPX_INLINE void toRGB16x16(__m256i y, __m256i u, __m256i v,
+													 __m256i& r, __m256i& g, __m256i& b)
+{
+	const __m256i kR = _mm256_set1_epi32(coeffPair(19077, 26149));
+	const __m256i kG0 = _mm256_set1_epi32(coeffPair(19077, -6419));
+	const __m256i kG1 = _mm256_set1_epi32(coeffPair(-13320, 0));
+	const __m256i kB = _mm256_set1_epi32(coeffPair(19077, 16525));
+	const __m256i cR = _mm256_set1_epi32(-3644112);
+	const __m256i cG = _mm256_set1_epi32(2229552);
+	const __m256i cB = _mm256_set1_epi32(-4527440);
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i u2 = _mm256_add_epi16(u, u);
+
+	__m256i yvLo = _mm256_unpacklo_epi16(y, v);
+	__m256i yvHi = _mm256_unpackhi_epi16(y, v);
+	__m256i yuLo = _mm256_unpacklo_epi16(y, u);
+	__m256i yuHi = _mm256_unpackhi_epi16(y, u);
+	__m256i yu2Lo = _mm256_unpacklo_epi16(y, u2);
+	__m256i yu2Hi = _mm256_unpackhi_epi16(y, u2);
+	__m256i v0Lo = _mm256_unpacklo_epi16(v, zero);
+	__m256i v0Hi = _mm256_unpackhi_epi16(v, zero);
+
+	__m256i rLo = _mm256_add_epi32(_mm256_madd_epi16(yvLo, kR), cR);
+	__m256i rHi = _mm256_add_epi32(_mm256_madd_epi16(yvHi, kR), cR);
+	__m256i gLo = _mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(yuLo, kG0),
+													_mm256_madd_epi16(v0Lo, kG1)), cG);
+	__m256i gHi = _mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(yuHi, kG0),
+													_mm256_madd_epi16(v0Hi, kG1)), cG);
+	__m256i bLo = _mm256_add_epi32(_mm256_madd_epi16(yu2Lo, kB), cB);
+	__m256i bHi = _mm256_add_epi32(_mm256_madd_epi16(yu2Hi, kB), cB);
+
+	r = _mm256_packs_epi32(_mm256_srai_epi32(rLo, 14), _mm256_srai_epi32(rHi, 14));
+	g = _mm256_packs_epi32(_mm256_srai_epi32(gLo, 14), _mm256_srai_epi32(gHi, 14));
+	b = _mm256_packs_epi32(_mm256_srai_epi32(bLo, 14), _mm256_srai_epi32(bHi, 14));
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+// packs 16 pixels in 16-bit lanes to bytes
+MPX_TARGET("avx2") static MPX_INLINE __m128i packBytes(__m256i x)
+{
+	return _mm_packus_epi16(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+MPX_TARGET("avx2") static void convertRowAVX2(const uint8_t* pY,
+											  const uint8_t* pU,
+											  const uint8_t* pV,
+											  RGB8* pDest,
+											  int width)
+{
+	int i = 0;
+	for(; i + 16 <= width; i += 16)
+	{
+		__m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pY + i));
+		__m128i u = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pU + i / 2));
+		__m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pV + i / 2));
+
+		__m256i r, g, b;
+		toRGB16x16(_mm256_cvtepu8_epi16(y),
+				   _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(u, u)),
+				   _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(v, v)),
+				   r, g, b);
+		storeRGB16(pDest + i, packBytes(r), packBytes(g), packBytes(b));
+	}
+
+	convertRowScalar(pY + i, pU + i / 2, pV + i / 2, pDest + i, width - i);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+// the flags of x86_simd_caps() in vpx_ports/x86.h, which needs an x86 configuration of libvpx
+enum SimdCaps
+{
+	HAS_SSE2 = 0x04,
+	HAS_SSSE3 = 0x10,
+	HAS_AVX2 = 0x80,
+};
+
+// registers eax, ebx, ecx, edx of the cpuid leaf
+static bool cpuid(uint leaf, uint regs[4])
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if(uint(info[0]) < leaf)
+		return false;
+	__cpuidex(info, int(leaf), 0);
+	for(int i = 0; i < 4; i++)
+		regs[i] = uint(info[i]);
+	return true;
+#else
+	return __get_cpuid_count(leaf, 0, &regs[0], &regs[1], &regs[2], &regs[3]) != 0;
+#endif
+}
+
+// The simd flags like x86_simd_caps(), with its VPX_SIMD_CAPS and VPX_SIMD_CAPS_MASK overrides.
+// Unlike libvpx 1.3.0 avx2 is read from leaf 7 and needs os support of the ymm state.
+static int cpuSimdCaps()
+{
+	const char* pEnv = getenv("VPX_SIMD_CAPS");
+	if(pEnv && *pEnv)
+		return int(strtol(pEnv, nullptr, 0));
+	int mask = ~0;
+	pEnv = getenv("VPX_SIMD_CAPS_MASK");
+	if(pEnv && *pEnv)
+		mask = int(strtol(pEnv, nullptr, 0));
+
+	uint regs[4];
+	if(!cpuid(1, regs))
+		return 0;
+	int caps = 0;
+	if(regs[3] & (1 << 26))
+		caps |= HAS_SSE2;
+	if(regs[2] & (1 << 9))
+		caps |= HAS_SSSE3;
+
+	// osxsave and avx, then xmm and ymm state enabled
+	const uint avxBits = (1 << 27) | (1 << 28);
+	if((regs[2] & avxBits) == avxBits)
+	{
+#if defined(_MSC_VER)
+		uint xcr0 = uint(_xgetbv(0));
+#else
+		uint xcr0, xcr0Hi;
+		__asm__ __volatile__("xgetbv" : "=a"(xcr0), "=d"(xcr0Hi) : "c"(0));
+#endif
+		if((xcr0 & 6) == 6 && cpuid(7, regs) && (regs[1] & (1 << 5)))
+			caps |= HAS_AVX2;
+	}
+	return caps & mask;
+}
+
+#endif // MPX_CONVERT_X86
+
+//-----------------------------------------------------------------------------------------------// 
+// Dispatch
+//-----------------------------------------------------------------------------------------------// 
+
+SimdLevel detectSimdLevel()
+{
+#if MPX_CONVERT_X86
+	int caps = cpuSimdCaps();
+	if(caps & HAS_AVX2)
+		return SimdLevel::AVX2;
+	if(caps & HAS_SSSE3)
+		return SimdLevel::SSSE3;
+	if(caps & HAS_SSE2)
+		return SimdLevel::SSE2;
+#endif
+	return SimdLevel::Scalar;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+ConvertRowFunc getConvertRowFunc(SimdLevel level)
+{
+	SimdLevel supported = detectSimdLevel();
+	if(level > supported)
+		level = supported;
+
+	switch(level)
+	{
+#if MPX_CONVERT_X86
+	case SimdLevel::AVX2:
+		return convertRowAVX2;
+	case SimdLevel::SSSE3:
+		return convertRowSSSE3;
+	case SimdLevel::SSE2:
+		return convertRowSSE2;
+#endif
+	default:
+		return convertRowScalar;
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+const char* toString(SimdLevel level)
+{
+	switch(level)
+	{
+	case SimdLevel::SSE2:
+		return "sse2";
+	case SimdLevel::SSSE3:
+		return "ssse3";
+	case SimdLevel::AVX2:
+		return "avx2";
+	default:
+		return "scalar";
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// Whole images
+//-----------------------------------------------------------------------------------------------// 
+
+PlaneView<const uint8_t> I420Planes::plane(int planeIdx) const
+{
+	int planeWidth = planeIdx ? (width + 1) >> 1 : width;
+	int planeHeight = planeIdx ? (height + 1) >> 1 : height;
+	return PlaneView<const uint8_t>(pPlanes[planeIdx], planeWidth, planeHeight, strides[planeIdx]);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+I420Planes I420Planes::crop(int x, int y, int cropWidth, int cropHeight) const
+{
+	PlaneView<const uint8_t> luma = plane(0).crop(x & ~1, y & ~1, cropWidth, cropHeight);
+	int lumaX = int(luma.data() - pPlanes[0]) % strides[0];
+	int lumaY = int(luma.data() - pPlanes[0]) / strides[0];
+
+	I420Planes cropped = *this;
+	cropped.width = luma.width();
+	cropped.height = luma.height();
+	cropped.pPlanes[0] = luma.data();
+	for(int planeIdx = 1; planeIdx < 3; planeIdx++)
+		cropped.pPlanes[planeIdx] = plane(planeIdx).row(lumaY >> 1) + (lumaX >> 1);
+	return cropped;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+I420Planes i420Planes(const I420Frame& frame)
+{
+	I420Planes planes;
+	for(int planeIdx = 0; planeIdx < 3; planeIdx++)
+	{
+		planes.pPlanes[planeIdx] = frame.plane(planeIdx).data();
+		planes.strides[planeIdx] = int(frame.plane(planeIdx).stride());
+	}
+	planes.width = frame.width();
+	planes.height = frame.height();
+	return planes;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void copyI420(const I420Planes& src, I420Frame& rDest)
+{
+	rDest.setSize(src.width, src.height);
+	for(int planeIdx = 0; planeIdx < 3; planeIdx++)
+		copyImage(src.plane(planeIdx), rDest.plane(planeIdx));
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void convertI420(const I420Planes& src,
+				 FrameBuf<RGB8>& rDest,
+				 SimdLevel level,
+				 ThreadPool* pPool,
+				 ConvertTimings* pTimings)
+{
+	rDest.setSize(src.width, src.height);
+	convertI420(src, rDest.view(), level, pPool, pTimings);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void convertI420(const I420Planes& src,
+				 const ImageView<RGB8>& dest,
+				 SimdLevel level,
+				 ThreadPool* pPool,
+				 ConvertTimings* pTimings)
+{
+	int width = std::min(src.width, dest.width());
+	int height = std::min(src.height, dest.height());
+
+	// Split into bands of whole row pairs, every chroma row is shared by two luma rows.
+	int threadCount = pPool ? pPool->threadCount() : 1;
+	int bandCount = std::max(1, std::min(threadCount, height / 2));
+	int bandRows = 2 * (((height + 1) / 2 + bandCount - 1) / bandCount);
+	if(pTimings)
+		pTimings->bands.resize(bandCount);
+
+	Timer timer;
+	ConvertRowFunc convertRow = getConvertRowFunc(level);
+	auto convertBand = [&](int band, int threadIdx)
+	{
+		MPX_TRACE_SCOPE("convert band");
+		double startMs = timer.elapsedMs();
+		int rowBegin = std::min(band * bandRows, height);
+		int rowEnd = std::min(rowBegin + bandRows, height);
+		for(int j = rowBegin; j < rowEnd; j++)
+		{
+			const uint8_t* pY = src.pPlanes[0] + j * src.strides[0];
+			const uint8_t* pU = src.pPlanes[1] + (j >> 1) * src.strides[1];
+			const uint8_t* pV = src.pPlanes[2] + (j >> 1) * src.strides[2];
+			convertRow(pY, pU, pV, dest.row(j), width);
+		}
+
+		if(pTimings)
+		{
+			ConvertTimings::Band& rBand = pTimings->bands[band];
+			rBand.rows.begin = rowBegin;
+			rBand.rows.end = rowEnd;
+			rBand.threadIdx = threadIdx;
+			rBand.startMs = startMs;
+			rBand.durationMs = timer.elapsedMs() - startMs;
+		}
+	};
+
+	if(pPool)
+		pPool->parallelFor(bandCount, convertBand);
+	else
+		convertBand(0, 0);
+
+	if(pTimings)
+		pTimings->totalMs = timer.elapsedMs();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
\ No newline at end of file
@@ -0,0 +1,111 @@
+//-----------------------------------------------------------------------------------------------// 
+// Convert.h
+//-----------------------------------------------------------------------------------------------// 
+#ifndef MPX_ANALYZE_CONVERT_H
+#define MPX_ANALYZE_CONVERT_H
+
+#include <Color.h>
+#include <FrameBuf.h>
+#include <ImageView.h>
+#include <Range.h>
+#include <YUVFrame.h>
+#include <vector>
+
+namespace mpx {
+
+class ThreadPool;
+
+//-----------------------------------------------------------------------------------------------// 
+// Instruction set used by the colour conversion kernels.
+//-----------------------------------------------------------------------------------------------// 
+enum class SimdLevel
+{
+	Scalar,
+	SSE2,
+	SSSE3,
+	AVX2,
+};
+
+//-----------------------------------------------------------------------------------------------// 
+// Converts one row of 4:2:0 data to RGB. pU and pV point to the chroma row belonging to the
+// luma row pY, width is the (even) luma width. All kernels are bit exact to toRGB(YUV8).
+//-----------------------------------------------------------------------------------------------// 
+typedef void (*ConvertRowFunc)(const uint8_t* pY,
+							   const uint8_t* pU,
+							   const uint8_t* pV,
+							   RGB8* pDest,
+							   int width);
+
+// best level supported by the cpu (honours libvpx's VPX_SIMD_CAPS[_MASK] overrides)
+SimdLevel detectSimdLevel();
+
+// kernel for the given level, falls back to the next lower supported one
+ConvertRowFunc getConvertRowFunc(SimdLevel level);
+
+const char* toString(SimdLevel level);
+
+//-----------------------------------------------------------------------------------------------// 
+// The three planes of a 4:2:0 image, not owned.
+//-----------------------------------------------------------------------------------------------// 
+struct I420Planes
+{
+	const uint8_t* pPlanes[3]; // y, u, v
+	int strides[3];
+	int width;
+	int height;
+
+	// the chroma planes are half the size, rounded up
+	PlaneView<const uint8_t> plane(int planeIdx) const;
+
+	// Rectangle of the image without copying, clipped to it. x and y are rounded down to even
+	// values so the chroma samples stay with their luma pixels.
+	I420Planes crop(int x, int y, int width, int height) const;
+};
+
+// the planes of a frame
+I420Planes i420Planes(const I420Frame& frame);
+
+// copies the planes into the frame, reusing its memory
+void copyI420(const I420Planes& src, I420Frame& rDest);
+
+//-----------------------------------------------------------------------------------------------// 
+// Timings of a single conversion.
+//-----------------------------------------------------------------------------------------------// 
+struct ConvertTimings
+{
+	struct Band
+	{
+		RangeI rows;
+		int threadIdx;
+		double startMs; // relative to the start of the conversion
+		double durationMs;
+	};
+
+	std::vector<Band> bands;
+	double totalMs = 0;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+// Converts a whole image. With a pool the rows are split into one band of whole row pairs per
+// thread. Odd sizes are fine, the chroma planes are rounded up.
+//-----------------------------------------------------------------------------------------------// 
+void convertI420(const I420Planes& src,
+				 FrameBuf<RGB8>& rDest,
+				 SimdLevel level,
+				 ThreadPool* pPool = nullptr,
+				 ConvertTimings* pTimings = nullptr);
+
+// into a view of the same size, e.g. a rectangle of a larger frame
+void convertI420(const I420Planes& src,
+				 const ImageView<RGB8>& dest,
+				 SimdLevel level,
+				 ThreadPool* pPool = nullptr,
+				 ConvertTimings* pTimings = nullptr);
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
+
+//-----------------------------------------------------------------------------------------------// 
+
+#endif
@@ -4,9 +4,16 @@
 
 #include <BitStream.h>
 #include <Decode.h>
+#include <Demux.h>
+#include <FileIndex.h>
+#include <FrameHeader.h>
+#include <FrameModeInfo.h>
+#include <KeyFrameIndex.h>
+#include <ThreadPool.h>
+#include <Timer.h>
+#include <Trace.h>
 #include <Utils.h>
-#include <nestegg/include/nestegg/nestegg.h>
-#include <stdarg.h>
+#include <algorithm>
 #include <vpx/vp8dx.h>
 #include <vpx/vpx_decoder.h>
 
@@ -20,23 +27,22 @@ namespace mpx {
 class Decoder::State
 {
 public:
-	std::unique_ptr<vpx_codec_ctx_t> pCodec;
-	FILE* pFile = nullptr;
-	nestegg* pNestegg = nullptr;
-	nestegg_packet* pPacket = nullptr;
+	std::unique_ptr<vpx_codec_ctx_t> pCodec; // null while auto threading waits for the first frame
+	DecoderOptions options;
+	int threadCount = 0;
+	FrameHeaderParser headerParser; // sees all chunks, for the tile columns
+	std::vector<FrameHeader> headers; // of the current chunk
+	std::string file;
+	std::unique_ptr<Demuxer> pDemuxer; // null if the chunks are fed from outside
+	DemuxPacket packet;
 	uint nextChunk = 0;
-	uint chunkCount = 0;
-	uint videoTrackIdx = -1;
 	vpx_image_t* pCurImage = nullptr;
+	int64_t frameIdx = -1; // of the current frame
+	std::shared_ptr<const KeyFrameIndex> pIndex; // built on first use or handed in
+	std::shared_ptr<KeyFrameIndex> pCountedIndex; // pIndex while seeks still count its GOPs
 
 	~State()
 	{
-		if(pNestegg)
-			nestegg_destroy(pNestegg);		
-
-		if(pFile)
-			fclose(pFile);
-
 		if(pCodec)
 		{
 			vpx_codec_destroy(pCodec.get()); 
@@ -45,170 +51,293 @@ public:
 	}
 };
 
-//-----------------------------------------------------------------------------------------------// 
-// Nestegg callbacks
 //-----------------------------------------------------------------------------------------------// 
 
-int nesteggRead(void* pBuf, size_t length, void* pUserdata)
+Decoder::Decoder()
 {
-	FILE* pFile = static_cast<FILE*>(pUserdata);
-
-	if(fread(pBuf, 1, length, pFile) < length) 
-	{
-		if(ferror(pFile))
-			return -1;
-		if(feof(pFile))
-			return 0;
-	}
-	return 1;
 }
 
 //-----------------------------------------------------------------------------------------------// 
 
-int nesteggSeek(int64_t offset, int origin, void *pUserdata) 
+Decoder::~Decoder()
 {
-	switch(origin) 
-	{
-	case NESTEGG_SEEK_SET:
-		origin = SEEK_SET;
-		break;
-	case NESTEGG_SEEK_CUR:
-		origin = SEEK_CUR;
-		break;
-	case NESTEGG_SEEK_END:
-		origin = SEEK_END;
-		break;
-	};
-
-	return fseek(static_cast<FILE*>(pUserdata), long(offset), origin) ? -1 : 0;
 }
 
 //-----------------------------------------------------------------------------------------------// 
 
-int64_t nesteggTell(void *pUserdata) 
+static void initCodec(vpx_codec_ctx_t& rCodec, int threadCount)
 {
-	return ftell(static_cast<FILE*>(pUserdata));
+	vpx_codec_dec_cfg_t config = { 0 };
+	config.threads = threadCount;
+	int flags = 0;
+	if(vpx_codec_dec_init(&rCodec, vpx_codec_vp9_dx(), &config, flags)) 
+	{
+		throw DecoderError(sprint("Failed to initialize decoder: %s", 
+			vpx_codec_error(&rCodec)));
+	}
 }
 
 //-----------------------------------------------------------------------------------------------// 
 
-void nesteggLog(nestegg *pNestegg, uint severity, const char* pFormat, ...) 
+static int autoThreadCount(int tileColumns, bool frameParallel)
 {
-	va_list vaList;
-	va_start(vaList, pFormat);
-	vfprintf(stderr, pFormat, vaList);
-	fprintf(stderr, "\n");
-	va_end(vaList);
+	// libvpx 1.3 runs one tile worker per column, but only an even number of them and only for
+	// frame parallel streams. Otherwise the tiles are decoded on the calling thread and a second
+	// thread only runs the loop filter.
+	int coreCount = ThreadPool::hardwareThreads();
+	int threadCount = tileColumns > 1 && frameParallel ? std::min(tileColumns, coreCount) & ~1 : 2;
+	return std::max(1, std::min(threadCount, coreCount));
 }
 
 //-----------------------------------------------------------------------------------------------// 
 
-void Decoder::openFile(std::string file)
+void Decoder::openCodec(const DecoderOptions& options)
 {	
 	// (re-)initialize state
 	m_pState = std::make_unique<State>();
 	State& rState = *m_pState;
+	rState.options = options;
 	
-	// initialize decoder
-	vpx_codec_dec_cfg_t config = { 0 };
-	int flags = 0;
-	rState.pCodec = std::make_unique<vpx_codec_ctx_t>();
-	if(vpx_codec_dec_init(&*rState.pCodec, vpx_codec_vp9_dx(), &config, flags)) 
+	// in auto mode the codec is initialized once the first frame shows the tile layout
+	if(options.threadCount > 0)
 	{
-		throw DecoderError(sprint("Failed to initialize decoder: %s", 
-			vpx_codec_error(rState.pCodec.get())));
+		rState.pCodec = std::make_unique<vpx_codec_ctx_t>();
+		initCodec(*rState.pCodec, options.threadCount);
+		rState.threadCount = options.threadCount;
 	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void Decoder::openFile(std::string file, const DecoderOptions& options)
+{	
+	MPX_TRACE_SCOPE("Decoder::openFile");
+	openCodec(options);
+	State& rState = *m_pState;
+	rState.file = file;
+	rState.pDemuxer = std::make_unique<Demuxer>();
+	rState.pDemuxer->openFile(file, options.ioBackend);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool Decoder::decodeNextFrame(DecodeTimings* pTimings)
+{
+	MPX_TRACE_SCOPE("Decoder::decodeNextFrame");
+	State& rState = *m_pState;
+	rState.pCurImage = nullptr;
 	
-	// try to open file
-	const char* pFileName = file.c_str();
-	if(!pFileName)
-		throw DecoderError("Illegal Filename");
-
-	rState.pFile = fopen(pFileName, "rb");
-	if(!rState.pFile)
-		throw DecoderError("Can't open file");
-		
-	// initialize nestegg library
-	nestegg_io io = { nesteggRead, nesteggSeek, nesteggTell, nullptr };		
-	io.userdata = rState.pFile;
-	if(nestegg_init(&rState.pNestegg, io, nullptr))
-		throw DecoderError("Nestegg error: init");
-
-	// get number of tracks
-	uint trackCount;
-	if(nestegg_track_count(rState.pNestegg, &trackCount))
-		throw DecoderError("Nestegg error: track count");
-
-	// find the video track
-	uint trackIdx = -1;
-	for(uint i = 0; i < trackCount; i++) 
+	// chunks with only hidden frames produce no output, continue until one does
+	for(;;)
 	{
-		int trackType = nestegg_track_type(rState.pNestegg, i);
-		if(trackType == NESTEGG_TRACK_VIDEO)
+		// get buffer pointer and size for the next frame
+		const uint8_t* pBuf = nullptr;
+		size_t bufSize = 0;
+		while(rState.nextChunk >= rState.packet.chunkCount()) 
+		{
+			// end of packet, get another
+			if(!rState.pDemuxer->readPacket(rState.packet))
+				return false;
+
+			rState.nextChunk = 0;
+		}
+
+		rState.packet.chunk(rState.nextChunk, pBuf, bufSize);
+		rState.nextChunk++;
+
+		if(decodeChunk(pBuf, bufSize, pTimings))
 		{
-			trackIdx = i;
-			break;			
+			rState.frameIdx++;
+			return true;
 		}
-		if(trackType < 0)
-			throw DecoderError("Nestegg error: track type");
 	}
-	if(trackIdx == -1)
-		throw DecoderError("No video track found");
-
-	// get the codec for the video track, it should be VP9
-	int codecId = nestegg_track_codec_id(rState.pNestegg, trackIdx);
-	if(codecId != NESTEGG_CODEC_VP9) 
-		throw DecoderError("Codec is not VP9");
-	rState.videoTrackIdx = trackIdx;
 }
 
 //-----------------------------------------------------------------------------------------------// 
 
-bool Decoder::decodeNextFrame()
+const KeyFrameIndex& Decoder::keyFrameIndex()
 {
 	State& rState = *m_pState;
-	rState.pCurImage = nullptr;
-	
-	// get buffer pointer and size for the next frame
-	uint8_t* pBuf = nullptr;
-	size_t bufSize = 0;
+	if(!rState.pDemuxer)
+		throw DecoderError("No file open");
+
+	if(!rState.pIndex)
 	{
-		// todo: does this stuff actually work? my testcase only ever has one chunk
-		if(rState.nextChunk >= rState.chunkCount) 
+		// a saved index is exact and the fastest, but only read here, saving it is left to whoever
+		// wants the full FileIndex
+		FileIndex fileIndex;
+		if(loadSidecar(rState.file, fileIndex))
 		{
-			for(;;)
-			{
-				// end of packet, get another
-				if(rState.pPacket)
-					nestegg_free_packet(rState.pPacket);
-
-				// read packet
-				if(nestegg_read_packet(rState.pNestegg, &rState.pPacket) <= 0)
-					return false; // 0 == end of stream, -1 == error
-
-				uint trackIdx;
-				if(nestegg_packet_track(rState.pPacket, &trackIdx) < 0)
-					return false; // -1 == error
-
-				if(trackIdx == rState.videoTrackIdx)
-					break; // track found
-			}
-
-			// get number of chunks
-			if(nestegg_packet_count(rState.pPacket, &rState.chunkCount))
-				return false;
+			rState.pIndex = std::make_shared<KeyFrameIndex>(std::move(fileIndex.keyFrameIndex));
+			return *rState.pIndex;
+		}
 
-			rState.nextChunk = 0;
+		// the Cues are read without a pass over the file, the scan is only for files without them;
+		// a separate demuxer keeps the read position of the decoder
+		auto pIndex = std::make_shared<KeyFrameIndex>();
+		Demuxer demuxer;
+		demuxer.openFile(rState.file, rState.options.ioBackend);
+		if(pIndex->buildFromCues(demuxer))
+		{
+			if(!pIndex->exact())
+				rState.pCountedIndex = pIndex;
+		}
+		else
+		{
+			demuxer.openFile(rState.file, rState.options.ioBackend);
+			pIndex->buildFromScan(demuxer);
 		}
+		rState.pIndex = std::move(pIndex);
+	}
+	return *rState.pIndex;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void Decoder::setKeyFrameIndex(std::shared_ptr<const KeyFrameIndex> pIndex)
+{
+	State& rState = *m_pState;
+	if(!rState.pDemuxer)
+		throw DecoderError("No file open");
+
+	// counting GOPs changes the index, so one that isn't exact yet becomes the decoder's own
+	rState.pCountedIndex.reset();
+	if(pIndex && !pIndex->exact())
+	{
+		rState.pCountedIndex = std::make_shared<KeyFrameIndex>(*pIndex);
+		pIndex = rState.pCountedIndex;
+	}
+	rState.pIndex = std::move(pIndex);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool Decoder::seekToKeyFrame(const KeyFrame& keyFrame)
+{
+	State& rState = *m_pState;
+	rState.pCurImage = nullptr;
+	rState.packet.reset();
+	rState.nextChunk = 0;
+	if(!rState.pDemuxer->seekToCluster(keyFrame.clusterOffset, keyFrame.clusterPacketIdx))
+		return false;
 
-		if(nestegg_packet_data(rState.pPacket, rState.nextChunk, &pBuf, &bufSize))
+	// the cluster may start with earlier packets
+	for(;;)
+	{
+		if(!rState.pDemuxer->readPacket(rState.packet))
 			return false;
 
-		rState.nextChunk++;
+		if(rState.packet.timestamp >= keyFrame.timestamp && rState.packet.chunkCount() > 0)
+			break;
+	}
+
+	const uint8_t* pData = nullptr;
+	size_t size = 0;
+	rState.packet.chunk(0, pData, size);
+	if(!isKeyFrameChunk(pData, size))
+		return false;
+
+	rState.frameIdx = int64_t(keyFrame.frameIdx) - 1;
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool Decoder::seekToFrame(uint64_t frameIdx)
+{
+	State& rState = *m_pState;
+	const KeyFrameIndex& index = keyFrameIndex();
+	const KeyFrame* pKeyFrame = nullptr;
+	bool renumbered = false;
+	for(;;)
+	{
+		pKeyFrame = index.findKeyFrame(frameIdx);
+		if(!pKeyFrame)
+			return false;
+
+		// The GOP of the frame is counted before it is decoded, so its frames get their exact
+		// numbers. That moves the keyframes after it, the frame may be in one of those then.
+		size_t keyFramePos = size_t(pKeyFrame - index.keyFrames().data());
+		if(index.gopCounted(keyFramePos))
+			break;
+		rState.packet.reset();
+		rState.nextChunk = 0;
+		if(!rState.pCountedIndex->countGop(*rState.pDemuxer, keyFramePos))
+			return false;
+		renumbered = true;
+	}
+
+	// Decoding on is cheaper than seeking if the current frame already is past the keyframe, unless
+	// counting moved the demuxer or the numbers. Either way at most the frames from the keyframe on
+	// are decoded, a keyframe that isn't where the index says fails the seek instead of starting
+	// over at the beginning of the file.
+	int64_t target = int64_t(frameIdx);
+	bool decodeOn = !renumbered && rState.frameIdx >= int64_t(pKeyFrame->frameIdx) && rState.frameIdx <= target;
+	if(!decodeOn && !seekToKeyFrame(*pKeyFrame))
+		return false;
+
+	while(rState.frameIdx < target)
+	{
+		if(!decodeNextFrame())
+			return false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+int64_t Decoder::currentFrameIdx() const
+{
+	return m_pState ? m_pState->frameIdx : -1;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool Decoder::decodeChunk(const uint8_t* pData, size_t size, DecodeTimings* pTimings)
+{
+	State& rState = *m_pState;
+	rState.pCurImage = nullptr;
+
+	// the first frame with tile info decides for the whole chunk
+	int log2TileColumns = -1;
+	bool frameParallel = false;
+	rState.headers.clear();
+	{
+		MPX_TRACE_SCOPE("parse frame headers");
+		rState.headerParser.parseChunk(pData, size, 0, 0, rState.headers);
+	}
+	for(const FrameHeader& header : rState.headers)
+	{
+		if(!(header.flags & (FrameHeader::Corrupt | FrameHeader::ShowExisting)))
+		{
+			log2TileColumns = header.log2TileColumns;
+			frameParallel = (header.flags & FrameHeader::FrameParallel) != 0;
+			break;
+		}
+	}
+	if(!rState.pCodec)
+	{
+		rState.threadCount = autoThreadCount(log2TileColumns > 0 ? 1 << log2TileColumns : 1, frameParallel);
+		auto pCodec = std::make_unique<vpx_codec_ctx_t>();
+		initCodec(*pCodec, rState.threadCount);
+		rState.pCodec = std::move(pCodec);
 	}
 
 	// decode frame
-	if(vpx_codec_decode(rState.pCodec.get(), pBuf, static_cast<uint>(bufSize), nullptr, 0)) 
+	Timer timer;
+	vpx_codec_err_t result;
+	{
+		MPX_TRACE_SCOPE("vpx_codec_decode");
+		result = vpx_codec_decode(rState.pCodec.get(), pData, static_cast<uint>(size), nullptr, 0);
+	}
+	if(pTimings)
+	{
+		pTimings->decodeMs = timer.elapsedMs();
+		pTimings->tileColumns = log2TileColumns >= 0 ? 1 << log2TileColumns : 0;
+		pTimings->threadCount = rState.threadCount;
+	}
+
+	if(result) 
 	{
 		std::string errorMsg = sprint("Failed to decode frame: %s", 
 			vpx_codec_error(rState.pCodec.get()));
@@ -224,7 +353,12 @@ bool Decoder::decodeNextFrame()
 	
 	// check for corruption
 	int corrupted;
-	if(vpx_codec_control(rState.pCodec.get(), VP8D_GET_FRAME_CORRUPTED, &corrupted)) 
+	vpx_codec_err_t controlResult;
+	{
+		MPX_TRACE_SCOPE("VP8D_GET_FRAME_CORRUPTED");
+		controlResult = vpx_codec_control(rState.pCodec.get(), VP8D_GET_FRAME_CORRUPTED, &corrupted);
+	}
+	if(controlResult)
 	{
 		throw DecoderError(sprint("Failed VP8_GET_FRAME_CORRUPTED: %s", 
 			vpx_codec_error(rState.pCodec.get())));
@@ -235,14 +369,20 @@ bool Decoder::decodeNextFrame()
 
 //-----------------------------------------------------------------------------------------------// 
 
-void Decoder::convertCurrentFrame(FrameBuf<RGB8>& rDestFrame) const
+int Decoder::decodeThreadCount() const
+{
+	return m_pState ? m_pState->threadCount : 0;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool Decoder::currentPlanes(I420Planes& rPlanes) const
 {
 	State& rState = *m_pState;
 	if(!rState.pCurImage)
-		return; // no frame available
+		return false; // no frame available
 
-	// Convert from 4:2:0 subsampled YCbCr data to a buffer of RGB pixels.
-	// No other formats are supported. (does VP9 even have others?)
+	// Only 4:2:0 subsampled YCbCr data is supported. (does VP9 even have others?)
 	const vpx_image_t& srcImage = *rState.pCurImage;
 
 	if(srcImage.fmt != VPX_IMG_FMT_I420)
@@ -256,63 +396,102 @@ void Decoder::convertCurrentFrame(FrameBuf<RGB8>& rDestFrame) const
 	if(c_w * 2 != srcImage.d_w || c_h * 2 != srcImage.d_h)
 		throw DecoderError("Unsupported chroma subsampling format");
 
-	uint32_t frameWidth = srcImage.d_w;
-	uint32_t frameHeight = srcImage.d_h;
-	rDestFrame.setSize(frameWidth, frameHeight);
+	for(int plane = 0; plane < 3; plane++)
+	{
+		rPlanes.pPlanes[plane] = srcImage.planes[VPX_PLANE_Y + plane];
+		rPlanes.strides[plane] = srcImage.stride[VPX_PLANE_Y + plane];
+	}
+	rPlanes.width = int(srcImage.d_w);
+	rPlanes.height = int(srcImage.d_h);
+	return true;
+}
 
-	int strideY = srcImage.stride[VPX_PLANE_Y];
-	int strideU = srcImage.stride[VPX_PLANE_U];
-	int strideV = srcImage.stride[VPX_PLANE_V];
+//-----------------------------------------------------------------------------------------------// 
 
-	for(uint32_t j = 0; j < frameHeight/2; j++)
-	{
-		const uint8_t* pY0 = srcImage.planes[VPX_PLANE_Y] + 2 * j * strideY;
-		const uint8_t* pY1 = pY0 + strideY;
-		const uint8_t* pU = srcImage.planes[VPX_PLANE_U] + j * strideU;
-		const uint8_t* pV = srcImage.planes[VPX_PLANE_V] + j * strideV;
+bool Decoder::copyCurrentFrame(I420Frame& rFrame) const
+{
+	I420Planes planes;
+	if(!currentPlanes(planes))
+		return false;
+	copyI420(planes, rFrame);
+	return true;
+}
 
-		for(uint32_t i = 0; i < frameWidth/2; i++)
-		{
-			uint8_t ys[4];
-			ys[0] = *pY0++;
-			ys[1] = *pY0++;
-			ys[2] = *pY1++;
-			ys[3] = *pY1++;
-			uint8_t u = *pU++;
-			uint8_t v = *pV++;
-
-			YUV8 yuv0 = { ys[0], u, v };
-			YUV8 yuv1 = { ys[1], u, v };
-			YUV8 yuv2 = { ys[2], u, v };
-			YUV8 yuv3 = { ys[3], u, v };
-			RGB8 rgb0 = toRGB(yuv0);
-			RGB8 rgb1 = toRGB(yuv1);
-			RGB8 rgb2 = toRGB(yuv2);
-			RGB8 rgb3 = toRGB(yuv3);
-			rDestFrame(2*i, 2*j) = rgb0;
-			rDestFrame(2*i+1, 2*j) = rgb1;
-			rDestFrame(2*i, 2*j+1) = rgb2;
-			rDestFrame(2*i+1, 2*j+1) = rgb3;
-		}
-	}
+//-----------------------------------------------------------------------------------------------// 
+
+bool Decoder::currentModeInfo(FrameModeInfo& rInfo) const
+{
+	State& rState = *m_pState;
+	if(!rState.pCurImage)
+		return false; // no frame available
+
+	vp9_block_info info = {};
+	if(vpx_codec_control(rState.pCodec.get(), VP9D_GET_BLOCK_INFO, &info))
+		throw DecoderError(sprint("Failed to get the mode info: %s", vpx_codec_error(rState.pCodec.get())));
+
+	rInfo.resize(info.mi_cols, info.mi_rows);
+	if(rInfo.blockCount() == 0)
+		return true;
+
+	info.capacity = int(rInfo.blockCount());
+	info.block_size = rInfo.blockSizes.data();
+	info.modes = rInfo.modes.data();
+	info.ref_frames = rInfo.refFrames.data();
+	info.flags = rInfo.flags.data();
+	info.mvs = &rInfo.mvs[0].row;
+	if(vpx_codec_control(rState.pCodec.get(), VP9D_GET_BLOCK_INFO, &info))
+		throw DecoderError(sprint("Failed to get the mode info: %s", vpx_codec_error(rState.pCodec.get())));
+	return true;
 }
 
 //-----------------------------------------------------------------------------------------------// 
 
-void modelBitStream(std::string file, 
-					BitStream& info,
-					FrameBuf<RGB8>& firstFrame)
+void Decoder::convertCurrentFrame(FrameBuf<RGB8>& rDestFrame, ConvertTimings* pTimings) const
 {
-	Decoder decoder;
-	decoder.openFile(file);
-	int iFrame = 0;
-	for(; decoder.decodeNextFrame(); iFrame++)
-	{
-		if(firstFrame.size() == 0)
-		{
-			decoder.convertCurrentFrame(firstFrame);
-		}
-	}
+	MPX_TRACE_SCOPE("Decoder::convertCurrentFrame");
+	// Convert from 4:2:0 subsampled YCbCr data to a buffer of RGB pixels.
+	I420Planes planes;
+	if(!currentPlanes(planes))
+		return; // no frame available
+
+	convertI420(planes, rDestFrame, m_simdLevel, m_pConvertPool.get(), pTimings);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void Decoder::setSimdLevel(SimdLevel level)
+{
+	m_simdLevel = level;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+SimdLevel Decoder::simdLevel() const
+{
+	return m_simdLevel;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void Decoder::setConvertThreadCount(int count)
+{
+	if(count <= 0)
+		count = ThreadPool::hardwareThreads();
+
+	if(count == convertThreadCount())
+		return;
+
+	if(count == 1)
+		m_pConvertPool.reset();
+	else
+		m_pConvertPool = std::make_unique<ThreadPool>(count);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+int Decoder::convertThreadCount() const
+{
+	return m_pConvertPool ? m_pConvertPool->threadCount() : 1;
 }
 
 //-----------------------------------------------------------------------------------------------// 
@@ -4,25 +4,109 @@
 #ifndef MPX_ANALYZE_DECODE_H
 #define MPX_ANALYZE_DECODE_H
 
+#include <ByteSource.h>
 #include <Color.h>
+#include <Convert.h>
 #include <FrameBuf.h>
 #include <memory>
 #include <string>
 
 namespace mpx {
 
+class ThreadPool;
+class KeyFrameIndex;
+struct KeyFrame;
+struct FrameModeInfo;
+
+//-----------------------------------------------------------------------------------------------// 
+// Options for the libvpx decoder.
+//-----------------------------------------------------------------------------------------------// 
+struct DecoderOptions
+{
+	// Worker threads of libvpx. With several tile columns the columns are decoded in parallel
+	// (libvpx 1.3 only does this for frame parallel streams), otherwise one extra thread runs the
+	// loop filter. 0 == auto: picked from the tile columns and the frame parallel mode of the
+	// first frame and the core count, at most 2 for streams that aren't frame parallel.
+	int threadCount = 0;
+
+	IoBackend ioBackend = IoBackend::MemoryMap;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+// Timings of a single decoded chunk.
+//-----------------------------------------------------------------------------------------------// 
+struct DecodeTimings
+{
+	double decodeMs = 0; // time spent in vpx_codec_decode
+	int tileColumns = 0; // tile columns of the (first) frame in the chunk, 0 if unknown
+	int threadCount = 0; // libvpx threads used
+};
+
 //-----------------------------------------------------------------------------------------------// 
 
 class Decoder
 {
 public:
-	void openFile(std::string file);
-	bool decodeNextFrame();
-	void convertCurrentFrame(FrameBuf<RGB8>& rDestFrame) const;
+	Decoder();
+	~Decoder();
+
+	void openFile(std::string file, const DecoderOptions& options = DecoderOptions());
+	bool decodeNextFrame(DecodeTimings* pTimings = nullptr);
+	void convertCurrentFrame(FrameBuf<RGB8>& rDestFrame, ConvertTimings* pTimings = nullptr) const;
+
+	// Decodes the frame with the given index (counted in shown frames), starting at the closest
+	// keyframe before it unless the current frame is already on the way there. With an index from
+	// the Cues the packets up to the next keyframe are demuxed first to number the frames, see
+	// KeyFrameIndex. Returns false if the frame doesn't exist or its keyframe can't be found.
+	bool seekToFrame(uint64_t frameIdx);
+
+	// index of the current frame, -1 before the first one
+	int64_t currentFrameIdx() const;
+
+	// Keyframes of the open file. Unless one was handed in, on first use the sidecar is read, or
+	// without one the Cues. Only a file without either gets all its packets scanned, which takes a
+	// pass over the file.
+	const KeyFrameIndex& keyFrameIndex();
+
+	// the index of another pass over the same file, e.g. of an AnalysisJob, instead of the own one
+	void setKeyFrameIndex(std::shared_ptr<const KeyFrameIndex> pIndex);
+
+	// Continues with the keyframe, the next decodeNextFrame() returns it. The keyframe can come
+	// from another index of the same file. Returns false if it isn't where the index says.
+	bool seekToKeyFrame(const KeyFrame& keyFrame);
+
+	// Only initializes the codec, the chunks are demuxed elsewhere and fed with decodeChunk().
+	void openCodec(const DecoderOptions& options = DecoderOptions());
+
+	// decodes a single chunk, returns true if it produced a frame
+	bool decodeChunk(const uint8_t* pData, size_t size, DecodeTimings* pTimings = nullptr);
+
+	// libvpx threads in use, 0 while auto mode waits for the first frame
+	int decodeThreadCount() const;
+
+	// planes of the current frame, valid until the next decode call
+	bool currentPlanes(I420Planes& rPlanes) const;
+
+	// copy of the current frame that stays valid, reusing the memory of rFrame
+	bool copyCurrentFrame(I420Frame& rFrame) const;
+
+	// Mode info of the 8x8 blocks of the current frame, reusing the memory of rInfo. Only
+	// costs a pass over the block grid of libvpx, so it can be taken for every frame.
+	bool currentModeInfo(FrameModeInfo& rInfo) const;
+
+	// instruction set for convertCurrentFrame, defaults to the best one available
+	void setSimdLevel(SimdLevel level);
+	SimdLevel simdLevel() const;
+
+	// threads for convertCurrentFrame, each converts one band of rows. 0 == one per core.
+	void setConvertThreadCount(int count);
+	int convertThreadCount() const;
 
 private:
 	class State;
 	std::unique_ptr<State> m_pState; // pimpl for the decoder state
+	SimdLevel m_simdLevel = detectSimdLevel();
+	std::unique_ptr<ThreadPool> m_pConvertPool; // null for single threaded conversion
 };
 
 //-----------------------------------------------------------------------------------------------// 
@@ -32,21 +116,13 @@ class DecoderError : public std::exception
 public:
 	DecoderError() {}
 	DecoderError(std::string error) : m_error(error) {}
-	const char* what() const { return m_error.c_str(); }
+	const char* what() const throw() { return m_error.c_str(); }
 private:
 	std::string m_error;
 };
 
 //-----------------------------------------------------------------------------------------------// 
 
-struct BitStreamInfo;
-
-void modelBitStream(std::string file, 
-					BitStream& info,
-					FrameBuf<RGB8>& firstFrame);
-
-//-----------------------------------------------------------------------------------------------// 
-
 } // mpx
 
 //-----------------------------------------------------------------------------------------------// 
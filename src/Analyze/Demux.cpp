@@ -0,0 +1,359 @@
+//-----------------------------------------------------------------------------------------------// 
+// Demux.cpp
+//-----------------------------------------------------------------------------------------------// 
+
+#include <BitStream.h>
+#include <ByteSource.h>
+#include <Decode.h>
+#include <Demux.h>
+#include <FrameHeader.h>
+#include <Trace.h>
+#include <nestegg/include/nestegg/nestegg.h>
+
+#pragma warning (disable: 4996) // shut up safety warning
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// Nestegg callbacks
+//-----------------------------------------------------------------------------------------------// 
+
+static int nesteggRead(void* pBuf, size_t length, void* pUserdata)
+{
+	MPX_TRACE_SCOPE("io read");
+	ByteSource* pSource = static_cast<ByteSource*>(pUserdata);
+	return pSource->read(pBuf, length) == length ? 1 : 0;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+static int nesteggSeek(int64_t offset, int origin, void *pUserdata)
+{
+	ByteSource* pSource = static_cast<ByteSource*>(pUserdata);
+	switch(origin)
+	{
+	case NESTEGG_SEEK_CUR:
+		offset += pSource->tell();
+		break;
+	case NESTEGG_SEEK_END:
+		offset += pSource->size();
+		break;
+	};
+
+	return offset >= 0 && pSource->seek(uint64_t(offset)) ? 0 : -1;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+static int64_t nesteggTell(void *pUserdata)
+{
+	return static_cast<ByteSource*>(pUserdata)->tell();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+static const unsigned char* nesteggView(size_t length, void* pUserdata)
+{
+	MPX_TRACE_SCOPE("io view");
+	return static_cast<ByteSource*>(pUserdata)->view(length);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// DemuxPacket
+//-----------------------------------------------------------------------------------------------// 
+
+DemuxPacket::~DemuxPacket()
+{
+	reset();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+DemuxPacket::DemuxPacket(DemuxPacket&& other)
+	: packetIdx(other.packetIdx)
+	, trackIdx(other.trackIdx)
+	, timestamp(other.timestamp)
+	, clusterOffset(other.clusterOffset)
+	, clusterPacketIdx(other.clusterPacketIdx)
+	, range(other.range)
+	, m_pPacket(other.m_pPacket)
+	, m_chunkCount(other.m_chunkCount)
+{
+	other.m_pPacket = nullptr;
+	other.m_chunkCount = 0;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+DemuxPacket& DemuxPacket::operator=(DemuxPacket&& other)
+{
+	if(this != &other)
+	{
+		reset(other.m_pPacket);
+		packetIdx = other.packetIdx;
+		trackIdx = other.trackIdx;
+		timestamp = other.timestamp;
+		clusterOffset = other.clusterOffset;
+		clusterPacketIdx = other.clusterPacketIdx;
+		range = other.range;
+		m_chunkCount = other.m_chunkCount;
+		other.m_pPacket = nullptr;
+		other.m_chunkCount = 0;
+	}
+	return *this;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void DemuxPacket::reset(nestegg_packet* pPacket)
+{
+	if(m_pPacket)
+		nestegg_free_packet(m_pPacket);
+
+	m_pPacket = pPacket;
+	m_chunkCount = 0;
+	if(m_pPacket)
+		nestegg_packet_count(m_pPacket, &m_chunkCount);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void DemuxPacket::chunk(uint chunkIdx, const uint8_t*& rpData, size_t& rSize) const
+{
+	uint8_t* pData = nullptr;
+	rSize = 0;
+	if(nestegg_packet_data(m_pPacket, chunkIdx, &pData, &rSize))
+		throw DecoderError("Nestegg error: packet data");
+	rpData = pData;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+RangeU64 DemuxPacket::chunkRange(uint chunkIdx) const
+{
+	uint8_t* pData = nullptr;
+	size_t size = 0;
+	uint64_t offset = 0;
+	if(nestegg_packet_data(m_pPacket, chunkIdx, &pData, &size) || 
+	   nestegg_packet_data_offset(m_pPacket, chunkIdx, &offset))
+		throw DecoderError("Nestegg error: packet data");
+	RangeU64 range = { offset, offset + size };
+	return range;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// Demuxer state
+//-----------------------------------------------------------------------------------------------// 
+class Demuxer::State
+{
+public:
+	std::unique_ptr<ByteSource> pSource;
+	nestegg* pNestegg = nullptr;
+	uint videoTrackIdx = -1;
+	uint64_t packetCount = 0;
+	uint64_t clusterOffset = 0;
+	uint64_t clusterPacketIdx = 0;
+
+	~State()
+	{
+		if(pNestegg)
+			nestegg_destroy(pNestegg);
+	}
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+Demuxer::Demuxer()
+{
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+Demuxer::~Demuxer()
+{
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void Demuxer::openFile(std::string file, IoBackend backend)
+{
+	MPX_TRACE_SCOPE("Demuxer::openFile");
+	// (re-)initialize state
+	m_pState = std::make_unique<State>();
+	State& rState = *m_pState;
+
+	// try to open file
+	const char* pFileName = file.c_str();
+	if(!pFileName)
+		throw DecoderError("Illegal Filename");
+
+	rState.pSource = openByteSource(pFileName, backend);
+	if(!rState.pSource)
+		throw DecoderError("Can't open file");
+
+	// initialize nestegg library
+	nestegg_io io = { nesteggRead, nesteggSeek, nesteggTell, nullptr, nesteggView };
+	io.userdata = rState.pSource.get();
+	if(nestegg_init(&rState.pNestegg, io, nullptr))
+		throw DecoderError("Nestegg error: init");
+
+	// get number of tracks
+	uint trackCount;
+	if(nestegg_track_count(rState.pNestegg, &trackCount))
+		throw DecoderError("Nestegg error: track count");
+
+	// find the video track
+	uint trackIdx = -1;
+	for(uint i = 0; i < trackCount; i++)
+	{
+		int trackType = nestegg_track_type(rState.pNestegg, i);
+		if(trackType == NESTEGG_TRACK_VIDEO)
+		{
+			trackIdx = i;
+			break;
+		}
+		if(trackType < 0)
+			throw DecoderError("Nestegg error: track type");
+	}
+	if(trackIdx == -1)
+		throw DecoderError("No video track found");
+
+	// get the codec for the video track, it should be VP9
+	int codecId = nestegg_track_codec_id(rState.pNestegg, trackIdx);
+	if(codecId != NESTEGG_CODEC_VP9)
+		throw DecoderError("Codec is not VP9");
+	rState.videoTrackIdx = trackIdx;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool Demuxer::readPacket(DemuxPacket& rPacket)
+{
+	MPX_TRACE_SCOPE("Demuxer::readPacket");
+	State& rState = *m_pState;
+	rPacket.reset();
+
+	for(;;)
+	{
+		nestegg_packet* pPacket = nullptr;
+		if(nestegg_read_packet(rState.pNestegg, &pPacket) <= 0)
+			return false; // 0 == end of stream, -1 == error
+
+		rPacket.reset(pPacket);
+		rPacket.packetIdx = rState.packetCount++;
+
+		// the first packet of a cluster may be on another track, so this is tracked for all
+		uint64_t clusterOffset = 0;
+		nestegg_packet_cluster_offset(pPacket, &clusterOffset);
+		if(clusterOffset != rState.clusterOffset)
+		{
+			rState.clusterOffset = clusterOffset;
+			rState.clusterPacketIdx = rPacket.packetIdx;
+		}
+
+		if(nestegg_packet_track(pPacket, &rPacket.trackIdx) < 0)
+			return false; // -1 == error
+
+		if(rPacket.trackIdx == rState.videoTrackIdx)
+			break; // track found
+	}
+
+	nestegg_packet_tstamp(rPacket.m_pPacket, &rPacket.timestamp);
+	uint64_t length = 0;
+	nestegg_packet_offset(rPacket.m_pPacket, &rPacket.range.begin, &length);
+	rPacket.range.end = rPacket.range.begin + length;
+	rPacket.clusterOffset = rState.clusterOffset;
+	rPacket.clusterPacketIdx = rState.clusterPacketIdx;
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+uint Demuxer::videoTrackIdx() const
+{
+	return m_pState->videoTrackIdx;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool Demuxer::seekToCluster(uint64_t offset, uint64_t packetIdx)
+{
+	State& rState = *m_pState;
+	if(nestegg_offset_seek(rState.pNestegg, offset))
+		return false;
+
+	rState.packetCount = packetIdx;
+	rState.clusterOffset = offset;
+	rState.clusterPacketIdx = packetIdx;
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+std::vector<Demuxer::CuePoint> Demuxer::cuePoints()
+{
+	State& rState = *m_pState;
+	std::vector<CuePoint> cuePoints;
+	CuePoint cuePoint;
+	for(uint i = 0; ; i++)
+	{
+		int result = nestegg_get_cue_point(rState.pNestegg, rState.videoTrackIdx, i, 
+										   &cuePoint.timestamp, &cuePoint.clusterOffset);
+		if(result < 0)
+			break; // -1 == no Cues or no more cue points
+		if(result == 0)
+			cuePoints.push_back(cuePoint);
+	}
+	return cuePoints;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void addToBitStream(const DemuxPacket& packet, FrameHeaderParser& rParser, BitStream& rBitStream)
+{
+	BitStream::Packet info;
+	info.packetIdx = packet.packetIdx;
+	info.timestamp = packet.timestamp;
+	info.range = packet.range;
+	info.trackIdx = packet.trackIdx;
+	info.chunks.begin = uint(rBitStream.chunks.size());
+	info.chunks.size = packet.chunkCount();
+	for(uint chunkIdx = 0; chunkIdx < packet.chunkCount(); chunkIdx++)
+	{
+		const uint8_t* pData = nullptr;
+		size_t size = 0;
+		packet.chunk(chunkIdx, pData, size);
+
+		size_t firstFrame = rBitStream.frames.size();
+		rParser.parseChunk(pData, size, uint(packet.packetIdx), chunkIdx, rBitStream.frames);
+
+		BitStream::Chunk chunk;
+		chunk.chunkIdx = chunkIdx;
+		chunk.packetIdx = uint(packet.packetIdx);
+		chunk.range = packet.chunkRange(chunkIdx);
+		chunk.keyFrame = rBitStream.frames[firstFrame].keyFrame();
+		chunk.shown = false;
+		for(size_t frameIdx = firstFrame; frameIdx < rBitStream.frames.size(); frameIdx++)
+			chunk.shown |= rBitStream.frames[frameIdx].shown();
+		rBitStream.chunks.push_back(chunk);
+	}
+	rBitStream.packets.push_back(info);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void demuxBitStream(std::string file, BitStream& rBitStream, IoBackend backend)
+{
+	Demuxer demuxer;
+	demuxer.openFile(file, backend);
+
+	rBitStream.clear();
+	FrameHeaderParser parser;
+	DemuxPacket packet;
+	while(demuxer.readPacket(packet))
+		addToBitStream(packet, parser, rBitStream);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
\ No newline at end of file
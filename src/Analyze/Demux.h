@@ -0,0 +1,119 @@
+//-----------------------------------------------------------------------------------------------// 
+// Demux.h
+//-----------------------------------------------------------------------------------------------// 
+#ifndef MPX_ANALYZE_DEMUX_H
+#define MPX_ANALYZE_DEMUX_H
+
+#include <ByteSource.h>
+#include <Include.h>
+#include <Range.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct nestegg_packet;
+
+namespace mpx {
+
+struct BitStream;
+class FrameHeaderParser;
+
+//-----------------------------------------------------------------------------------------------// 
+// Owning handle of a demuxed packet. Packets are independent allocations, so they can be
+// handed to and freed on other threads. With a memory mapped source the chunk data points into
+// the mapping, the packet must not outlive its Demuxer then.
+//-----------------------------------------------------------------------------------------------// 
+class DemuxPacket
+{
+public:
+	DemuxPacket() : range() {}
+	~DemuxPacket();
+
+	DemuxPacket(DemuxPacket&& other);
+	DemuxPacket& operator=(DemuxPacket&& other);
+
+	bool valid() const
+	{
+		return m_pPacket != nullptr;
+	}
+
+	uint chunkCount() const
+	{
+		return m_chunkCount;
+	}
+
+	// data of a chunk (a frame or superframe), valid as long as the packet
+	void chunk(uint chunkIdx, const uint8_t*& rpData, size_t& rSize) const;
+
+	// file bytes of a chunk
+	RangeU64 chunkRange(uint chunkIdx) const;
+
+	void reset(nestegg_packet* pPacket = nullptr);
+
+	uint64_t packetIdx = 0; // index among all packets of the file
+	uint trackIdx = 0;
+	uint64_t timestamp = 0; // in ns
+	uint64_t clusterOffset = 0; // file offset of the cluster holding the packet
+	uint64_t clusterPacketIdx = 0; // index of the first packet of that cluster
+	RangeU64 range; // file bytes of the block element, header included
+
+private:
+	friend class Demuxer;
+
+	DemuxPacket(const DemuxPacket&) = delete;
+	DemuxPacket& operator=(const DemuxPacket&) = delete;
+
+	nestegg_packet* m_pPacket = nullptr;
+	uint m_chunkCount = 0;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+// Reads the packets of the VP9 track of a WebM file.
+//-----------------------------------------------------------------------------------------------// 
+class Demuxer
+{
+public:
+	Demuxer();
+	~Demuxer();
+
+	void openFile(std::string file, IoBackend backend = IoBackend::MemoryMap);
+
+	// next packet of the video track, false at the end of the stream
+	bool readPacket(DemuxPacket& rPacket);
+
+	uint videoTrackIdx() const;
+
+	// Continues reading at the cluster starting at the given file offset. packetIdx is the index
+	// of the first packet in that cluster, the following packets are numbered from there.
+	bool seekToCluster(uint64_t offset, uint64_t packetIdx);
+
+	struct CuePoint
+	{
+		uint64_t timestamp; // in ns
+		uint64_t clusterOffset;
+	};
+
+	// cue points of the video track, empty if the file has no Cues
+	std::vector<CuePoint> cuePoints();
+
+private:
+	class State;
+	std::unique_ptr<State> m_pState;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+// Appends the packet, its chunks and the headers of their frames. The parser has to see all
+// packets in order.
+void addToBitStream(const DemuxPacket& packet, FrameHeaderParser& rParser, BitStream& rBitStream);
+
+// Fills the packets and chunks of the video track from the container alone, nothing is decoded.
+void demuxBitStream(std::string file, BitStream& rBitStream, IoBackend backend = IoBackend::MemoryMap);
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
+
+//-----------------------------------------------------------------------------------------------// 
+
+#endif
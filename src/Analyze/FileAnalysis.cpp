@@ -0,0 +1,166 @@
+//-----------------------------------------------------------------------------------------------// 
+// FileAnalysis.cpp
+//-----------------------------------------------------------------------------------------------// 
+
+#include <Demux.h>
+#include <FileAnalysis.h>
+#include <Pipeline.h>
+#include <Timer.h>
+#include <Trace.h>
+#include <exception>
+#include <vector>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// The totals and records of a file, fed chunk by chunk from the demuxer or the pipeline.
+//-----------------------------------------------------------------------------------------------// 
+class FileAnalyzer
+{
+public:
+	FileAnalyzer(const FrameRecordVisitor& visitFrame, FileSummary& rSummary)
+		: m_visitFrame(visitFrame)
+		, m_rSummary(rSummary)
+		, m_firstTimestamp(0)
+		, m_qIndexSum(0)
+	{
+	}
+
+	// decodeMs is that of the whole chunk
+	void addChunk(uint64_t packetIdx, uint64_t timestamp, uint chunkIdx, uint64_t size,
+				  const std::vector<FrameHeader>& headers, double decodeMs);
+
+	void finish();
+
+private:
+	const FrameRecordVisitor& m_visitFrame;
+	FileSummary& m_rSummary;
+	FrameRecord m_record;
+	uint64_t m_firstTimestamp;
+	uint64_t m_qIndexSum;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+void FileAnalyzer::addChunk(uint64_t packetIdx, uint64_t timestamp, uint chunkIdx, uint64_t size,
+							const std::vector<FrameHeader>& headers, double decodeMs)
+{
+	if(chunkIdx == 0 && m_rSummary.packetCount++ == 0)
+		m_firstTimestamp = timestamp;
+	m_rSummary.durationNs = timestamp - m_firstTimestamp;
+	m_rSummary.chunkCount++;
+	m_rSummary.fileBytes += size;
+	m_rSummary.decodeMs += decodeMs;
+
+	for(size_t headerIdx = 0; headerIdx < headers.size(); headerIdx++)
+	{
+		const FrameHeader& header = headers[headerIdx];
+		m_record.header = header;
+		m_record.packetIdx = packetIdx;
+		m_record.timestamp = timestamp;
+		m_record.shownIdx = header.shown() ? int64_t(m_rSummary.shownCount++) : -1;
+		m_record.decodeMs = headerIdx + 1 == headers.size() ? decodeMs : 0;
+
+		if(m_rSummary.frameCount == 0)
+		{
+			m_rSummary.width = header.width;
+			m_rSummary.height = header.height;
+		}
+		if(header.keyFrame())
+			m_rSummary.keyFrameCount++;
+		if(header.flags & FrameHeader::Corrupt)
+			m_rSummary.corruptCount++;
+		m_qIndexSum += header.baseQIndex;
+
+		m_record.frameIdx = m_rSummary.frameCount++;
+		if(m_visitFrame)
+			m_visitFrame(m_record);
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void FileAnalyzer::finish()
+{
+	if(m_rSummary.frameCount)
+		m_rSummary.meanQIndex = double(m_qIndexSum) / double(m_rSummary.frameCount);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+// only the headers, on the calling thread
+static void readHeaders(const std::string& file, const AnalysisOptions& options, FileAnalyzer& rAnalyzer)
+{
+	Demuxer demuxer;
+	demuxer.openFile(file, options.decoder.ioBackend);
+
+	FrameHeaderParser parser;
+	std::vector<FrameHeader> headers; // of one chunk
+	DemuxPacket packet;
+	while(demuxer.readPacket(packet))
+	{
+		for(uint chunkIdx = 0; chunkIdx < packet.chunkCount(); chunkIdx++)
+		{
+			const uint8_t* pData = nullptr;
+			size_t size = 0;
+			packet.chunk(chunkIdx, pData, size);
+			headers.clear();
+			parser.parseChunk(pData, size, uint(packet.packetIdx), chunkIdx, headers);
+			rAnalyzer.addChunk(packet.packetIdx, packet.timestamp, chunkIdx, size, headers, 0);
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+// The demuxing and header parsing run ahead of the decoder on the stages of a pipeline. The
+// images are neither copied nor converted, only the timings are wanted.
+static void decodeChunks(const std::string& file, const AnalysisOptions& options, FileAnalyzer& rAnalyzer)
+{
+	PipelineOptions pipelineOptions;
+	pipelineOptions.convert = false;
+	pipelineOptions.copyPlanes = false;
+	pipelineOptions.headers = true;
+	pipelineOptions.decoder = options.decoder;
+
+	DecodePipeline pipeline;
+	pipeline.openFile(file, pipelineOptions);
+	PipelineFrame frame;
+	while(pipeline.nextFrame(frame))
+	{
+		rAnalyzer.addChunk(frame.packetIdx, frame.timestamp, frame.chunkIdx, frame.chunkBytes, frame.headers,
+						   frame.decodeTimings.decodeMs);
+		pipeline.recycleFrame(frame);
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void analyzeFile(std::string file, const AnalysisOptions& options, const FrameRecordVisitor& visitFrame,
+				 FileSummary& rSummary)
+{
+	MPX_TRACE_SCOPE("analyzeFile");
+	rSummary = FileSummary();
+	rSummary.file = file;
+	Timer timer;
+
+	FileAnalyzer analyzer(visitFrame, rSummary);
+	try
+	{
+		if(options.decode)
+			decodeChunks(file, options, analyzer);
+		else
+			readHeaders(file, options, analyzer);
+	}
+	catch(const std::exception& e)
+	{
+		rSummary.error = e.what();
+	}
+
+	analyzer.finish();
+	rSummary.totalMs = timer.elapsedMs();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
\ No newline at end of file
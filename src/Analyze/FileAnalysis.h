@@ -0,0 +1,83 @@
+//-----------------------------------------------------------------------------------------------// 
+// FileAnalysis.h
+//-----------------------------------------------------------------------------------------------// 
+#ifndef MPX_ANALYZE_FILE_ANALYSIS_H
+#define MPX_ANALYZE_FILE_ANALYSIS_H
+
+#include <Decode.h>
+#include <FrameHeader.h>
+#include <functional>
+#include <string>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// Options for analyzeFile().
+//-----------------------------------------------------------------------------------------------// 
+struct AnalysisOptions
+{
+	AnalysisOptions()
+	{
+		// batches run many files at once, those are the parallelism
+		decoder.threadCount = 1;
+	}
+
+	bool decode = true; // run libvpx for the decode timings, only the headers are read otherwise
+	DecoderOptions decoder;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+// A frame as it is met in the stream, hidden frames included.
+//-----------------------------------------------------------------------------------------------// 
+struct FrameRecord
+{
+	uint64_t frameIdx = 0; // in decode order
+	int64_t shownIdx = -1; // in shown frames as Decoder counts them, -1 for hidden frames
+	uint64_t packetIdx = 0;
+	uint64_t timestamp = 0; // of the packet, in ns
+	FrameHeader header;
+	double decodeMs = 0; // of the chunk, on its last frame, 0 on the others of a superframe
+};
+
+//-----------------------------------------------------------------------------------------------// 
+// Totals of a file. Filled in as far as the analysis got if it failed.
+//-----------------------------------------------------------------------------------------------// 
+struct FileSummary
+{
+	std::string file;
+	std::string error; // empty on success
+	uint64_t fileBytes = 0; // of the frame data
+	uint64_t packetCount = 0;
+	uint64_t chunkCount = 0;
+	uint64_t frameCount = 0; // hidden frames included
+	uint64_t shownCount = 0;
+	uint64_t keyFrameCount = 0;
+	uint64_t corruptCount = 0;
+	uint64_t durationNs = 0; // first to last packet timestamp
+	int width = 0; // of the first frame
+	int height = 0;
+	double meanQIndex = 0;
+	double decodeMs = 0; // in libvpx
+	double totalMs = 0; // wall time of the analysis
+};
+
+// Called with every frame as soon as its chunk is done. Nothing is kept between the calls,
+// so the memory doesn't grow with the file.
+using FrameRecordVisitor = std::function<void(const FrameRecord& record)>;
+
+//-----------------------------------------------------------------------------------------------// 
+// Streams through a file once: demuxes it, reads all frame headers and decodes the chunks. The
+// decoding runs on a DecodePipeline, so the demuxing overlaps with it.
+// Errors end the analysis of the file and are reported in the summary instead of thrown, so a
+// batch carries on with the next file.
+//-----------------------------------------------------------------------------------------------// 
+void analyzeFile(std::string file, const AnalysisOptions& options, const FrameRecordVisitor& visitFrame,
+				 FileSummary& rSummary);
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
+
+//-----------------------------------------------------------------------------------------------// 
+
+#endif
@@ -0,0 +1,328 @@
+//-----------------------------------------------------------------------------------------------// 
+// FileIndex.cpp
+//-----------------------------------------------------------------------------------------------// 
+
+#include <Demux.h>
+#include <FileIndex.h>
+#include <FrameHeader.h>
+#include <cstdio>
+#include <cstring>
+
+#pragma warning (disable: 4996) // shut up safety warning
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+
+void buildFileIndex(std::string file, FileIndex& rIndex, IoBackend backend)
+{
+	Demuxer demuxer;
+	demuxer.openFile(file, backend);
+
+	rIndex.bitStream.clear();
+	rIndex.keyFrameIndex.clear();
+	FrameHeaderParser parser;
+	DemuxPacket packet;
+	while(demuxer.readPacket(packet))
+	{
+		addToBitStream(packet, parser, rIndex.bitStream);
+		rIndex.keyFrameIndex.addPacket(packet);
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// Sidecar layout: header, section table, then the records of each section. All records are
+// multiples of 8 bytes, so every section stays aligned in the mapping.
+//-----------------------------------------------------------------------------------------------// 
+
+static const char SidecarMagic[8] = { 'M', 'P', 'X', 'I', 'D', 'X', 0, 0 };
+static const uint32_t SidecarVersion = 3;
+
+enum SectionId
+{
+	PacketSection = 1,
+	ChunkSection = 2,
+	KeyFrameSection = 3,
+	FrameSection = 4, // FrameHeader records as they are
+};
+
+struct SidecarHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t sectionCount;
+	uint64_t sourceSize;
+	int64_t sourceWriteTime;
+	uint64_t frameCount; // shown frames
+};
+
+struct SectionHeader
+{
+	uint32_t id;
+	uint32_t recordSize;
+	uint64_t offset; // from the start of the file
+	uint64_t count;
+};
+
+struct PacketRecord
+{
+	uint64_t packetIdx;
+	uint64_t timestamp;
+	uint64_t begin;
+	uint64_t end;
+	uint32_t trackIdx;
+	uint32_t chunkCount; // the chunks of a packet follow the ones of the packet before
+};
+
+struct ChunkRecord
+{
+	uint64_t begin;
+	uint64_t end;
+	uint32_t flags;
+	uint32_t reserved;
+};
+
+struct KeyFrameRecord
+{
+	uint64_t frameIdx;
+	uint64_t timestamp;
+	uint64_t clusterOffset;
+	uint64_t clusterPacketIdx;
+};
+
+static_assert(sizeof(SidecarHeader) == 40 && sizeof(SectionHeader) == 24, "sidecar layout");
+static_assert(sizeof(PacketRecord) == 40 && sizeof(ChunkRecord) == 24 && sizeof(KeyFrameRecord) == 32 &&
+			  sizeof(FrameHeader) == 32, "sidecar layout");
+
+static const uint32_t ChunkKeyFrame = 1;
+static const uint32_t ChunkShown = 2;
+
+//-----------------------------------------------------------------------------------------------// 
+
+// records of a section, null if it is missing or doesn't fit into the file
+template<typename T>
+static const T* findSection(const uint8_t* pData, uint64_t size, uint32_t id, uint64_t& rCount)
+{
+	const SidecarHeader& header = *reinterpret_cast<const SidecarHeader*>(pData);
+	const SectionHeader* pSections = reinterpret_cast<const SectionHeader*>(pData + sizeof(SidecarHeader));
+	for(uint32_t sectionIdx = 0; sectionIdx < header.sectionCount; sectionIdx++)
+	{
+		const SectionHeader& section = pSections[sectionIdx];
+		if(section.id != id)
+			continue;
+
+		if(section.recordSize != sizeof(T) || section.offset % 8 || section.offset > size ||
+		   section.count > (size - section.offset) / sizeof(T))
+			return nullptr;
+		rCount = section.count;
+		return reinterpret_cast<const T*>(pData + section.offset);
+	}
+	return nullptr;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+std::string sidecarPath(const std::string& file)
+{
+	return file + ".mpxidx";
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool saveSidecar(const std::string& file, const FileIndex& index)
+{
+	SidecarHeader header;
+	memcpy(header.magic, SidecarMagic, sizeof(header.magic));
+	header.version = SidecarVersion;
+	header.sectionCount = 4;
+	header.frameCount = index.keyFrameIndex.frameCount();
+	if(!fileStamp(file, header.sourceSize, header.sourceWriteTime))
+		return false;
+
+	std::vector<PacketRecord> packets;
+	std::vector<ChunkRecord> chunks;
+	packets.reserve(index.bitStream.packets.size());
+	chunks.reserve(index.bitStream.chunks.size());
+	for(const BitStream::Packet& packet : index.bitStream.packets)
+	{
+		PacketRecord packetRecord = {};
+		packetRecord.packetIdx = packet.packetIdx;
+		packetRecord.timestamp = packet.timestamp;
+		packetRecord.begin = packet.range.begin;
+		packetRecord.end = packet.range.end;
+		packetRecord.trackIdx = packet.trackIdx;
+		packetRecord.chunkCount = packet.chunks.size;
+		packets.push_back(packetRecord);
+
+		for(uint chunkIdx = 0; chunkIdx < packet.chunks.size; chunkIdx++)
+		{
+			const BitStream::Chunk& chunk = index.bitStream.chunk(packet, chunkIdx);
+			ChunkRecord chunkRecord = {};
+			chunkRecord.begin = chunk.range.begin;
+			chunkRecord.end = chunk.range.end;
+			chunkRecord.flags = (chunk.keyFrame ? ChunkKeyFrame : 0) | (chunk.shown ? ChunkShown : 0);
+			chunks.push_back(chunkRecord);
+		}
+	}
+
+	std::vector<KeyFrameRecord> keyFrames;
+	for(const KeyFrame& keyFrame : index.keyFrameIndex.keyFrames())
+	{
+		KeyFrameRecord record = { keyFrame.frameIdx, keyFrame.timestamp, keyFrame.clusterOffset,
+								  keyFrame.clusterPacketIdx };
+		keyFrames.push_back(record);
+	}
+
+	const std::vector<FrameHeader>& frames = index.bitStream.frames;
+	SectionHeader sections[4] =
+	{
+		{ PacketSection, sizeof(PacketRecord), 0, packets.size() },
+		{ ChunkSection, sizeof(ChunkRecord), 0, chunks.size() },
+		{ KeyFrameSection, sizeof(KeyFrameRecord), 0, keyFrames.size() },
+		{ FrameSection, sizeof(FrameHeader), 0, frames.size() },
+	};
+	uint64_t offset = sizeof(header) + sizeof(sections);
+	for(SectionHeader& rSection : sections)
+	{
+		rSection.offset = offset;
+		offset += rSection.count * rSection.recordSize;
+	}
+
+	// written to a temporary file first, so a failed write never leaves a valid looking sidecar
+	std::string path = sidecarPath(file);
+	std::string tempPath = path + ".tmp";
+	FILE* pFile = fopen(tempPath.c_str(), "wb");
+	if(!pFile)
+		return false;
+
+	bool ok = fwrite(&header, sizeof(header), 1, pFile) == 1 &&
+			  fwrite(sections, sizeof(sections), 1, pFile) == 1 &&
+			  fwrite(packets.data(), sizeof(PacketRecord), packets.size(), pFile) == packets.size() &&
+			  fwrite(chunks.data(), sizeof(ChunkRecord), chunks.size(), pFile) == chunks.size() &&
+			  fwrite(keyFrames.data(), sizeof(KeyFrameRecord), keyFrames.size(), pFile) == keyFrames.size() &&
+			  fwrite(frames.data(), sizeof(FrameHeader), frames.size(), pFile) == frames.size();
+	ok = fclose(pFile) == 0 && ok;
+
+	// rename doesn't replace existing files on windows
+	remove(path.c_str());
+	if(!ok || rename(tempPath.c_str(), path.c_str()))
+	{
+		remove(tempPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool loadSidecar(const std::string& file, FileIndex& rIndex)
+{
+	uint64_t sourceSize = 0;
+	int64_t sourceWriteTime = 0;
+	if(!fileStamp(file, sourceSize, sourceWriteTime))
+		return false;
+
+	auto pSource = openByteSource(sidecarPath(file), IoBackend::MemoryMap);
+	if(!pSource || pSource->size() < sizeof(SidecarHeader))
+		return false;
+	uint64_t size = pSource->size();
+	const uint8_t* pData = pSource->view(size_t(size));
+	if(!pData)
+		return false;
+
+	const SidecarHeader& header = *reinterpret_cast<const SidecarHeader*>(pData);
+	if(memcmp(header.magic, SidecarMagic, sizeof(header.magic)) || header.version != SidecarVersion ||
+	   header.sourceSize != sourceSize || header.sourceWriteTime != sourceWriteTime ||
+	   header.sectionCount > (size - sizeof(SidecarHeader)) / sizeof(SectionHeader))
+		return false;
+
+	uint64_t packetCount = 0;
+	uint64_t chunkCount = 0;
+	uint64_t keyFrameCount = 0;
+	uint64_t frameCount = 0;
+	const PacketRecord* pPackets = findSection<PacketRecord>(pData, size, PacketSection, packetCount);
+	const ChunkRecord* pChunks = findSection<ChunkRecord>(pData, size, ChunkSection, chunkCount);
+	const KeyFrameRecord* pKeyFrames = findSection<KeyFrameRecord>(pData, size, KeyFrameSection, keyFrameCount);
+	const FrameHeader* pFrames = findSection<FrameHeader>(pData, size, FrameSection, frameCount);
+	if(!pPackets || !pChunks || !pKeyFrames || !pFrames)
+		return false;
+
+	BitStream bitStream;
+	bitStream.packets.resize(size_t(packetCount));
+	bitStream.chunks.resize(size_t(chunkCount));
+	uint64_t chunkIdx = 0;
+	for(uint64_t packetIdx = 0; packetIdx < packetCount; packetIdx++)
+	{
+		const PacketRecord& packetRecord = pPackets[packetIdx];
+		if(packetRecord.chunkCount > chunkCount - chunkIdx)
+			return false;
+
+		BitStream::Packet& rPacket = bitStream.packets[size_t(packetIdx)];
+		rPacket.packetIdx = packetRecord.packetIdx;
+		rPacket.trackIdx = packetRecord.trackIdx;
+		rPacket.timestamp = packetRecord.timestamp;
+		rPacket.range.begin = packetRecord.begin;
+		rPacket.range.end = packetRecord.end;
+		rPacket.chunks.begin = uint(chunkIdx);
+		rPacket.chunks.size = packetRecord.chunkCount;
+		for(uint32_t chunkInPacket = 0; chunkInPacket < packetRecord.chunkCount; chunkInPacket++)
+		{
+			const ChunkRecord& chunkRecord = pChunks[chunkIdx];
+			BitStream::Chunk& rChunk = bitStream.chunks[size_t(chunkIdx++)];
+			rChunk.chunkIdx = chunkInPacket;
+			rChunk.packetIdx = uint(packetRecord.packetIdx);
+			rChunk.range.begin = chunkRecord.begin;
+			rChunk.range.end = chunkRecord.end;
+			rChunk.keyFrame = (chunkRecord.flags & ChunkKeyFrame) != 0;
+			rChunk.shown = (chunkRecord.flags & ChunkShown) != 0;
+		}
+	}
+	if(chunkIdx != chunkCount)
+		return false;
+	bitStream.frames.assign(pFrames, pFrames + frameCount);
+
+	std::vector<KeyFrame> keyFrames;
+	keyFrames.resize(size_t(keyFrameCount));
+	for(uint64_t keyFrameIdx = 0; keyFrameIdx < keyFrameCount; keyFrameIdx++)
+	{
+		const KeyFrameRecord& record = pKeyFrames[keyFrameIdx];
+		KeyFrame& rKeyFrame = keyFrames[size_t(keyFrameIdx)];
+		rKeyFrame.frameIdx = record.frameIdx;
+		rKeyFrame.timestamp = record.timestamp;
+		rKeyFrame.clusterOffset = record.clusterOffset;
+		rKeyFrame.clusterPacketIdx = record.clusterPacketIdx;
+	}
+
+	rIndex.bitStream = std::move(bitStream);
+	rIndex.keyFrameIndex.assign(std::move(keyFrames), header.frameCount);
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void openFileIndex(std::string file, FileIndex& rIndex)
+{
+	if(loadSidecar(file, rIndex))
+		return;
+
+	buildFileIndex(file, rIndex);
+	saveSidecar(file, rIndex); // without a sidecar the next open scans again
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+std::shared_ptr<const KeyFrameIndex> loadKeyFrameIndex(std::string file, IoBackend backend)
+{
+	FileIndex fileIndex;
+	if(!loadSidecar(file, fileIndex))
+	{
+		Demuxer demuxer;
+		demuxer.openFile(file, backend);
+		fileIndex.keyFrameIndex.buildFromScan(demuxer);
+	}
+	return std::make_shared<const KeyFrameIndex>(std::move(fileIndex.keyFrameIndex));
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
\ No newline at end of file
@@ -0,0 +1,54 @@
+//-----------------------------------------------------------------------------------------------// 
+// FileIndex.h
+//-----------------------------------------------------------------------------------------------// 
+#ifndef MPX_ANALYZE_FILE_INDEX_H
+#define MPX_ANALYZE_FILE_INDEX_H
+
+#include <BitStream.h>
+#include <ByteSource.h>
+#include <KeyFrameIndex.h>
+#include <memory>
+#include <string>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// Everything a demux pass learns about a file.
+//-----------------------------------------------------------------------------------------------// 
+struct FileIndex
+{
+	BitStream bitStream;
+	KeyFrameIndex keyFrameIndex;
+};
+
+// one pass over the container, nothing is decoded
+void buildFileIndex(std::string file, FileIndex& rIndex, IoBackend backend = IoBackend::MemoryMap);
+
+//-----------------------------------------------------------------------------------------------// 
+// Sidecar files keep the index next to the source (file.webm.mpxidx). The layout is flat and
+// little endian, so loading is a memory map and a copy of the records. A sidecar is only used
+// if its version, and the size and write time of the source, match.
+//-----------------------------------------------------------------------------------------------// 
+
+std::string sidecarPath(const std::string& file);
+
+// false if the sidecar can't be written, e.g. in a read-only directory
+bool saveSidecar(const std::string& file, const FileIndex& index);
+
+// false if there is no sidecar or it is stale, damaged or from another version
+bool loadSidecar(const std::string& file, FileIndex& rIndex);
+
+// loads the sidecar, or builds the index and saves it
+void openFileIndex(std::string file, FileIndex& rIndex);
+
+// An exact keyframe index, from the sidecar or a scan of all packets, for users that need all
+// frame numbers up front. Decoder::keyFrameIndex() reads the Cues instead of scanning.
+std::shared_ptr<const KeyFrameIndex> loadKeyFrameIndex(std::string file, IoBackend backend = IoBackend::MemoryMap);
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
+
+//-----------------------------------------------------------------------------------------------// 
+
+#endif
@@ -0,0 +1,426 @@
+//-----------------------------------------------------------------------------------------------// 
+// FrameCache.cpp
+//-----------------------------------------------------------------------------------------------// 
+
+#include <Convert.h>
+#include <FileIndex.h>
+#include <FrameCache.h>
+#include <KeyFrameIndex.h>
+#include <Trace.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// Cache state
+//-----------------------------------------------------------------------------------------------// 
+class FrameCache::State
+{
+public:
+	struct Entry
+	{
+		std::shared_ptr<I420Frame> pFrame;
+		std::list<uint64_t>::iterator lruPos;
+	};
+
+	State(std::string file, const FrameCacheOptions& options)
+		: file(file)
+		, options(options)
+		, generation(0)
+	{
+	}
+
+	~State()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			quit = true;
+			generation++;
+		}
+		wakeUp.notify_one();
+		if(worker.joinable())
+			worker.join();
+	}
+
+	bool contains(uint64_t frameIdx) const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return frames.count(frameIdx) != 0;
+	}
+
+	// null if it isn't cached, otherwise it becomes the most recently used
+	std::shared_ptr<const I420Frame> lookup(uint64_t frameIdx);
+
+	// copies the current frame of the decoder unless it is already there
+	void insert(uint64_t frameIdx, const Decoder& decoder, bool prefetched);
+	void evictOverBudget();
+
+	// Decodes up to the frame and caches it along with the frames from cacheFrom on. Continues
+	// from the current frame of the decoder if that is on the way. Returns false at the end of
+	// the file or if a newer request supersedes the generation (0 == never).
+	bool decodeTo(Decoder& rDecoder, uint64_t frameIdx, uint64_t cacheFrom, uint64_t requestGeneration);
+
+	bool cancelled(uint64_t requestGeneration) const
+	{
+		return requestGeneration != 0 && requestGeneration != generation;
+	}
+
+	// reads or scans for the index of both decoders unless there is one, with the decodeMutex held
+	void scanIndex();
+
+	bool canDecode() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return options.scanForIndex || pIndex;
+	}
+
+	void requestPrefetch(uint64_t frameIdx);
+	void prefetchLoop();
+
+	std::string file;
+	FrameCacheOptions options;
+
+	mutable std::mutex mutex; // guards everything below up to the decoder
+	std::unordered_map<uint64_t, Entry> frames;
+	std::list<uint64_t> lru; // most recently used first
+	FrameCacheStats stats;
+	uint64_t prefetchCenter = 0;
+	std::atomic<uint64_t> generation; // of the latest request, stops stale prefetches
+	bool quit = false;
+	std::exception_ptr error; // of the prefetch thread
+	std::shared_ptr<const KeyFrameIndex> pIndex; // handed in, the decoders take it from here
+	std::condition_variable wakeUp;
+
+	std::mutex decodeMutex;
+	Decoder decoder; // for requests that miss, the prefetch thread has its own
+	std::thread worker;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+std::shared_ptr<const I420Frame> FrameCache::State::lookup(uint64_t frameIdx)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = frames.find(frameIdx);
+	if(it == frames.end())
+		return nullptr;
+
+	lru.splice(lru.begin(), lru, it->second.lruPos);
+	return it->second.pFrame;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void FrameCache::State::insert(uint64_t frameIdx, const Decoder& decoder, bool prefetched)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if(frames.count(frameIdx))
+			return;
+	}
+
+	// the copy is made outside the lock, the planes come from the frame pool
+	auto pFrame = std::make_shared<I420Frame>();
+	if(!decoder.copyCurrentFrame(*pFrame))
+		return;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if(frames.count(frameIdx))
+		return; // the other thread was faster
+
+	lru.push_front(frameIdx);
+	Entry& rEntry = frames[frameIdx];
+	rEntry.pFrame = pFrame;
+	rEntry.lruPos = lru.begin();
+	stats.bytes += pFrame->byteSize();
+	if(prefetched)
+		stats.prefetched++;
+	evictOverBudget();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void FrameCache::State::evictOverBudget()
+{
+	// the newest frame always stays, even if it alone is over the budget
+	while(stats.bytes > options.byteBudget && frames.size() > 1)
+	{
+		auto it = frames.find(lru.back());
+		stats.bytes -= it->second.pFrame->byteSize();
+		frames.erase(it);
+		lru.pop_back();
+		stats.evictions++;
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool FrameCache::State::decodeTo(Decoder& rDecoder, uint64_t frameIdx, uint64_t cacheFrom,
+								 uint64_t requestGeneration)
+{
+	const KeyFrame* pKeyFrame = rDecoder.keyFrameIndex().findKeyFrame(frameIdx);
+	if(!pKeyFrame)
+		return false;
+
+	int64_t target = int64_t(frameIdx);
+	int64_t current = rDecoder.currentFrameIdx();
+	bool decodeOn = current >= int64_t(pKeyFrame->frameIdx) && current <= target;
+	if(!decodeOn && !rDecoder.seekToFrame(pKeyFrame->frameIdx))
+		return false;
+
+	for(;;)
+	{
+		int64_t idx = rDecoder.currentFrameIdx();
+		if(idx >= int64_t(cacheFrom))
+			insert(uint64_t(idx), rDecoder, requestGeneration != 0);
+		if(idx >= target)
+			return true;
+		if(cancelled(requestGeneration) || !rDecoder.decodeNextFrame())
+			return false;
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void FrameCache::State::scanIndex()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if(pIndex)
+			return;
+	}
+
+	std::shared_ptr<const KeyFrameIndex> pScanned = loadKeyFrameIndex(file, options.decoder.ioBackend);
+	decoder.setKeyFrameIndex(pScanned);
+
+	// the prefetch thread takes it with its next request
+	std::lock_guard<std::mutex> lock(mutex);
+	pIndex = pScanned;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void FrameCache::State::requestPrefetch(uint64_t frameIdx)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		prefetchCenter = frameIdx;
+		generation++;
+	}
+	wakeUp.notify_one();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void FrameCache::State::prefetchLoop()
+{
+	setTraceThreadName("frame cache prefetch");
+	try
+	{
+		Decoder prefetchDecoder;
+		prefetchDecoder.openFile(file, options.decoder);
+		std::shared_ptr<const KeyFrameIndex> pDecoderIndex; // the one prefetchDecoder has
+
+		uint64_t handled = 0;
+		for(;;)
+		{
+			uint64_t center = 0;
+			uint64_t requestGeneration = 0;
+			std::shared_ptr<const KeyFrameIndex> pNewIndex;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wakeUp.wait(lock, [&] { return quit || generation != handled; });
+				if(quit)
+					return;
+				center = prefetchCenter;
+				requestGeneration = handled = generation;
+				if(pIndex != pDecoderIndex)
+					pNewIndex = pDecoderIndex = pIndex;
+			}
+			if(pNewIndex)
+				prefetchDecoder.setKeyFrameIndex(pNewIndex);
+
+			// forward first, scrubbing mostly goes on in the direction it started
+			uint64_t last = center + uint64_t(std::max(options.prefetchAhead, 0));
+			for(uint64_t frameIdx = center + 1; frameIdx <= last && !cancelled(requestGeneration); frameIdx++)
+			{
+				if(!contains(frameIdx) && !decodeTo(prefetchDecoder, frameIdx, center + 1, requestGeneration))
+					break;
+			}
+
+			// a single pass from the keyframe fills the window behind
+			uint64_t behind = uint64_t(std::max(options.prefetchBehind, 0));
+			uint64_t first = center > behind ? center - behind : 0;
+			for(uint64_t frameIdx = center; frameIdx-- > first && !cancelled(requestGeneration);)
+			{
+				if(!contains(frameIdx))
+				{
+					decodeTo(prefetchDecoder, frameIdx, first, requestGeneration);
+					break;
+				}
+			}
+		}
+	}
+	catch(...)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		error = std::current_exception();
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// FrameCache
+//-----------------------------------------------------------------------------------------------// 
+
+FrameCache::FrameCache()
+{
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+FrameCache::~FrameCache()
+{
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void FrameCache::openFile(std::string file, const FrameCacheOptions& options)
+{
+	// stops the prefetch thread of the previous file
+	m_pState.reset();
+
+	auto pState = std::make_unique<State>(file, options);
+	pState->decoder.openFile(file, options.decoder);
+	if(options.prefetchAhead > 0 || options.prefetchBehind > 0)
+	{
+		State* p = pState.get();
+		p->worker = std::thread([p] { p->prefetchLoop(); });
+	}
+	m_pState = std::move(pState);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+std::shared_ptr<const I420Frame> FrameCache::frame(uint64_t frameIdx)
+{
+	if(!m_pState)
+		return nullptr;
+
+	State& rState = *m_pState;
+	{
+		std::lock_guard<std::mutex> lock(rState.mutex);
+		if(rState.error)
+		{
+			std::exception_ptr error = rState.error;
+			rState.error = nullptr;
+			std::rethrow_exception(error);
+		}
+	}
+
+	std::shared_ptr<const I420Frame> pFrame = rState.lookup(frameIdx);
+	{
+		std::lock_guard<std::mutex> lock(rState.mutex);
+		if(pFrame)
+			rState.stats.hits++;
+		else
+			rState.stats.misses++;
+	}
+
+	if(!pFrame && rState.canDecode())
+	{
+		// the frames just before are cached on the way, they are the ones a step back wants
+		std::lock_guard<std::mutex> lock(rState.decodeMutex);
+		if(rState.options.scanForIndex)
+			rState.scanIndex();
+		uint64_t behind = uint64_t(std::max(rState.options.prefetchBehind, 0));
+		uint64_t cacheFrom = frameIdx > behind ? frameIdx - behind : 0;
+		if(rState.decodeTo(rState.decoder, frameIdx, cacheFrom, 0))
+			pFrame = rState.lookup(frameIdx);
+	}
+
+	if(pFrame && rState.worker.joinable() && rState.canDecode())
+		rState.requestPrefetch(frameIdx);
+	return pFrame;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void FrameCache::setKeyFrameIndex(std::shared_ptr<const KeyFrameIndex> pIndex)
+{
+	if(!m_pState)
+		return;
+
+	State& rState = *m_pState;
+	{
+		std::lock_guard<std::mutex> lock(rState.decodeMutex);
+		rState.decoder.setKeyFrameIndex(pIndex);
+	}
+
+	// the prefetch thread takes it with its next request
+	std::lock_guard<std::mutex> lock(rState.mutex);
+	rState.pIndex = pIndex;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool FrameCache::canDecode() const
+{
+	return m_pState && m_pState->canDecode();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool FrameCache::contains(uint64_t frameIdx) const
+{
+	return m_pState && m_pState->contains(frameIdx);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void FrameCache::setByteBudget(size_t byteBudget)
+{
+	if(!m_pState)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_pState->mutex);
+	m_pState->options.byteBudget = byteBudget;
+	m_pState->evictOverBudget();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void FrameCache::clear()
+{
+	if(!m_pState)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_pState->mutex);
+	m_pState->frames.clear();
+	m_pState->lru.clear();
+	m_pState->stats.bytes = 0;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+FrameCacheStats FrameCache::stats() const
+{
+	FrameCacheStats stats;
+	if(m_pState)
+	{
+		std::lock_guard<std::mutex> lock(m_pState->mutex);
+		stats = m_pState->stats;
+		stats.frameCount = m_pState->frames.size();
+	}
+	return stats;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
\ No newline at end of file
@@ -0,0 +1,90 @@
+//-----------------------------------------------------------------------------------------------// 
+// FrameCache.h
+//-----------------------------------------------------------------------------------------------// 
+#ifndef MPX_ANALYZE_FRAME_CACHE_H
+#define MPX_ANALYZE_FRAME_CACHE_H
+
+#include <Decode.h>
+#include <KeyFrameIndex.h>
+#include <YUVFrame.h>
+#include <memory>
+#include <string>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// Options for FrameCache.
+//-----------------------------------------------------------------------------------------------// 
+struct FrameCacheOptions
+{
+	size_t byteBudget = size_t(512) << 20; // the least recently used frames are evicted beyond this
+	int prefetchAhead = 8; // frames after the requested one decoded in the background
+	int prefetchBehind = 8; // frames before it, costs a decode from the keyframe
+
+	// Without an index handed in with setKeyFrameIndex(), the sidecar is read or the file scanned
+	// on the first miss, once for both decoders: they have to agree on the frame numbers, which
+	// their own indexes from the Cues wouldn't. Off for callers that must not wait on a scan, e.g.
+	// a GUI thread: only cached frames are handed out then until the index is there.
+	bool scanForIndex = true;
+
+	DecoderOptions decoder;
+};
+
+struct FrameCacheStats
+{
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	uint64_t evictions = 0;
+	uint64_t prefetched = 0; // frames added by the background thread
+	size_t frameCount = 0; // in the cache now
+	size_t bytes = 0;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+// Decoded frames by index (in shown frames, as Decoder counts them), kept as I420 within a byte
+// budget. A request prefetches the frames around it on a background thread, so stepping back
+// and forth over a stretch of the clip is served from memory. Frames decoded on the way from a
+// keyframe to the requested one are cached as well if they are in the prefetch window.
+//-----------------------------------------------------------------------------------------------// 
+class FrameCache
+{
+public:
+	FrameCache();
+	~FrameCache();
+
+	void openFile(std::string file, const FrameCacheOptions& options = FrameCacheOptions());
+
+	// The frame, from the cache or decoded. Null if it doesn't exist, or if it isn't cached and
+	// there is no index yet without FrameCacheOptions::scanForIndex. The frame stays valid while
+	// it is held, even if the cache evicts it. Errors of the prefetch thread are rethrown here.
+	std::shared_ptr<const I420Frame> frame(uint64_t frameIdx);
+
+	// The keyframes of the file from elsewhere, e.g. an AnalysisJob, for both decoders. Frames
+	// that aren't cached can be decoded from then on.
+	void setKeyFrameIndex(std::shared_ptr<const KeyFrameIndex> pIndex);
+
+	// frames that aren't cached can be decoded, with scanForIndex or once there is an index
+	bool canDecode() const;
+
+	// only looks, doesn't decode, prefetch or count
+	bool contains(uint64_t frameIdx) const;
+
+	void setByteBudget(size_t byteBudget);
+
+	// drops all frames, the counters are kept
+	void clear();
+
+	FrameCacheStats stats() const;
+
+private:
+	class State;
+	std::unique_ptr<State> m_pState;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
+
+//-----------------------------------------------------------------------------------------------// 
+
+#endif
@@ -0,0 +1,152 @@
+//-----------------------------------------------------------------------------------------------// 
+// FrameTiles.cpp
+//-----------------------------------------------------------------------------------------------// 
+
+#include <FrameTiles.h>
+#include <algorithm>
+#include <cmath>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+
+void downscalePlane(const PlaneView<const uint8_t>& src, const PlaneView<uint8_t>& dest)
+{
+	int lastX = src.width() - 1;
+	for(int y = 0; y < dest.height(); y++)
+	{
+		const uint8_t* pRow0 = src.row(2 * y);
+		const uint8_t* pRow1 = src.row(std::min(2 * y + 1, src.height() - 1));
+		uint8_t* pDest = dest.row(y);
+
+		// the pairs that are complete, the compiler vectorizes this
+		int pairCount = src.width() / 2;
+		for(int x = 0; x < pairCount; x++)
+			pDest[x] = uint8_t((pRow0[2 * x] + pRow0[2 * x + 1] + pRow1[2 * x] + pRow1[2 * x + 1] + 2) >> 2);
+		if(pairCount < dest.width())
+			pDest[pairCount] = uint8_t((pRow0[lastX] + pRow1[lastX] + 1) >> 1);
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// MipPyramid
+//-----------------------------------------------------------------------------------------------// 
+
+void MipPyramid::build(std::shared_ptr<const I420Frame> pFrame, int minSize)
+{
+	m_pFrame = pFrame;
+	size_t levelCount = 0;
+	int width = pFrame ? pFrame->width() : 0;
+	int height = pFrame ? pFrame->height() : 0;
+	while(std::max(width, height) > minSize && width > 1 && height > 1)
+	{
+		width = (width + 1) / 2;
+		height = (height + 1) / 2;
+		levelCount++;
+	}
+
+	// sized up front, so the level above isn't moved while the next one reads it
+	m_levels.resize(levelCount);
+	for(size_t levelIdx = 0; levelIdx < levelCount; levelIdx++)
+	{
+		const I420Frame& rAbove = levelIdx ? m_levels[levelIdx - 1] : *pFrame;
+		I420Frame& rLevel = m_levels[levelIdx];
+		rLevel.setSize((rAbove.width() + 1) / 2, (rAbove.height() + 1) / 2);
+		for(int planeIdx = 0; planeIdx < 3; planeIdx++)
+			downscalePlane(rAbove.plane(planeIdx), rLevel.plane(planeIdx));
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+int MipPyramid::levelForScale(double scale) const
+{
+	if(levelCount() == 0 || scale <= 0)
+		return 0;
+
+	// level n has 2^-n pixels per frame pixel
+	int level = int(std::floor(-std::log2(scale)));
+	return std::max(0, std::min(level, levelCount() - 1));
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// FrameTiles
+//-----------------------------------------------------------------------------------------------// 
+
+const int FrameTiles::TileSize;
+
+//-----------------------------------------------------------------------------------------------// 
+
+void FrameTiles::setFrame(std::shared_ptr<const I420Frame> pFrame)
+{
+	m_pyramid.build(pFrame);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+int FrameTiles::width() const
+{
+	return m_pyramid.levelCount() ? m_pyramid.level(0).width() : 0;
+}
+
+int FrameTiles::height() const
+{
+	return m_pyramid.levelCount() ? m_pyramid.level(0).height() : 0;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void FrameTiles::visibleTiles(int level, double x0, double y0, double x1, double y1,
+							  std::vector<TileKey>& rTiles) const
+{
+	rTiles.clear();
+	if(level >= m_pyramid.levelCount())
+		return;
+
+	const I420Frame& rLevel = m_pyramid.level(level);
+	double scaleX = double(rLevel.width()) / width();
+	double scaleY = double(rLevel.height()) / height();
+	int colCount = (rLevel.width() + TileSize - 1) / TileSize;
+	int rowCount = (rLevel.height() + TileSize - 1) / TileSize;
+
+	int col0 = std::max(0, int(std::floor(x0 * scaleX / TileSize)));
+	int row0 = std::max(0, int(std::floor(y0 * scaleY / TileSize)));
+	int col1 = std::min(colCount, int(std::ceil(x1 * scaleX / TileSize)));
+	int row1 = std::min(rowCount, int(std::ceil(y1 * scaleY / TileSize)));
+	for(int row = row0; row < row1; row++)
+	{
+		for(int col = col0; col < col1; col++)
+		{
+			TileKey key = { level, col, row };
+			rTiles.push_back(key);
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void FrameTiles::tileRect(const TileKey& key, double& rX, double& rY, double& rWidth, double& rHeight) const
+{
+	const I420Frame& rLevel = m_pyramid.level(key.level);
+	double scaleX = double(width()) / rLevel.width();
+	double scaleY = double(height()) / rLevel.height();
+	int x = key.col * TileSize;
+	int y = key.row * TileSize;
+	rX = x * scaleX;
+	rY = y * scaleY;
+	rWidth = std::min(TileSize, rLevel.width() - x) * scaleX;
+	rHeight = std::min(TileSize, rLevel.height() - y) * scaleY;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void FrameTiles::renderTile(const TileKey& key, FrameBuf<RGB8>& rDest, SimdLevel simdLevel) const
+{
+	I420Planes tile = i420Planes(m_pyramid.level(key.level)).crop(key.col * TileSize, key.row * TileSize,
+																	 TileSize, TileSize);
+	convertI420(tile, rDest, simdLevel);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
\ No newline at end of file
@@ -0,0 +1,96 @@
+//-----------------------------------------------------------------------------------------------// 
+// FrameTiles.h
+//-----------------------------------------------------------------------------------------------// 
+#ifndef MPX_ANALYZE_FRAME_TILES_H
+#define MPX_ANALYZE_FRAME_TILES_H
+
+#include <Convert.h>
+#include <YUVFrame.h>
+#include <memory>
+#include <vector>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// Downscaled copies of a frame, each level half the size of the one above (rounded up) with a
+// 2x2 box filter. Level 0 is the frame itself. The levels stay I420, a third of the frame
+// size together.
+//-----------------------------------------------------------------------------------------------// 
+class MipPyramid
+{
+public:
+	// halves the frame until its longer side is at most minSize
+	void build(std::shared_ptr<const I420Frame> pFrame, int minSize = 256);
+
+	int levelCount() const
+	{
+		return m_pFrame ? int(m_levels.size()) + 1 : 0;
+	}
+
+	const I420Frame& level(int levelIdx) const
+	{
+		return levelIdx == 0 ? *m_pFrame : m_levels[levelIdx - 1];
+	}
+
+	// The smallest level that still has a pixel per display pixel at the scale (display pixels
+	// per frame pixel).
+	int levelForScale(double scale) const;
+
+private:
+	std::shared_ptr<const I420Frame> m_pFrame;
+	std::vector<I420Frame> m_levels; // 1..n, reused by the next build
+};
+
+// 2x2 box filter, dest has half the size of src rounded up, the last column or row of an odd
+// size is repeated
+void downscalePlane(const PlaneView<const uint8_t>& src, const PlaneView<uint8_t>& dest);
+
+//-----------------------------------------------------------------------------------------------// 
+// A frame split into square tiles on every level of its pyramid, so a view only converts the
+// tiles it shows, at the resolution it shows them.
+//-----------------------------------------------------------------------------------------------// 
+struct TileKey
+{
+	int level;
+	int col;
+	int row;
+};
+
+class FrameTiles
+{
+public:
+	static const int TileSize = 256; // in pixels of the tile's level
+
+	void setFrame(std::shared_ptr<const I420Frame> pFrame);
+
+	const MipPyramid& pyramid() const
+	{
+		return m_pyramid;
+	}
+
+	// width and height of the full frame, 0 without one
+	int width() const;
+	int height() const;
+
+	// tiles of the level that intersect the rectangle [x0, x1) x [y0, y1) in frame pixels
+	void visibleTiles(int level, double x0, double y0, double x1, double y1,
+					  std::vector<TileKey>& rTiles) const;
+
+	// The tile's rectangle in frame pixels. Levels of odd sizes don't divide evenly, so it
+	// is scaled by the exact size ratio.
+	void tileRect(const TileKey& key, double& rX, double& rY, double& rWidth, double& rHeight) const;
+
+	// converts the tile to RGB, rDest gets the tile's size in level pixels
+	void renderTile(const TileKey& key, FrameBuf<RGB8>& rDest, SimdLevel simdLevel) const;
+
+private:
+	MipPyramid m_pyramid;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
+
+//-----------------------------------------------------------------------------------------------// 
+
+#endif
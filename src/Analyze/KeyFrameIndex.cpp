@@ -0,0 +1,244 @@
+//-----------------------------------------------------------------------------------------------// 
+// KeyFrameIndex.cpp
+//-----------------------------------------------------------------------------------------------// 
+
+#include <Demux.h>
+#include <FrameHeader.h>
+#include <KeyFrameIndex.h>
+#include <algorithm>
+#include <cmath>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// Frame headers
+//-----------------------------------------------------------------------------------------------// 
+
+bool isKeyFrameChunk(const uint8_t* pData, size_t size)
+{
+	return (peekFrameFlags(pData, size) & FrameHeader::KeyFrame) != 0;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool isShownChunk(const uint8_t* pData, size_t size)
+{
+	std::vector<size_t> sizes;
+	if(!superframeSizes(pData, size, sizes))
+		return (peekFrameFlags(pData, size) & FrameHeader::Shown) != 0;
+
+	size_t offset = 0;
+	for(size_t frameSize : sizes)
+	{
+		if(offset + frameSize > size)
+			break;
+		if(peekFrameFlags(pData + offset, frameSize) & FrameHeader::Shown)
+			return true;
+		offset += frameSize;
+	}
+	return false;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// KeyFrameIndex
+//-----------------------------------------------------------------------------------------------// 
+
+bool KeyFrameIndex::buildFromCues(Demuxer& rDemuxer)
+{
+	std::vector<Demuxer::CuePoint> cuePoints = rDemuxer.cuePoints();
+	if(cuePoints.empty())
+		return false;
+
+	// Timestamps are rounded to the timecode scale (usually 1 ms), so the frame duration is averaged
+	// over the packets up to the second cue point, or a bounded number of them if that is far away.
+	const uint64_t maxPackets = 1024;
+	uint64_t endTimestamp = cuePoints.size() > 1 ? cuePoints[1].timestamp : UINT64_MAX;
+	uint64_t firstTimestamp = 0;
+	uint64_t lastTimestamp = 0;
+	uint64_t frameCount = 0;
+	bool gopEnded = false; // all frames up to the second cue point are counted
+	DemuxPacket packet;
+	for(uint64_t packetIdx = 0; packetIdx < maxPackets; packetIdx++)
+	{
+		if(!rDemuxer.readPacket(packet))
+		{
+			gopEnded = cuePoints.size() == 1;
+			break;
+		}
+		if(packetIdx == 0)
+			firstTimestamp = packet.timestamp;
+		if(packet.timestamp >= endTimestamp)
+		{
+			lastTimestamp = packet.timestamp;
+			gopEnded = true;
+			break;
+		}
+
+		for(uint chunkIdx = 0; chunkIdx < packet.chunkCount(); chunkIdx++)
+		{
+			const uint8_t* pData = nullptr;
+			size_t size = 0;
+			packet.chunk(chunkIdx, pData, size);
+			if(isShownChunk(pData, size))
+			{
+				frameCount++;
+				lastTimestamp = packet.timestamp;
+			}
+		}
+	}
+	if(frameCount == 0)
+		return false;
+	// the span ended on a frame unless it reached the second cue point
+	uint64_t intervals = lastTimestamp != endTimestamp ? frameCount - 1 : frameCount;
+	double frameDuration = intervals > 0 ? double(lastTimestamp - firstTimestamp) / intervals : 0;
+
+	m_keyFrames.clear();
+	for(const Demuxer::CuePoint& cuePoint : cuePoints)
+	{
+		KeyFrame keyFrame;
+		keyFrame.timestamp = cuePoint.timestamp;
+		keyFrame.clusterOffset = cuePoint.clusterOffset;
+		if(cuePoint.timestamp > firstTimestamp && frameDuration > 0)
+			keyFrame.frameIdx = uint64_t(floor((cuePoint.timestamp - firstTimestamp) / frameDuration + 0.5));
+		m_keyFrames.push_back(keyFrame);
+	}
+	m_gopFrameCounts.assign(m_keyFrames.size(), 0);
+	m_uncountedGops = m_keyFrames.size();
+	m_frameCount = 0;
+	m_exact = false;
+
+	// the packets read for the estimate may already be the whole first GOP
+	if(gopEnded && cuePoints[0].timestamp <= firstTimestamp)
+		setGopFrameCount(0, frameCount);
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool KeyFrameIndex::countGop(Demuxer& rDemuxer, size_t keyFramePos)
+{
+	const KeyFrame& keyFrame = m_keyFrames[keyFramePos];
+	if(!rDemuxer.seekToCluster(keyFrame.clusterOffset, keyFrame.clusterPacketIdx))
+		return false;
+
+	uint64_t endTimestamp = keyFramePos + 1 < m_keyFrames.size() ? m_keyFrames[keyFramePos + 1].timestamp : UINT64_MAX;
+	uint64_t frameCount = 0;
+	DemuxPacket packet;
+	while(rDemuxer.readPacket(packet) && packet.timestamp < endTimestamp)
+	{
+		// the cluster may start with earlier packets
+		if(packet.timestamp < keyFrame.timestamp)
+			continue;
+
+		for(uint chunkIdx = 0; chunkIdx < packet.chunkCount(); chunkIdx++)
+		{
+			const uint8_t* pData = nullptr;
+			size_t size = 0;
+			packet.chunk(chunkIdx, pData, size);
+			if(isShownChunk(pData, size))
+				frameCount++;
+		}
+	}
+	if(frameCount == 0)
+		return false;
+
+	setGopFrameCount(keyFramePos, frameCount);
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void KeyFrameIndex::setGopFrameCount(size_t keyFramePos, uint64_t frameCount)
+{
+	if(m_gopFrameCounts[keyFramePos] == 0)
+		m_uncountedGops--;
+	m_gopFrameCounts[keyFramePos] = frameCount;
+
+	// the keyframes after it keep their distances, the difference wraps around if they move back
+	if(keyFramePos + 1 < m_keyFrames.size())
+	{
+		uint64_t shift = m_keyFrames[keyFramePos].frameIdx + frameCount - m_keyFrames[keyFramePos + 1].frameIdx;
+		for(size_t pos = keyFramePos + 1; pos < m_keyFrames.size(); pos++)
+			m_keyFrames[pos].frameIdx += shift;
+	}
+
+	// with every GOP counted the numbers add up from the first keyframe
+	if(m_uncountedGops == 0)
+	{
+		m_frameCount = m_keyFrames.back().frameIdx + m_gopFrameCounts.back();
+		m_gopFrameCounts.clear();
+		m_exact = true;
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void KeyFrameIndex::buildFromScan(Demuxer& rDemuxer)
+{
+	clear();
+
+	DemuxPacket packet;
+	while(rDemuxer.readPacket(packet))
+		addPacket(packet);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void KeyFrameIndex::clear()
+{
+	m_keyFrames.clear();
+	m_gopFrameCounts.clear();
+	m_uncountedGops = 0;
+	m_frameCount = 0;
+	m_exact = true;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void KeyFrameIndex::addPacket(const DemuxPacket& packet)
+{
+	for(uint chunkIdx = 0; chunkIdx < packet.chunkCount(); chunkIdx++)
+	{
+		const uint8_t* pData = nullptr;
+		size_t size = 0;
+		packet.chunk(chunkIdx, pData, size);
+
+		if(isKeyFrameChunk(pData, size))
+		{
+			KeyFrame keyFrame;
+			keyFrame.frameIdx = m_frameCount;
+			keyFrame.timestamp = packet.timestamp;
+			keyFrame.clusterOffset = packet.clusterOffset;
+			keyFrame.clusterPacketIdx = packet.clusterPacketIdx;
+			m_keyFrames.push_back(keyFrame);
+		}
+		if(isShownChunk(pData, size))
+			m_frameCount++;
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void KeyFrameIndex::assign(std::vector<KeyFrame> keyFrames, uint64_t frameCount)
+{
+	m_keyFrames = std::move(keyFrames);
+	m_gopFrameCounts.clear();
+	m_uncountedGops = 0;
+	m_frameCount = frameCount;
+	m_exact = true;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+const KeyFrame* KeyFrameIndex::findKeyFrame(uint64_t frameIdx) const
+{
+	auto it = std::upper_bound(m_keyFrames.begin(), m_keyFrames.end(), frameIdx,
+							   [](uint64_t frameIdx, const KeyFrame& keyFrame) { return frameIdx < keyFrame.frameIdx; });
+	if(it == m_keyFrames.begin())
+		return nullptr;
+	return &*(it - 1);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
\ No newline at end of file
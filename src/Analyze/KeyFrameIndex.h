@@ -0,0 +1,109 @@
+//-----------------------------------------------------------------------------------------------// 
+// KeyFrameIndex.h
+//-----------------------------------------------------------------------------------------------// 
+#ifndef MPX_ANALYZE_KEY_FRAME_INDEX_H
+#define MPX_ANALYZE_KEY_FRAME_INDEX_H
+
+#include <Include.h>
+#include <cstddef>
+#include <vector>
+
+namespace mpx {
+
+class Demuxer;
+class DemuxPacket;
+
+//-----------------------------------------------------------------------------------------------// 
+// Frame headers, enough to find the keyframes without decoding.
+//-----------------------------------------------------------------------------------------------// 
+
+// true if the first frame of the chunk is a keyframe
+bool isKeyFrameChunk(const uint8_t* pData, size_t size);
+
+// true if decoding the chunk outputs a frame, superframes hide all but their last frame
+bool isShownChunk(const uint8_t* pData, size_t size);
+
+//-----------------------------------------------------------------------------------------------// 
+// Seek points of a file. Frames are counted in shown frames, the same way the Decoder counts
+// them.
+//
+// An index from a scan or a sidecar is exact. The Cues only have timestamps, so an index built
+// from them starts with frame numbers estimated from the frame rate, which are off for a variable
+// frame rate or hidden frames. countGop() counts the frames from one keyframe to the next when a
+// seek lands there: the frames of that GOP are numbered exactly from its keyframe on, and the
+// keyframes after it move by the difference to their estimate.
+//-----------------------------------------------------------------------------------------------// 
+struct KeyFrame
+{
+	uint64_t frameIdx = 0;
+	uint64_t timestamp = 0; // in ns
+	uint64_t clusterOffset = 0; // file offset of the cluster holding the keyframe
+	uint64_t clusterPacketIdx = 0; // index of the first packet of that cluster, 0 from the Cues
+};
+
+class KeyFrameIndex
+{
+public:
+	// Builds the index from the Cues, returns false if the file has none. The frame numbers are
+	// estimated from the packets up to the second cue point.
+	bool buildFromCues(Demuxer& rDemuxer);
+
+	// Demuxes all packets and reads their frame headers. The demuxer has to be at the start.
+	void buildFromScan(Demuxer& rDemuxer);
+
+	// Incremental scan, for passes that do more with the packets. Starts an empty exact index,
+	// the packets have to be added in file order.
+	void clear();
+	void addPacket(const DemuxPacket& packet);
+
+	// counted keyframes from somewhere else, e.g. a saved index
+	void assign(std::vector<KeyFrame> keyFrames, uint64_t frameCount);
+
+	// last keyframe at or before the frame, null if there is none
+	const KeyFrame* findKeyFrame(uint64_t frameIdx) const;
+
+	// the frames from the keyframe at keyFramePos up to the next one are counted
+	bool gopCounted(size_t keyFramePos) const
+	{
+		return m_exact || m_gopFrameCounts[keyFramePos] != 0;
+	}
+
+	// Demuxes the packets from the keyframe at keyFramePos up to the next one and numbers them,
+	// see above. Only reads as far as the next keyframe, false if the keyframe isn't found.
+	bool countGop(Demuxer& rDemuxer, size_t keyFramePos);
+
+	// all frame numbers are counted, not estimated
+	bool exact() const
+	{
+		return m_exact;
+	}
+
+	// only known once the index is exact, 0 otherwise
+	uint64_t frameCount() const
+	{
+		return m_frameCount;
+	}
+
+	const std::vector<KeyFrame>& keyFrames() const
+	{
+		return m_keyFrames;
+	}
+
+private:
+	// numbers the GOP and moves the keyframes after it
+	void setGopFrameCount(size_t keyFramePos, uint64_t frameCount);
+
+	std::vector<KeyFrame> m_keyFrames;
+	std::vector<uint64_t> m_gopFrameCounts; // frames of each GOP while not exact, 0 == not counted
+	size_t m_uncountedGops = 0;
+	uint64_t m_frameCount = 0;
+	bool m_exact = true;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
+
+//-----------------------------------------------------------------------------------------------// 
+
+#endif
@@ -0,0 +1,149 @@
+//-----------------------------------------------------------------------------------------------// 
+// PacketIndex.cpp
+//-----------------------------------------------------------------------------------------------// 
+
+#include <PacketIndex.h>
+#include <algorithm>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+
+const size_t PacketIndex::None;
+
+//-----------------------------------------------------------------------------------------------// 
+
+void PacketIndex::build(const BitStream& bitStream)
+{
+	clear();
+	append(bitStream, 0);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void PacketIndex::append(const BitStream& bitStream, size_t firstPacket)
+{
+	size_t oldCount = m_packets.size();
+	m_packets.resize(oldCount + bitStream.packets.size() - firstPacket);
+	for(size_t packetPos = firstPacket; packetPos < bitStream.packets.size(); packetPos++)
+	{
+		PacketEntry& rEntry = m_packets[oldCount + packetPos - firstPacket];
+		rEntry.range = bitStream.packets[packetPos].range;
+		rEntry.packetPos = uint(packetPos);
+	}
+
+	// Demuxed packets are in file order already, only other sources need the sort. New packets
+	// that go in before old ones renumber the chunks of all after them.
+	auto byOffset = [](const PacketEntry& a, const PacketEntry& b) { return a.range.begin < b.range.begin; };
+	auto newBegin = m_packets.begin() + oldCount;
+	if(!std::is_sorted(newBegin, m_packets.end(), byOffset))
+		std::stable_sort(newBegin, m_packets.end(), byOffset);
+	if(oldCount > 0 && newBegin != m_packets.end() && byOffset(*newBegin, m_packets[oldCount - 1]))
+	{
+		std::inplace_merge(m_packets.begin(), newBegin, m_packets.end(), byOffset);
+		m_chunks.clear();
+		m_shownCount = 0;
+		oldCount = 0;
+	}
+
+	// the chunks in file order, which is also the decode order the frame numbers count in
+	for(size_t pos = oldCount; pos < m_packets.size(); pos++)
+	{
+		PacketEntry& rEntry = m_packets[pos];
+		rEntry.firstChunk = uint(m_chunks.size());
+		const BitStream::Packet& packet = bitStream.packets[rEntry.packetPos];
+		for(uint chunkIdx = 0; chunkIdx < packet.chunks.size; chunkIdx++)
+		{
+			const BitStream::Chunk& chunk = bitStream.chunk(packet, chunkIdx);
+			ChunkEntry entry;
+			entry.range = chunk.range;
+			entry.frameIdx = chunk.shown ? m_shownCount++ : m_shownCount;
+			entry.packetPos = rEntry.packetPos;
+			entry.chunkIdx = chunkIdx;
+			entry.keyFrame = chunk.keyFrame;
+			entry.shown = chunk.shown;
+			m_chunks.push_back(entry);
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void PacketIndex::clear()
+{
+	m_packets.clear();
+	m_chunks.clear();
+	m_shownCount = 0;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+size_t PacketIndex::packetAt(uint64_t offset) const
+{
+	// the last packet that begins at or before the offset
+	auto it = std::upper_bound(m_packets.begin(), m_packets.end(), offset,
+							   [](uint64_t offset, const PacketEntry& entry) { return offset < entry.range.begin; });
+	if(it == m_packets.begin())
+		return None;
+
+	--it;
+	return offset < it->range.end ? size_t(it - m_packets.begin()) : None;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+size_t PacketIndex::chunkAt(uint64_t offset) const
+{
+	size_t packetPos = packetAt(offset);
+	if(packetPos == None)
+		return None;
+
+	// a packet has one chunk, or a few for a superframe
+	size_t chunkEnd = packetPos + 1 < m_packets.size() ? m_packets[packetPos + 1].firstChunk : m_chunks.size();
+	for(size_t chunkPos = m_packets[packetPos].firstChunk; chunkPos < chunkEnd; chunkPos++)
+	{
+		const RangeU64& range = m_chunks[chunkPos].range;
+		if(offset >= range.begin && offset < range.end)
+			return chunkPos;
+	}
+	return None;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+Range<size_t> PacketIndex::packetsIn(uint64_t begin, uint64_t end) const
+{
+	// the first packet that ends after begin, and the first that begins at or after end
+	auto first = std::upper_bound(m_packets.begin(), m_packets.end(), begin,
+								  [](uint64_t begin, const PacketEntry& entry) { return begin < entry.range.end; });
+	auto last = std::lower_bound(first, m_packets.end(), end,
+								 [](const PacketEntry& entry, uint64_t end) { return entry.range.begin < end; });
+	Range<size_t> packets = { size_t(first - m_packets.begin()), size_t(last - m_packets.begin()) };
+	return packets;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+Range<size_t> PacketIndex::chunksIn(uint64_t begin, uint64_t end) const
+{
+	Range<size_t> packets = packetsIn(begin, end);
+	if(packets.begin >= packets.end)
+	{
+		Range<size_t> none = { 0, 0 };
+		return none;
+	}
+
+	// all chunks of the packets, less the ones at the ends that lie outside
+	Range<size_t> chunks;
+	chunks.begin = m_packets[packets.begin].firstChunk;
+	chunks.end = packets.end < m_packets.size() ? m_packets[packets.end].firstChunk : m_chunks.size();
+	while(chunks.begin < chunks.end && m_chunks[chunks.begin].range.end <= begin)
+		chunks.begin++;
+	while(chunks.end > chunks.begin && m_chunks[chunks.end - 1].range.begin >= end)
+		chunks.end--;
+	return chunks;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
\ No newline at end of file
@@ -0,0 +1,97 @@
+//-----------------------------------------------------------------------------------------------// 
+// PacketIndex.h
+//-----------------------------------------------------------------------------------------------// 
+#ifndef MPX_ANALYZE_PACKET_INDEX_H
+#define MPX_ANALYZE_PACKET_INDEX_H
+
+#include <BitStream.h>
+#include <cstddef>
+#include <vector>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// Finds the packets and chunks at file offsets with binary searches. The packets are kept in
+// file order in flat arrays, and the packets of a file don't overlap. Because of that their
+// ends are sorted as well as their beginnings, and the packets in a byte range are one
+// contiguous run. The chunks are stored packet by packet, so the chunks of a run of packets
+// are contiguous too. Packets that a scan finds later are appended without a rebuild.
+//-----------------------------------------------------------------------------------------------// 
+class PacketIndex
+{
+public:
+	struct PacketEntry
+	{
+		RangeU64 range;
+		uint packetPos; // in BitStream::packets
+		uint firstChunk; // position of the packet's first chunk, the next packet's is the end
+	};
+
+	struct ChunkEntry
+	{
+		RangeU64 range;
+		uint64_t frameIdx; // shown frame of the chunk, for a hidden chunk the next shown one
+		uint packetPos; // in BitStream::packets
+		uint chunkIdx; // in the packet
+		bool keyFrame;
+		bool shown;
+	};
+
+	static const size_t None = size_t(-1);
+
+	PacketIndex()
+		: m_shownCount(0)
+	{}
+
+	void build(const BitStream& bitStream);
+	void clear();
+
+	// adds bitStream.packets from firstPacket on, the ones before it must be in the index
+	void append(const BitStream& bitStream, size_t firstPacket);
+
+	size_t packetCount() const
+	{
+		return m_packets.size();
+	}
+
+	size_t chunkCount() const
+	{
+		return m_chunks.size();
+	}
+
+	uint64_t shownCount() const
+	{
+		return m_shownCount;
+	}
+
+	const PacketEntry& packet(size_t pos) const
+	{
+		return m_packets[pos];
+	}
+
+	const ChunkEntry& chunk(size_t pos) const
+	{
+		return m_chunks[pos];
+	}
+
+	// the position of the packet or chunk that contains the offset, None between them
+	size_t packetAt(uint64_t offset) const;
+	size_t chunkAt(uint64_t offset) const;
+
+	// positions [begin, end) of the packets or chunks that overlap [begin, end) in bytes
+	Range<size_t> packetsIn(uint64_t begin, uint64_t end) const;
+	Range<size_t> chunksIn(uint64_t begin, uint64_t end) const;
+
+private:
+	std::vector<PacketEntry> m_packets; // sorted by offset
+	std::vector<ChunkEntry> m_chunks;
+	uint64_t m_shownCount;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
+
+//-----------------------------------------------------------------------------------------------// 
+
+#endif
@@ -0,0 +1,353 @@
+//-----------------------------------------------------------------------------------------------// 
+// Pipeline.cpp
+//-----------------------------------------------------------------------------------------------// 
+
+#include <Decode.h>
+#include <Demux.h>
+#include <Pipeline.h>
+#include <SpscQueue.h>
+#include <ThreadPool.h>
+#include <Timer.h>
+#include <Trace.h>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// PipelineFrame
+//-----------------------------------------------------------------------------------------------// 
+
+PipelineFrame::PipelineFrame(PipelineFrame&& other)
+	: frameIdx(other.frameIdx)
+	, packetIdx(other.packetIdx)
+	, timestamp(other.timestamp)
+	, chunkIdx(other.chunkIdx)
+	, chunkBytes(other.chunkBytes)
+	, hasImage(other.hasImage)
+	, width(other.width)
+	, height(other.height)
+	, decodeTimings(other.decodeTimings)
+	, headers(std::move(other.headers))
+	, yuv(std::move(other.yuv))
+	, rgb(std::move(other.rgb))
+	, modeInfo(std::move(other.modeInfo))
+{
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+PipelineFrame& PipelineFrame::operator=(PipelineFrame&& other)
+{
+	frameIdx = other.frameIdx;
+	packetIdx = other.packetIdx;
+	timestamp = other.timestamp;
+	chunkIdx = other.chunkIdx;
+	chunkBytes = other.chunkBytes;
+	hasImage = other.hasImage;
+	width = other.width;
+	height = other.height;
+	decodeTimings = other.decodeTimings;
+	headers.swap(other.headers);
+	yuv = std::move(other.yuv);
+	rgb = std::move(other.rgb);
+	modeInfo = std::move(other.modeInfo);
+	return *this;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+I420Planes PipelineFrame::planes() const
+{
+	return i420Planes(yuv);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void PipelineFrame::assignPlanes(const I420Planes& src)
+{
+	width = src.width;
+	height = src.height;
+	copyI420(src, yuv);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// Pipeline state
+//-----------------------------------------------------------------------------------------------// 
+class DecodePipeline::State
+{
+public:
+	State(const PipelineOptions& options)
+		: options(options)
+		, packets(options.packetQueueSize)
+		, decoded(options.frameQueueSize)
+		, output(options.frameQueueSize)
+		, recycled(2 * options.frameQueueSize + 2)
+		, cancelled(false)
+		, demuxTicks(0)
+		, decodeTicks(0)
+		, convertTicks(0)
+		, packetCount(0)
+		, frameCount(0)
+	{
+		// there is nothing to convert without the planes
+		this->options.convert = options.convert && options.copyPlanes;
+	}
+
+	~State()
+	{
+		cancelled = true;
+		for(auto& rThread : threads)
+			rThread.join();
+	}
+
+	void demuxStage();
+	void decodeStage();
+	void convertStage();
+
+	// runs a stage, an error cancels the whole pipeline and is handed to the consumer
+	template<typename Func>
+	void runStage(Func func)
+	{
+		try
+		{
+			func();
+		}
+		catch(...)
+		{
+			std::lock_guard<std::mutex> lock(errorMutex);
+			if(!error)
+				error = std::current_exception();
+			cancelled = true;
+		}
+	}
+
+	PipelineOptions options;
+	Demuxer demuxer;
+	Decoder decoder; // only the codec, the packets come from the demux stage
+	std::unique_ptr<ThreadPool> pConvertPool;
+
+	SpscQueue<DemuxPacket> packets; // demux -> decode
+	SpscQueue<PipelineFrame> decoded; // decode -> convert
+	SpscQueue<PipelineFrame> output; // convert (or decode) -> consumer
+	SpscQueue<PipelineFrame> recycled; // consumer -> decode
+
+	std::vector<std::thread> threads;
+	std::atomic<bool> cancelled;
+	std::mutex errorMutex;
+	std::exception_ptr error;
+
+	std::atomic<int64_t> demuxTicks;
+	std::atomic<int64_t> decodeTicks;
+	std::atomic<int64_t> convertTicks;
+	std::atomic<uint64_t> packetCount;
+	std::atomic<uint64_t> frameCount;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+void DecodePipeline::State::demuxStage()
+{
+	setTraceThreadName("demux stage");
+	runStage([this]
+	{
+		DemuxPacket packet;
+		for(;;)
+		{
+			int64_t start = timeTicks();
+			bool valid = demuxer.readPacket(packet);
+			demuxTicks += timeTicks() - start;
+
+			if(!valid || !packets.push(packet, cancelled))
+				break;
+			packetCount++;
+		}
+	});
+	packets.close();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void DecodePipeline::State::decodeStage()
+{
+	setTraceThreadName("decode stage");
+	SpscQueue<PipelineFrame>& rNext = options.convert ? decoded : output;
+	runStage([&]
+	{
+		DemuxPacket packet;
+		FrameHeaderParser parser;
+		std::vector<FrameHeader> headers;
+		uint64_t frameIdx = 0;
+		while(packets.pop(packet, cancelled))
+		{
+			for(uint chunkIdx = 0; chunkIdx < packet.chunkCount(); chunkIdx++)
+			{
+				const uint8_t* pData = nullptr;
+				size_t size = 0;
+				packet.chunk(chunkIdx, pData, size);
+				headers.clear();
+				if(options.headers)
+					parser.parseChunk(pData, size, uint(packet.packetIdx), chunkIdx, headers);
+
+				int64_t start = timeTicks();
+				I420Planes planes;
+				DecodeTimings timings;
+				bool hasImage = decoder.decodeChunk(pData, size, &timings) && decoder.currentPlanes(planes);
+				if(!hasImage && !options.headers)
+				{
+					decodeTicks += timeTicks() - start;
+					continue;
+				}
+
+				// the codec reuses its frame buffers, so the planes are copied before handing
+				// them on, into the buffers of a recycled frame if there is one
+				PipelineFrame frame;
+				recycled.tryPop(frame);
+				frame.hasImage = hasImage;
+				frame.width = hasImage ? planes.width : 0;
+				frame.height = hasImage ? planes.height : 0;
+				if(hasImage && options.copyPlanes)
+					frame.assignPlanes(planes);
+				frame.frameIdx = hasImage ? frameIdx++ : frameIdx;
+				frame.packetIdx = packet.packetIdx;
+				frame.timestamp = packet.timestamp;
+				frame.chunkIdx = chunkIdx;
+				frame.chunkBytes = size;
+				frame.decodeTimings = timings;
+				frame.headers = headers;
+				if(hasImage && options.modeInfo)
+					decoder.currentModeInfo(frame.modeInfo);
+				decodeTicks += timeTicks() - start;
+
+				if(!rNext.push(frame, cancelled))
+					return;
+			}
+		}
+	});
+	rNext.close();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void DecodePipeline::State::convertStage()
+{
+	setTraceThreadName("convert stage");
+	runStage([this]
+	{
+		PipelineFrame frame;
+		while(decoded.pop(frame, cancelled))
+		{
+			if(frame.hasImage)
+			{
+				int64_t start = timeTicks();
+				convertI420(frame.planes(), frame.rgb, options.simdLevel, pConvertPool.get());
+				convertTicks += timeTicks() - start;
+			}
+
+			if(!output.push(frame, cancelled))
+				break;
+		}
+	});
+	output.close();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// DecodePipeline
+//-----------------------------------------------------------------------------------------------// 
+
+DecodePipeline::DecodePipeline()
+{
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+DecodePipeline::~DecodePipeline()
+{
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void DecodePipeline::openFile(std::string file, const PipelineOptions& options)
+{
+	// stops the stages of the previous file
+	m_pState.reset();
+
+	auto pState = std::make_unique<State>(options);
+	pState->demuxer.openFile(file, options.decoder.ioBackend);
+	pState->decoder.openCodec(options.decoder);
+
+	int convertThreads = options.convertThreads > 0 ? options.convertThreads : ThreadPool::hardwareThreads();
+	if(pState->options.convert && convertThreads > 1)
+		pState->pConvertPool = std::make_unique<ThreadPool>(convertThreads);
+
+	State* p = pState.get();
+	p->threads.emplace_back([p] { p->demuxStage(); });
+	p->threads.emplace_back([p] { p->decodeStage(); });
+	if(p->options.convert)
+		p->threads.emplace_back([p] { p->convertStage(); });
+
+	m_pState = std::move(pState);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool DecodePipeline::nextFrame(PipelineFrame& rFrame)
+{
+	if(!m_pState)
+		return false;
+
+	State& rState = *m_pState;
+	if(rState.output.pop(rFrame, rState.cancelled))
+	{
+		rState.frameCount++;
+		return true;
+	}
+
+	std::lock_guard<std::mutex> lock(rState.errorMutex);
+	if(rState.error)
+	{
+		std::exception_ptr error = rState.error;
+		rState.error = nullptr;
+		std::rethrow_exception(error);
+	}
+	return false;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void DecodePipeline::recycleFrame(PipelineFrame& rFrame)
+{
+	// a full queue just drops the frame
+	if(m_pState)
+		m_pState->recycled.tryPush(rFrame);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void DecodePipeline::cancel()
+{
+	if(m_pState)
+		m_pState->cancelled = true;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+PipelineStats DecodePipeline::stats() const
+{
+	PipelineStats stats;
+	if(m_pState)
+	{
+		const State& rState = *m_pState;
+		stats.demuxMs = ticksToMs(rState.demuxTicks);
+		stats.decodeMs = ticksToMs(rState.decodeTicks);
+		stats.convertMs = ticksToMs(rState.convertTicks);
+		stats.packetCount = rState.packetCount;
+		stats.frameCount = rState.frameCount;
+	}
+	return stats;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
\ No newline at end of file
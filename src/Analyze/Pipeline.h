@@ -0,0 +1,118 @@
+//-----------------------------------------------------------------------------------------------// 
+// Pipeline.h
+//-----------------------------------------------------------------------------------------------// 
+#ifndef MPX_ANALYZE_PIPELINE_H
+#define MPX_ANALYZE_PIPELINE_H
+
+#include <Color.h>
+#include <Convert.h>
+#include <Decode.h>
+#include <FrameBuf.h>
+#include <FrameHeader.h>
+#include <FrameModeInfo.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// Options for DecodePipeline.
+//-----------------------------------------------------------------------------------------------// 
+struct PipelineOptions
+{
+	int packetQueueSize = 32; // demuxed packets waiting for the decoder
+	int frameQueueSize = 4; // frames waiting for conversion and for the consumer
+	bool convert = true; // run the rgb conversion stage, needs copyPlanes
+	bool copyPlanes = true; // copy the decoded planes into PipelineFrame::yuv
+	bool modeInfo = false; // capture the mode info of every frame in the decode stage
+	bool headers = false; // parse the frame headers, every chunk is handed out then, with or without image
+	int convertThreads = 1; // pool size of the conversion stage, 0 == one per core
+	SimdLevel simdLevel = detectSimdLevel();
+	DecoderOptions decoder;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+// A frame handed out by the pipeline.
+//-----------------------------------------------------------------------------------------------// 
+struct PipelineFrame
+{
+	uint64_t frameIdx = 0; // of the image in decode order, that of the next image without one
+	uint64_t packetIdx = 0;
+	uint64_t timestamp = 0; // in ns
+	uint chunkIdx = 0; // in the packet
+	uint64_t chunkBytes = 0;
+	bool hasImage = false; // always true without PipelineOptions::headers
+	int width = 0;
+	int height = 0;
+	DecodeTimings decodeTimings; // of the chunk that produced the frame
+	std::vector<FrameHeader> headers; // of the chunk, only filled with PipelineOptions::headers
+	I420Frame yuv; // copy of the decoded planes, only filled with PipelineOptions::copyPlanes
+	FrameBuf<RGB8> rgb; // only filled with PipelineOptions::convert
+	FrameModeInfo modeInfo; // only filled with PipelineOptions::modeInfo
+
+	PipelineFrame() = default;
+	PipelineFrame(PipelineFrame&& other);
+	PipelineFrame& operator=(PipelineFrame&& other);
+
+	// the planes of yuv
+	I420Planes planes() const;
+
+	// copies the planes into yuv, reusing its memory
+	void assignPlanes(const I420Planes& src);
+
+private:
+	PipelineFrame(const PipelineFrame&) = delete;
+	PipelineFrame& operator=(const PipelineFrame&) = delete;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+// Busy time of the stages, without the time spent waiting on the queues.
+//-----------------------------------------------------------------------------------------------// 
+struct PipelineStats
+{
+	double demuxMs = 0;
+	double decodeMs = 0;
+	double convertMs = 0;
+	uint64_t packetCount = 0;
+	uint64_t frameCount = 0;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+// Decodes a file with demuxing, decoding and conversion on separate threads, connected by
+// bounded queues. A full queue stalls the stage in front of it, so at most a few frames are in
+// flight and the throughput is that of the slowest stage.
+//-----------------------------------------------------------------------------------------------// 
+class DecodePipeline
+{
+public:
+	DecodePipeline();
+	~DecodePipeline();
+
+	// starts the stages, a pipeline that is still running is cancelled first
+	void openFile(std::string file, const PipelineOptions& options = PipelineOptions());
+
+	// Next frame in decode order, blocks until it is available. Returns false at the end of
+	// the stream and after cancel(). Errors of the stages are rethrown here.
+	bool nextFrame(PipelineFrame& rFrame);
+
+	// hands a frame back so the stages can reuse its buffers
+	void recycleFrame(PipelineFrame& rFrame);
+
+	// stops all stages, can be called from any thread
+	void cancel();
+
+	PipelineStats stats() const;
+
+private:
+	class State;
+	std::unique_ptr<State> m_pState;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
+
+//-----------------------------------------------------------------------------------------------// 
+
+#endif
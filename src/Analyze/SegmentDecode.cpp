@@ -0,0 +1,62 @@
+//-----------------------------------------------------------------------------------------------// 
+// SegmentDecode.cpp
+//-----------------------------------------------------------------------------------------------// 
+
+#include <SegmentDecode.h>
+#include <ThreadPool.h>
+#include <Timer.h>
+#include <Utils.h>
+#include <algorithm>
+#include <atomic>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+
+void decodeSegments(std::string file, const FileIndex& index, const SegmentDecodeOptions& options,
+					const SegmentFrameVisitor& visitFrame, SegmentDecodeStats* pStats)
+{
+	const KeyFrameIndex& keyFrameIndex = index.keyFrameIndex;
+	if(!keyFrameIndex.exact())
+		throw DecoderError("Segmented decoding needs exact frame numbers");
+
+	Timer timer;
+	const std::vector<KeyFrame>& keyFrames = keyFrameIndex.keyFrames();
+	int segmentCount = int(keyFrames.size());
+	int threadCount = options.threadCount > 0 ? options.threadCount : ThreadPool::hardwareThreads();
+	threadCount = std::max(1, std::min(threadCount, segmentCount));
+
+	std::atomic<uint64_t> frameCount(0);
+	ThreadPool pool(threadCount);
+	pool.parallelFor(segmentCount, [&](int segmentIdx, int)
+	{
+		const KeyFrame& keyFrame = keyFrames[segmentIdx];
+		uint64_t endFrameIdx = segmentIdx + 1 < segmentCount ? keyFrames[segmentIdx + 1].frameIdx
+															 : keyFrameIndex.frameCount();
+
+		Decoder decoder;
+		decoder.openFile(file, options.decoder);
+		if(!decoder.seekToKeyFrame(keyFrame))
+			throw DecoderError(sprint("Keyframe of segment %d not found", segmentIdx));
+
+		while(uint64_t(decoder.currentFrameIdx() + 1) < endFrameIdx)
+		{
+			if(!decoder.decodeNextFrame())
+				throw DecoderError(sprint("Segment %d ended early", segmentIdx));
+			visitFrame(uint64_t(decoder.currentFrameIdx()), decoder);
+			frameCount++;
+		}
+	});
+
+	if(pStats)
+	{
+		pStats->ms = timer.elapsedMs();
+		pStats->frameCount = frameCount;
+		pStats->segmentCount = uint(segmentCount);
+		pStats->threadCount = pool.threadCount();
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
\ No newline at end of file
@@ -0,0 +1,70 @@
+//-----------------------------------------------------------------------------------------------// 
+// SegmentDecode.h
+//-----------------------------------------------------------------------------------------------// 
+#ifndef MPX_ANALYZE_SEGMENT_DECODE_H
+#define MPX_ANALYZE_SEGMENT_DECODE_H
+
+#include <Decode.h>
+#include <FileIndex.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// Options for decodeSegments().
+//-----------------------------------------------------------------------------------------------// 
+struct SegmentDecodeOptions
+{
+	SegmentDecodeOptions()
+	{
+		// the segments are the parallelism, more decoder threads would only compete with them
+		decoder.threadCount = 1;
+	}
+
+	int threadCount = 0; // segments decoded at the same time, 0 == one per core
+	DecoderOptions decoder;
+};
+
+struct SegmentDecodeStats
+{
+	double ms = 0;
+	uint64_t frameCount = 0;
+	uint segmentCount = 0;
+	int threadCount = 0;
+};
+
+// Called with each decoded frame, which is the current frame of the decoder. The frames of a
+// segment are visited in order on one thread, different segments run at the same time.
+using SegmentFrameVisitor = std::function<void(uint64_t frameIdx, const Decoder& decoder)>;
+
+//-----------------------------------------------------------------------------------------------// 
+// Decodes a whole file with the keyframes as cut points. Every segment from one keyframe to the
+// next is decoded independently with its own Decoder, on a pool with one segment per thread.
+// The index has to be exact, e.g. from buildFileIndex() or a sidecar.
+//-----------------------------------------------------------------------------------------------// 
+void decodeSegments(std::string file, const FileIndex& index, const SegmentDecodeOptions& options,
+					const SegmentFrameVisitor& visitFrame, SegmentDecodeStats* pStats = nullptr);
+
+// func(frameIdx, decoder) for every frame, the results are in presentation order
+template<typename T>
+std::vector<T> mapFrames(std::string file, const FileIndex& index, const SegmentDecodeOptions& options,
+						 const std::function<T(uint64_t, const Decoder&)>& func)
+{
+	// each frame has its own slot, so the segments don't need to synchronize
+	std::vector<T> results(size_t(index.keyFrameIndex.frameCount()));
+	decodeSegments(file, index, options, [&](uint64_t frameIdx, const Decoder& decoder)
+	{
+		results[size_t(frameIdx)] = func(frameIdx, decoder);
+	});
+	return results;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
+
+//-----------------------------------------------------------------------------------------------// 
+
+#endif
@@ -0,0 +1,441 @@
+//-----------------------------------------------------------------------------------------------// 
+// SyntheticClip.cpp
+//-----------------------------------------------------------------------------------------------// 
+
+#include <Decode.h>
+#include <SyntheticClip.h>
+#include <ThreadPool.h>
+#include <Utils.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <vpx/vp8cx.h>
+#include <vpx/vpx_encoder.h>
+
+#pragma warning (disable: 4996) // fopen
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// Minimal WebM writer. The whole file is built in memory, so the element sizes are known when
+// they are written. The segment has a SeekHead, so the Cues at the end are found without a scan.
+//-----------------------------------------------------------------------------------------------// 
+
+typedef std::vector<uint8_t> Bytes;
+
+static const uint32_t EbmlId = 0x1A45DFA3;
+static const uint32_t EbmlVersionId = 0x4286;
+static const uint32_t EbmlReadVersionId = 0x42F7;
+static const uint32_t EbmlMaxIdLengthId = 0x42F2;
+static const uint32_t EbmlMaxSizeLengthId = 0x42F3;
+static const uint32_t DocTypeId = 0x4282;
+static const uint32_t DocTypeVersionId = 0x4287;
+static const uint32_t DocTypeReadVersionId = 0x4285;
+static const uint32_t SegmentId = 0x18538067;
+static const uint32_t SeekHeadId = 0x114D9B74;
+static const uint32_t SeekId = 0x4DBB;
+static const uint32_t SeekIdId = 0x53AB;
+static const uint32_t SeekPositionId = 0x53AC;
+static const uint32_t InfoId = 0x1549A966;
+static const uint32_t TimecodeScaleId = 0x2AD7B1;
+static const uint32_t DurationId = 0x4489;
+static const uint32_t MuxingAppId = 0x4D80;
+static const uint32_t WritingAppId = 0x5741;
+static const uint32_t TracksId = 0x1654AE6B;
+static const uint32_t TrackEntryId = 0xAE;
+static const uint32_t TrackNumberId = 0xD7;
+static const uint32_t TrackUidId = 0x73C5;
+static const uint32_t TrackTypeId = 0x83;
+static const uint32_t CodecIdId = 0x86;
+static const uint32_t VideoId = 0xE0;
+static const uint32_t PixelWidthId = 0xB0;
+static const uint32_t PixelHeightId = 0xBA;
+static const uint32_t ClusterId = 0x1F43B675;
+static const uint32_t TimecodeId = 0xE7;
+static const uint32_t SimpleBlockId = 0xA3;
+static const uint32_t CuesId = 0x1C53BB6B;
+static const uint32_t CuePointId = 0xBB;
+static const uint32_t CueTimeId = 0xB3;
+static const uint32_t CueTrackPositionsId = 0xB7;
+static const uint32_t CueTrackId = 0xF7;
+static const uint32_t CueClusterPositionId = 0xF1;
+
+static void putBigEndian(Bytes& rOut, uint64_t value, int byteCount)
+{
+	for(int byteIdx = byteCount - 1; byteIdx >= 0; byteIdx--)
+		rOut.push_back(uint8_t(value >> (8 * byteIdx)));
+}
+
+static void putId(Bytes& rOut, uint32_t id)
+{
+	// the length marker is part of the id
+	int byteCount = id > 0xFFFFFF ? 4 : id > 0xFFFF ? 3 : id > 0xFF ? 2 : 1;
+	putBigEndian(rOut, id, byteCount);
+}
+
+static void putElement(Bytes& rOut, uint32_t id, const Bytes& payload)
+{
+	// sizes always take 8 bytes, which keeps the writer simple
+	putId(rOut, id);
+	rOut.push_back(0x01);
+	putBigEndian(rOut, payload.size(), 7);
+	rOut.insert(rOut.end(), payload.begin(), payload.end());
+}
+
+static void putUint(Bytes& rOut, uint32_t id, uint64_t value, int byteCount = 0)
+{
+	if(byteCount == 0)
+	{
+		byteCount = 1;
+		while(byteCount < 8 && (value >> (8 * byteCount)) != 0)
+			byteCount++;
+	}
+	putId(rOut, id);
+	rOut.push_back(uint8_t(0x80 | byteCount));
+	putBigEndian(rOut, value, byteCount);
+}
+
+static void putFloat(Bytes& rOut, uint32_t id, double value)
+{
+	uint64_t bits = 0;
+	memcpy(&bits, &value, sizeof(bits));
+	putId(rOut, id);
+	rOut.push_back(0x88);
+	putBigEndian(rOut, bits, 8);
+}
+
+static void putString(Bytes& rOut, uint32_t id, const char* pText)
+{
+	size_t length = strlen(pText);
+	putId(rOut, id);
+	rOut.push_back(uint8_t(0x80 | length));
+	rOut.insert(rOut.end(), pText, pText + length);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+class WebmWriter
+{
+public:
+	WebmWriter(int width, int height)
+		: m_width(width)
+		, m_height(height)
+		, m_clusterTimecode(0)
+		, m_durationMs(0)
+	{
+	}
+
+	void addFrame(const uint8_t* pData, size_t size, uint64_t timecodeMs, bool keyFrame)
+	{
+		// a new cluster at every keyframe, and before the 16 bit block timecode overflows
+		if(keyFrame || m_cluster.empty() || timecodeMs - m_clusterTimecode > 30000)
+		{
+			flushCluster();
+			m_clusterTimecode = timecodeMs;
+			putUint(m_cluster, TimecodeId, timecodeMs);
+			if(keyFrame)
+				m_cueTimes.push_back(timecodeMs);
+		}
+
+		Bytes block;
+		block.push_back(0x81); // track 1
+		putBigEndian(block, uint16_t(timecodeMs - m_clusterTimecode), 2);
+		block.push_back(keyFrame ? 0x80 : 0x00);
+		block.insert(block.end(), pData, pData + size);
+		putElement(m_cluster, SimpleBlockId, block);
+	}
+
+	void setDuration(double durationMs)
+	{
+		m_durationMs = durationMs;
+	}
+
+	void writeFile(const std::string& file)
+	{
+		flushCluster();
+
+		Bytes info;
+		putUint(info, TimecodeScaleId, 1000000); // ms
+		putFloat(info, DurationId, m_durationMs);
+		putString(info, MuxingAppId, "mpx");
+		putString(info, WritingAppId, "mpx");
+
+		Bytes video;
+		putUint(video, PixelWidthId, uint64_t(m_width));
+		putUint(video, PixelHeightId, uint64_t(m_height));
+		Bytes track;
+		putUint(track, TrackNumberId, 1);
+		putUint(track, TrackUidId, 1);
+		putUint(track, TrackTypeId, 1); // video
+		putString(track, CodecIdId, "V_VP9");
+		putElement(track, VideoId, video);
+		Bytes tracks;
+		putElement(tracks, TrackEntryId, track);
+
+		// positions are relative to the start of the segment data, the seek head has a fixed size
+		Bytes infoElement;
+		putElement(infoElement, InfoId, info);
+		Bytes tracksElement;
+		putElement(tracksElement, TracksId, tracks);
+		uint64_t seekHeadSize = seekHead(0, 0, 0).size();
+		uint64_t infoPos = seekHeadSize;
+		uint64_t tracksPos = infoPos + infoElement.size();
+		uint64_t clustersPos = tracksPos + tracksElement.size();
+		uint64_t cuesPos = clustersPos + m_clusters.size();
+
+		Bytes cues;
+		for(size_t cueIdx = 0; cueIdx < m_cueTimes.size(); cueIdx++)
+		{
+			Bytes position;
+			putUint(position, CueTrackId, 1);
+			putUint(position, CueClusterPositionId, clustersPos + m_cueClusterOffsets[cueIdx]);
+			Bytes point;
+			putUint(point, CueTimeId, m_cueTimes[cueIdx]);
+			putElement(point, CueTrackPositionsId, position);
+			putElement(cues, CuePointId, point);
+		}
+
+		Bytes segment = seekHead(infoPos, tracksPos, cuesPos);
+		segment.insert(segment.end(), infoElement.begin(), infoElement.end());
+		segment.insert(segment.end(), tracksElement.begin(), tracksElement.end());
+		segment.insert(segment.end(), m_clusters.begin(), m_clusters.end());
+		putElement(segment, CuesId, cues);
+
+		Bytes header;
+		putUint(header, EbmlVersionId, 1);
+		putUint(header, EbmlReadVersionId, 1);
+		putUint(header, EbmlMaxIdLengthId, 4);
+		putUint(header, EbmlMaxSizeLengthId, 8);
+		putString(header, DocTypeId, "webm");
+		putUint(header, DocTypeVersionId, 2);
+		putUint(header, DocTypeReadVersionId, 2);
+		Bytes out;
+		putElement(out, EbmlId, header);
+		putElement(out, SegmentId, segment);
+
+		FILE* pFile = fopen(file.c_str(), "wb");
+		if(!pFile)
+			throw DecoderError("Can't write " + file);
+		size_t written = fwrite(out.data(), 1, out.size(), pFile);
+		fclose(pFile);
+		if(written != out.size())
+			throw DecoderError("Can't write " + file);
+	}
+
+private:
+	void flushCluster()
+	{
+		if(m_cluster.empty())
+			return;
+
+		// the cue of the cluster's keyframe points at the cluster
+		if(m_cueClusterOffsets.size() < m_cueTimes.size())
+			m_cueClusterOffsets.push_back(m_clusters.size());
+		putElement(m_clusters, ClusterId, m_cluster);
+		m_cluster.clear();
+	}
+
+	static Bytes seekHead(uint64_t infoPos, uint64_t tracksPos, uint64_t cuesPos)
+	{
+		const uint32_t ids[] = { InfoId, TracksId, CuesId };
+		const uint64_t positions[] = { infoPos, tracksPos, cuesPos };
+		Bytes seeks;
+		for(int seekIdx = 0; seekIdx < 3; seekIdx++)
+		{
+			Bytes id;
+			putId(id, ids[seekIdx]);
+			Bytes seek;
+			putElement(seek, SeekIdId, id);
+			putUint(seek, SeekPositionId, positions[seekIdx], 8);
+			putElement(seeks, SeekId, seek);
+		}
+		Bytes element;
+		putElement(element, SeekHeadId, seeks);
+		return element;
+	}
+
+	int m_width;
+	int m_height;
+	Bytes m_cluster; // payload of the open cluster
+	Bytes m_clusters; // finished clusters
+	uint64_t m_clusterTimecode;
+	std::vector<uint64_t> m_cueTimes;
+	std::vector<uint64_t> m_cueClusterOffsets; // in m_clusters
+	double m_durationMs;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+// Content
+//-----------------------------------------------------------------------------------------------// 
+
+static void drawFrame(vpx_image_t& rImage, int frameIdx)
+{
+	int width = int(rImage.d_w);
+	int height = int(rImage.d_h);
+
+	// a texture panning to the lower right with a block bouncing across it
+	int panX = 3 * frameIdx;
+	int panY = frameIdx;
+	int blockSize = std::max(height / 4, 8);
+	int blockX = (frameIdx * 7) % std::max(width - blockSize, 1);
+	int blockY = (frameIdx * 5) % std::max(height - blockSize, 1);
+	for(int y = 0; y < height; y++)
+	{
+		uint8_t* pRow = rImage.planes[VPX_PLANE_Y] + y * rImage.stride[VPX_PLANE_Y];
+		int v = y + panY;
+		bool blockRow = y >= blockY && y < blockY + blockSize;
+		for(int x = 0; x < width; x++)
+		{
+			int u = x + panX;
+			int luma = ((u + v) & 0xFF) / 2 + (((u >> 4) ^ (v >> 4)) & 1) * 64 + ((u * v) >> 6 & 31);
+			if(blockRow && x >= blockX && x < blockX + blockSize)
+				luma = 235 - (luma >> 2);
+			pRow[x] = uint8_t(std::min(luma, 255));
+		}
+	}
+
+	int chromaWidth = (width + 1) / 2;
+	int chromaHeight = (height + 1) / 2;
+	for(int y = 0; y < chromaHeight; y++)
+	{
+		uint8_t* pU = rImage.planes[VPX_PLANE_U] + y * rImage.stride[VPX_PLANE_U];
+		uint8_t* pV = rImage.planes[VPX_PLANE_V] + y * rImage.stride[VPX_PLANE_V];
+		for(int x = 0; x < chromaWidth; x++)
+		{
+			pU[x] = uint8_t(64 + ((x + frameIdx) * 128 / chromaWidth & 127));
+			pV[x] = uint8_t(64 + ((y + 2 * frameIdx) * 128 / chromaHeight & 127));
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+static void checkEncoder(vpx_codec_ctx_t& rCodec, vpx_codec_err_t result, const char* pWhat)
+{
+	if(result != VPX_CODEC_OK)
+		throw DecoderError(sprint("%s: %s", pWhat, vpx_codec_error(&rCodec)));
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+// One pass over the frames. The first of two passes only collects the stats of the frames into
+// rStats, the others write the frames to pWriter.
+static void encodePass(vpx_codec_enc_cfg_t config, const SyntheticClipOptions& options,
+					   std::vector<uint8_t>& rStats, WebmWriter* pWriter)
+{
+	vpx_codec_ctx_t codec;
+	if(vpx_codec_enc_init(&codec, vpx_codec_vp9_cx(), &config, 0) != VPX_CODEC_OK)
+		throw DecoderError(sprint("Failed to initialize the encoder: %s", vpx_codec_error(&codec)));
+
+	try
+	{
+		// tiles are at least 256 pixels wide
+		int log2TileColumns = 0;
+		while((options.width >> (log2TileColumns + 1)) >= 256 && log2TileColumns < 6)
+			log2TileColumns++;
+		checkEncoder(codec, vpx_codec_control(&codec, VP8E_SET_CPUUSED, options.speed), "Failed to set the speed");
+		checkEncoder(codec, vpx_codec_control(&codec, VP9E_SET_TILE_COLUMNS, log2TileColumns),
+					 "Failed to set the tile columns");
+		checkEncoder(codec, vpx_codec_control(&codec, VP9E_SET_FRAME_PARALLEL_DECODING, 1),
+					 "Failed to set frame parallel mode");
+		if(options.altRef)
+		{
+			checkEncoder(codec, vpx_codec_control(&codec, VP8E_SET_ENABLEAUTOALTREF, 1),
+						 "Failed to enable alt-ref frames");
+		}
+
+		vpx_image_t image;
+		if(!vpx_img_alloc(&image, VPX_IMG_FMT_I420, uint(options.width), uint(options.height), 32))
+			throw DecoderError("Out of memory");
+
+		int frameRate = std::max(options.frameRate, 1);
+		try
+		{
+			// a null image at the end flushes the frames held back for the alt-ref
+			for(int frameIdx = 0;; frameIdx++)
+			{
+				bool flush = frameIdx >= options.frameCount;
+				if(!flush)
+					drawFrame(image, frameIdx);
+				checkEncoder(codec, vpx_codec_encode(&codec, flush ? nullptr : &image, frameIdx, 1, 0, VPX_DL_GOOD_QUALITY),
+							 "Failed to encode frame");
+
+				bool gotPacket = false;
+				vpx_codec_iter_t iter = nullptr;
+				while(const vpx_codec_cx_pkt_t* pPacket = vpx_codec_get_cx_data(&codec, &iter))
+				{
+					if(pPacket->kind == VPX_CODEC_STATS_PKT)
+					{
+						gotPacket = true;
+						const uint8_t* pStats = static_cast<const uint8_t*>(pPacket->data.twopass_stats.buf);
+						rStats.insert(rStats.end(), pStats, pStats + pPacket->data.twopass_stats.sz);
+					}
+					else if(pPacket->kind == VPX_CODEC_CX_FRAME_PKT && pWriter)
+					{
+						gotPacket = true;
+						uint64_t timecodeMs = uint64_t(pPacket->data.frame.pts) * 1000 / frameRate;
+						pWriter->addFrame(static_cast<const uint8_t*>(pPacket->data.frame.buf), pPacket->data.frame.sz,
+										  timecodeMs, (pPacket->data.frame.flags & VPX_FRAME_IS_KEY) != 0);
+					}
+				}
+				if(flush && !gotPacket)
+					break;
+			}
+		}
+		catch(...)
+		{
+			vpx_img_free(&image);
+			throw;
+		}
+		vpx_img_free(&image);
+	}
+	catch(...)
+	{
+		vpx_codec_destroy(&codec);
+		throw;
+	}
+	vpx_codec_destroy(&codec);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void encodeSyntheticClip(const std::string& file, const SyntheticClipOptions& options)
+{
+	vpx_codec_iface_t* pInterface = vpx_codec_vp9_cx();
+	vpx_codec_enc_cfg_t config;
+	if(vpx_codec_enc_config_default(pInterface, &config, 0) != VPX_CODEC_OK)
+		throw DecoderError("No VP9 encoder");
+
+	int frameRate = std::max(options.frameRate, 1);
+	config.g_w = uint(options.width);
+	config.g_h = uint(options.height);
+	config.g_timebase.num = 1;
+	config.g_timebase.den = frameRate;
+	config.g_threads = uint(options.threadCount > 0 ? options.threadCount : ThreadPool::hardwareThreads());
+	config.rc_target_bitrate = uint(options.bitrate > 0 ? options.bitrate
+														 : std::max(int64_t(options.width) * options.height * frameRate / 10000, int64_t(100)));
+	config.kf_mode = VPX_KF_AUTO;
+	config.kf_min_dist = uint(options.keyFrameInterval);
+	config.kf_max_dist = uint(options.keyFrameInterval);
+
+	// the one pass mode of libvpx 1.3.0 never places alt-ref frames, the second of two passes does
+	std::vector<uint8_t> stats;
+	if(options.altRef)
+	{
+		config.g_pass = VPX_RC_FIRST_PASS;
+		encodePass(config, options, stats, nullptr);
+		config.g_pass = VPX_RC_LAST_PASS;
+		config.rc_twopass_stats_in.buf = stats.data();
+		config.rc_twopass_stats_in.sz = stats.size();
+	}
+
+	WebmWriter writer(options.width, options.height);
+	writer.setDuration(options.frameCount * 1000.0 / frameRate);
+	encodePass(config, options, stats, &writer);
+	writer.writeFile(file);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
\ No newline at end of file
@@ -0,0 +1,43 @@
+//-----------------------------------------------------------------------------------------------// 
+// SyntheticClip.h
+//-----------------------------------------------------------------------------------------------// 
+#ifndef MPX_ANALYZE_SYNTHETIC_CLIP_H
+#define MPX_ANALYZE_SYNTHETIC_CLIP_H
+
+#include <Include.h>
+#include <string>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// Options for encodeSyntheticClip().
+//-----------------------------------------------------------------------------------------------// 
+struct SyntheticClipOptions
+{
+	int width = 640;
+	int height = 360;
+	int frameCount = 60;
+	int frameRate = 30;
+	int keyFrameInterval = 30; // in frames, the segments of a parallel decode
+	int bitrate = 0; // in kbit/s, 0 == picked from the size
+	int speed = 6; // cpu-used of the encoder, higher is faster and worse
+	int threadCount = 0; // encoder threads, 0 == one per core
+	bool altRef = false; // hidden alt-ref frames in superframes, encodes in two passes
+};
+
+//-----------------------------------------------------------------------------------------------// 
+// Encodes a generated clip to a WebM file with the VP9 encoder of the bundled libvpx, so
+// benchmarks run on the same streams everywhere without test files. The content is a
+// deterministic pattern that pans and has a moving block, which gives the encoder motion and
+// detail to code. The stream uses as many tile columns as the width allows and frame parallel
+// mode, so libvpx can decode it on several threads. Throws DecoderError if encoding fails.
+//-----------------------------------------------------------------------------------------------// 
+void encodeSyntheticClip(const std::string& file, const SyntheticClipOptions& options);
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
+
+//-----------------------------------------------------------------------------------------------// 
+
+#endif
@@ -0,0 +1,340 @@
+//-----------------------------------------------------------------------------------------------// 
+// Thumbnails.cpp
+//-----------------------------------------------------------------------------------------------// 
+
+#include <FileIndex.h>
+#include <KeyFrameIndex.h>
+#include <SpscQueue.h>
+#include <Thumbnails.h>
+#include <Trace.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+
+void thumbnailSize(int width, int height, int maxWidth, int maxHeight, int& rWidth, int& rHeight)
+{
+	rWidth = std::min(width, maxWidth);
+	rHeight = std::min(height, maxHeight);
+	if(width > 0 && height > 0)
+	{
+		// the side that has to shrink more decides
+		if(int64_t(rWidth) * height < int64_t(rHeight) * width)
+			rHeight = int((int64_t(rWidth) * height + width / 2) / width);
+		else
+			rWidth = int((int64_t(rHeight) * width + height / 2) / height);
+	}
+	rWidth = std::max(rWidth, 1);
+	rHeight = std::max(rHeight, 1);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void scalePlaneBox(const PlaneView<const uint8_t>& src, const PlaneView<uint8_t>& dest)
+{
+	if(src.empty() || dest.empty())
+		return;
+
+	// source columns of each destination column, at least one when scaling up
+	std::vector<int> cols(dest.width() + 1);
+	for(int x = 0; x <= dest.width(); x++)
+		cols[x] = int(int64_t(x) * src.width() / dest.width());
+
+	std::vector<uint32_t> colSums(src.width());
+	for(int y = 0; y < dest.height(); y++)
+	{
+		int row0 = int(int64_t(y) * src.height() / dest.height());
+		int row1 = std::max(int(int64_t(y + 1) * src.height() / dest.height()), row0 + 1);
+
+		std::fill(colSums.begin(), colSums.end(), 0);
+		for(int srcY = row0; srcY < row1; srcY++)
+		{
+			const uint8_t* pSrc = src.row(srcY);
+			uint32_t* pSums = colSums.data();
+			for(int x = 0; x < src.width(); x++)
+				pSums[x] += pSrc[x];
+		}
+
+		uint8_t* pDest = dest.row(y);
+		for(int x = 0; x < dest.width(); x++)
+		{
+			int col0 = cols[x];
+			int col1 = std::max(cols[x + 1], col0 + 1);
+			uint32_t sum = 0;
+			for(int col = col0; col < col1; col++)
+				sum += colSums[col];
+			uint32_t count = uint32_t((col1 - col0) * (row1 - row0));
+			pDest[x] = uint8_t((sum + count / 2) / count);
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void scaleI420(const I420Planes& src, I420Frame& rDest)
+{
+	for(int planeIdx = 0; planeIdx < 3; planeIdx++)
+		scalePlaneBox(src.plane(planeIdx), rDest.plane(planeIdx));
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// Generator state
+//-----------------------------------------------------------------------------------------------// 
+class ThumbnailGenerator::State
+{
+public:
+	State(std::string file, const ThumbnailOptions& options)
+		: file(file)
+		, options(options)
+		, thumbnails(std::max(options.queueSize, 1))
+		, cancelled(false)
+		, stopped(false)
+		, produced(0)
+		, taken(0)
+	{
+	}
+
+	~State()
+	{
+		cancel();
+		if(worker.joinable())
+			worker.join();
+	}
+
+	void cancel()
+	{
+		{
+			std::lock_guard<std::mutex> lock(indexMutex);
+			cancelled = true;
+		}
+		indexReady.notify_one();
+	}
+
+	void run();
+
+	// the handed in index, or without scanForIndex the one of a sidecar or scan, an empty one once
+	// cancelled
+	std::shared_ptr<const KeyFrameIndex> waitForIndex();
+
+	// scales the current frame of the decoder and queues it, false once cancelled
+	bool addThumbnail(const Decoder& decoder, uint64_t frameIdx);
+
+	std::string file;
+	ThumbnailOptions options;
+	I420Frame scaled; // reused for every frame
+
+	SpscQueue<Thumbnail> thumbnails;
+	std::atomic<bool> cancelled;
+	std::atomic<bool> stopped;
+	std::atomic<uint64_t> produced;
+	std::atomic<uint64_t> taken;
+	mutable std::mutex errorMutex;
+	std::exception_ptr error;
+	std::mutex indexMutex;
+	std::condition_variable indexReady;
+	std::shared_ptr<const KeyFrameIndex> pIndex; // handed in, guarded by the indexMutex
+	std::thread worker;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool ThumbnailGenerator::State::addThumbnail(const Decoder& decoder, uint64_t frameIdx)
+{
+	I420Planes planes;
+	if(!decoder.currentPlanes(planes))
+		return true;
+
+	int width = 0;
+	int height = 0;
+	thumbnailSize(planes.width, planes.height, options.maxWidth, options.maxHeight, width, height);
+	scaled.setSize(width, height);
+	scaleI420(planes, scaled);
+
+	// only the small image is converted
+	Thumbnail thumbnail;
+	thumbnail.frameIdx = frameIdx;
+	convertI420(i420Planes(scaled), thumbnail.image, options.simdLevel);
+	if(!thumbnails.push(thumbnail, cancelled))
+		return false;
+	produced++;
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+std::shared_ptr<const KeyFrameIndex> ThumbnailGenerator::State::waitForIndex()
+{
+	std::unique_lock<std::mutex> lock(indexMutex);
+	if(!pIndex && options.scanForIndex)
+	{
+		lock.unlock();
+		return loadKeyFrameIndex(file, options.decoder.ioBackend);
+	}
+
+	indexReady.wait(lock, [this] { return pIndex || cancelled; });
+	return pIndex ? pIndex : std::make_shared<KeyFrameIndex>();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void ThumbnailGenerator::State::run()
+{
+	setTraceThreadName("thumbnails");
+	try
+	{
+		Decoder decoder;
+		decoder.openFile(file, options.decoder);
+		std::shared_ptr<const KeyFrameIndex> pIndex;
+		if(options.keyFramesOnly || options.maxThumbnails > 0)
+		{
+			pIndex = waitForIndex();
+			decoder.setKeyFrameIndex(pIndex);
+		}
+
+		if(options.keyFramesOnly)
+		{
+			// seeking from keyframe to keyframe skips the decoding of everything in between
+			const std::vector<KeyFrame>& keyFrames = pIndex->keyFrames();
+			size_t step = 1;
+			if(options.maxThumbnails > 0)
+				step = std::max(size_t(1), size_t((keyFrames.size() + options.maxThumbnails - 1) / options.maxThumbnails));
+			for(size_t keyFramePos = 0; keyFramePos < keyFrames.size() && !cancelled; keyFramePos += step)
+			{
+				const KeyFrame& keyFrame = keyFrames[keyFramePos];
+				if(!decoder.seekToKeyFrame(keyFrame) || !decoder.decodeNextFrame())
+					continue;
+				if(!addThumbnail(decoder, keyFrame.frameIdx))
+					break;
+			}
+		}
+		else if(options.maxThumbnails > 0)
+		{
+			// seekToFrame() decodes on within a keyframe's frames and seeks past longer gaps
+			uint64_t frameCount = pIndex->frameCount();
+			uint64_t step = std::max(uint64_t(std::max(options.frameStep, 1)),
+									 (frameCount + options.maxThumbnails - 1) / options.maxThumbnails);
+			for(uint64_t frameIdx = 0; frameIdx < frameCount && !cancelled; frameIdx += step)
+			{
+				if(!decoder.seekToFrame(frameIdx))
+					break;
+				if(!addThumbnail(decoder, frameIdx))
+					break;
+			}
+		}
+		else
+		{
+			uint64_t step = uint64_t(std::max(options.frameStep, 1));
+			for(uint64_t frameIdx = 0; !cancelled && decoder.decodeNextFrame(); frameIdx++)
+			{
+				if(frameIdx % step == 0 && !addThumbnail(decoder, frameIdx))
+					break;
+			}
+		}
+	}
+	catch(...)
+	{
+		std::lock_guard<std::mutex> lock(errorMutex);
+		error = std::current_exception();
+	}
+	thumbnails.close();
+	stopped = true;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// ThumbnailGenerator
+//-----------------------------------------------------------------------------------------------// 
+
+ThumbnailGenerator::ThumbnailGenerator()
+{
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+ThumbnailGenerator::~ThumbnailGenerator()
+{
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void ThumbnailGenerator::openFile(std::string file, const ThumbnailOptions& options)
+{
+	// stops the job of the previous file
+	m_pState.reset();
+
+	auto pState = std::make_unique<State>(file, options);
+	State* p = pState.get();
+	p->worker = std::thread([p] { p->run(); });
+	m_pState = std::move(pState);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool ThumbnailGenerator::nextThumbnail(Thumbnail& rThumbnail)
+{
+	if(!m_pState)
+		return false;
+
+	State& rState = *m_pState;
+	if(rState.thumbnails.tryPop(rThumbnail))
+	{
+		rState.taken++;
+		return true;
+	}
+
+	std::lock_guard<std::mutex> lock(rState.errorMutex);
+	if(rState.error)
+	{
+		std::exception_ptr error = rState.error;
+		rState.error = nullptr;
+		std::rethrow_exception(error);
+	}
+	return false;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool ThumbnailGenerator::done() const
+{
+	if(!m_pState)
+		return true;
+
+	// stopped is set after the last push, so the counts are final once it is seen. A pending
+	// error keeps the job open until nextThumbnail() has thrown it.
+	const State& rState = *m_pState;
+	std::lock_guard<std::mutex> lock(rState.errorMutex);
+	return rState.stopped && rState.taken == rState.produced && !rState.error;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void ThumbnailGenerator::setKeyFrameIndex(std::shared_ptr<const KeyFrameIndex> pIndex)
+{
+	if(!m_pState)
+		return;
+
+	State& rState = *m_pState;
+	{
+		std::lock_guard<std::mutex> lock(rState.indexMutex);
+		rState.pIndex = pIndex;
+	}
+	rState.indexReady.notify_one();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void ThumbnailGenerator::cancel()
+{
+	if(m_pState)
+		m_pState->cancel();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
\ No newline at end of file
@@ -0,0 +1,118 @@
+//-----------------------------------------------------------------------------------------------// 
+// Thumbnails.h
+//-----------------------------------------------------------------------------------------------// 
+#ifndef MPX_ANALYZE_THUMBNAILS_H
+#define MPX_ANALYZE_THUMBNAILS_H
+
+#include <Color.h>
+#include <Convert.h>
+#include <Decode.h>
+#include <FrameBuf.h>
+#include <memory>
+#include <string>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// Options for ThumbnailGenerator.
+//-----------------------------------------------------------------------------------------------// 
+struct ThumbnailOptions
+{
+	int maxWidth = 160; // the thumbnails keep the aspect ratio of the frame and fit into this
+	int maxHeight = 90;
+	int frameStep = 1; // a thumbnail of every nth frame, all frames are still decoded
+	bool keyFramesOnly = false; // only decodes the keyframes, for a quick overview of long files
+
+	// At most this many thumbnails of the clip, 0 == no limit. frameStep is raised to fit, and
+	// keyFramesOnly takes every nth keyframe. With a step longer than the keyframe distance, the
+	// frames in between aren't decoded.
+	uint64_t maxThumbnails = 0;
+
+	// keyFramesOnly and maxThumbnails need the keyframe index of the file. Without one handed in
+	// with setKeyFrameIndex(), the worker reads the sidecar or scans the file for it. Off if
+	// another pass scans anyway, e.g. an AnalysisJob: the worker waits for its index then.
+	bool scanForIndex = true;
+	int queueSize = 64; // thumbnails waiting for the consumer, the worker stalls beyond this
+	SimdLevel simdLevel = detectSimdLevel();
+	DecoderOptions decoder;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+// A downscaled frame.
+//-----------------------------------------------------------------------------------------------// 
+struct Thumbnail
+{
+	uint64_t frameIdx = 0; // in shown frames, as Decoder counts them
+	FrameBuf<RGB8> image;
+
+	Thumbnail() = default;
+	Thumbnail(const Thumbnail&) = default;
+
+	Thumbnail(Thumbnail&& other)
+		: frameIdx(other.frameIdx)
+		, image(std::move(other.image))
+	{
+	}
+
+	Thumbnail& operator=(Thumbnail other)
+	{
+		frameIdx = other.frameIdx;
+		image.swap(other.image);
+		return *this;
+	}
+};
+
+//-----------------------------------------------------------------------------------------------// 
+// Downscaling of the decoded planes, so a thumbnail never needs the frame in RGB.
+//-----------------------------------------------------------------------------------------------// 
+
+// Size that fits into maxWidth x maxHeight with the aspect ratio of width x height. Never larger
+// than the frame and at least 1x1.
+void thumbnailSize(int width, int height, int maxWidth, int maxHeight, int& rWidth, int& rHeight);
+
+// Area average over the source pixels of each destination pixel, for any ratio of the sizes.
+// Every source pixel is read once, the column sums run in a loop the compiler vectorizes.
+void scalePlaneBox(const PlaneView<const uint8_t>& src, const PlaneView<uint8_t>& dest);
+
+// scales all three planes, rDest keeps its size
+void scaleI420(const I420Planes& src, I420Frame& rDest);
+
+//-----------------------------------------------------------------------------------------------// 
+// Makes thumbnails of a whole clip on a background thread. They are handed out in frame order
+// as they are done, so a view can fill in while the clip is still decoding. Opening another
+// file or destroying the generator cancels the running job.
+//-----------------------------------------------------------------------------------------------// 
+class ThumbnailGenerator
+{
+public:
+	ThumbnailGenerator();
+	~ThumbnailGenerator();
+
+	// starts a job, one that is still running is cancelled first
+	void openFile(std::string file, const ThumbnailOptions& options = ThumbnailOptions());
+
+	// Takes the next thumbnail if one is ready, doesn't block. Errors of the worker are
+	// rethrown here.
+	bool nextThumbnail(Thumbnail& rThumbnail);
+
+	// the job has stopped and all its thumbnails and its error are taken, true without a job
+	bool done() const;
+
+	// the keyframes of the file from elsewhere, see ThumbnailOptions::scanForIndex
+	void setKeyFrameIndex(std::shared_ptr<const KeyFrameIndex> pIndex);
+
+	// stops the job, can be called from any thread
+	void cancel();
+
+private:
+	class State;
+	std::unique_ptr<State> m_pState;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
+
+//-----------------------------------------------------------------------------------------------// 
+
+#endif
@@ -0,0 +1,402 @@
+//-----------------------------------------------------------------------------------------------// 
+// ByteSource.cpp
+//-----------------------------------------------------------------------------------------------// 
+
+#include <ByteSource.h>
+#include <Trace.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#pragma warning (disable: 4996) // shut up safety warning
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// 64 bit stdio seeking, fseek only takes a long which is 32 bit on windows
+//-----------------------------------------------------------------------------------------------// 
+
+static bool seekFile(FILE* pFile, uint64_t offset, int origin = SEEK_SET)
+{
+#if defined(_WIN32)
+	return _fseeki64(pFile, int64_t(offset), origin) == 0;
+#else
+	return fseeko(pFile, off_t(offset), origin) == 0;
+#endif
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+static uint64_t tellFile(FILE* pFile)
+{
+#if defined(_WIN32)
+	return uint64_t(_ftelli64(pFile));
+#else
+	return uint64_t(ftello(pFile));
+#endif
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+static bool fileSize(FILE* pFile, uint64_t& rSize)
+{
+	if(!seekFile(pFile, 0, SEEK_END))
+		return false;
+	rSize = tellFile(pFile);
+	return seekFile(pFile, 0);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// Stdio
+//-----------------------------------------------------------------------------------------------// 
+class StdioSource : public ByteSource
+{
+public:
+	StdioSource(FILE* pFile, uint64_t size)
+		: m_pFile(pFile)
+		, m_size(size)
+	{}
+
+	~StdioSource()
+	{
+		fclose(m_pFile);
+	}
+
+	size_t read(void* pDest, size_t size)
+	{
+		return fread(pDest, 1, size, m_pFile);
+	}
+
+	bool seek(uint64_t offset)
+	{
+		return seekFile(m_pFile, offset);
+	}
+
+	uint64_t tell() const
+	{
+		return tellFile(m_pFile);
+	}
+
+	uint64_t size() const
+	{
+		return m_size;
+	}
+
+private:
+	FILE* m_pFile;
+	uint64_t m_size;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+// Memory map
+//-----------------------------------------------------------------------------------------------// 
+class MappedSource : public ByteSource
+{
+public:
+	~MappedSource()
+	{
+#if defined(_WIN32)
+		if(m_pData)
+			UnmapViewOfFile(m_pData);
+		if(m_hMapping)
+			CloseHandle(m_hMapping);
+		if(m_hFile != INVALID_HANDLE_VALUE)
+			CloseHandle(m_hFile);
+#else
+		if(m_pData)
+			munmap(const_cast<uint8_t*>(m_pData), size_t(m_size));
+		if(m_fd >= 0)
+			close(m_fd);
+#endif
+	}
+
+	bool open(const std::string& file)
+	{
+#if defined(_WIN32)
+		m_hFile = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+							  FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if(m_hFile == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size;
+		if(!GetFileSizeEx(m_hFile, &size))
+			return false;
+		m_size = uint64_t(size.QuadPart);
+		if(m_size == 0)
+			return true; // empty files can't be mapped
+
+		m_hMapping = CreateFileMappingA(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if(!m_hMapping)
+			return false;
+
+		m_pData = static_cast<const uint8_t*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+		return m_pData != nullptr;
+#else
+		m_fd = ::open(file.c_str(), O_RDONLY);
+		if(m_fd < 0)
+			return false;
+
+		struct stat info;
+		if(fstat(m_fd, &info))
+			return false;
+		m_size = uint64_t(info.st_size);
+		if(m_size == 0)
+			return true;
+
+		void* pData = mmap(nullptr, size_t(m_size), PROT_READ, MAP_PRIVATE, m_fd, 0);
+		if(pData == MAP_FAILED)
+			return false;
+		madvise(pData, size_t(m_size), MADV_SEQUENTIAL);
+		m_pData = static_cast<const uint8_t*>(pData);
+		return true;
+#endif
+	}
+
+	size_t read(void* pDest, size_t size)
+	{
+		size = size_t(std::min<uint64_t>(size, m_size - m_pos));
+		if(size)
+			memcpy(pDest, m_pData + m_pos, size);
+		m_pos += size;
+		return size;
+	}
+
+	bool seek(uint64_t offset)
+	{
+		if(offset > m_size)
+			return false;
+		m_pos = offset;
+		return true;
+	}
+
+	uint64_t tell() const
+	{
+		return m_pos;
+	}
+
+	uint64_t size() const
+	{
+		return m_size;
+	}
+
+	const uint8_t* view(size_t size)
+	{
+		if(size > m_size - m_pos)
+			return nullptr;
+		const uint8_t* pData = m_pData + m_pos;
+		m_pos += size;
+		return pData;
+	}
+
+private:
+#if defined(_WIN32)
+	HANDLE m_hFile = INVALID_HANDLE_VALUE;
+	HANDLE m_hMapping = nullptr;
+#else
+	int m_fd = -1;
+#endif
+	const uint8_t* m_pData = nullptr;
+	uint64_t m_size = 0;
+	uint64_t m_pos = 0;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+// Read-ahead
+//-----------------------------------------------------------------------------------------------// 
+class ReadAheadSource : public ByteSource
+{
+public:
+	static const size_t BlockSize = 4 << 20;
+
+	ReadAheadSource(FILE* pFile, uint64_t size)
+		: m_pFile(pFile)
+		, m_size(size)
+	{
+		// the blocks are the buffering
+		setvbuf(m_pFile, nullptr, _IONBF, 0);
+	}
+
+	~ReadAheadSource()
+	{
+		if(m_prefetch.valid())
+			m_prefetch.wait();
+		fclose(m_pFile);
+	}
+
+	size_t read(void* pDest, size_t size)
+	{
+		uint8_t* pDest8 = static_cast<uint8_t*>(pDest);
+		size_t done = 0;
+		while(done < size && m_pos < m_size)
+		{
+			if(m_pos < m_current.offset || m_pos >= m_current.offset + m_current.data.size())
+			{
+				if(!loadBlock(m_pos - m_pos % BlockSize))
+					break;
+			}
+
+			size_t blockPos = size_t(m_pos - m_current.offset);
+			size_t count = std::min(size - done, m_current.data.size() - blockPos);
+			memcpy(pDest8 + done, m_current.data.data() + blockPos, count);
+			done += count;
+			m_pos += count;
+		}
+		return done;
+	}
+
+	bool seek(uint64_t offset)
+	{
+		if(offset > m_size)
+			return false;
+		m_pos = offset;
+		return true;
+	}
+
+	uint64_t tell() const
+	{
+		return m_pos;
+	}
+
+	uint64_t size() const
+	{
+		return m_size;
+	}
+
+private:
+	struct Block
+	{
+		uint64_t offset = 0;
+		std::vector<uint8_t> data;
+	};
+
+	bool readBlock(Block& rBlock, uint64_t offset)
+	{
+		MPX_TRACE_SCOPE("read-ahead block");
+		rBlock.offset = offset;
+		rBlock.data.resize(size_t(std::min<uint64_t>(BlockSize, m_size - offset)));
+		return seekFile(m_pFile, offset) &&
+			   fread(rBlock.data.data(), 1, rBlock.data.size(), m_pFile) == rBlock.data.size();
+	}
+
+	bool loadBlock(uint64_t offset)
+	{
+		bool valid = false;
+		if(m_prefetch.valid())
+		{
+			MPX_TRACE_SCOPE("read-ahead wait");
+			bool prefetched = m_prefetch.get();
+			if(prefetched && m_next.offset == offset)
+			{
+				std::swap(m_current, m_next);
+				valid = true;
+			}
+		}
+		if(!valid && !readBlock(m_current, offset))
+		{
+			m_current.data.clear();
+			return false;
+		}
+
+		// scans mostly go forward, fetch the following block while this one is consumed
+		uint64_t nextOffset = offset + BlockSize;
+		if(nextOffset < m_size)
+			m_prefetch = std::async(std::launch::async, [this, nextOffset] { return readBlock(m_next, nextOffset); });
+		return true;
+	}
+
+	FILE* m_pFile;
+	uint64_t m_size;
+	uint64_t m_pos = 0;
+	Block m_current;
+	Block m_next; // owned by the prefetch while it runs
+	std::future<bool> m_prefetch;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+const char* toString(IoBackend backend)
+{
+	switch(backend)
+	{
+	case IoBackend::Stdio:
+		return "stdio";
+	case IoBackend::MemoryMap:
+		return "mmap";
+	case IoBackend::ReadAhead:
+		return "readahead";
+	}
+	return "unknown";
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+std::unique_ptr<ByteSource> openByteSource(const std::string& file, IoBackend backend)
+{
+	if(backend == IoBackend::MemoryMap)
+	{
+		// held as a ByteSource already, so it is moved out on return without a conversion
+		std::unique_ptr<ByteSource> pSource = std::make_unique<MappedSource>();
+		if(!static_cast<MappedSource&>(*pSource).open(file))
+			return nullptr;
+		return pSource;
+	}
+
+	FILE* pFile = fopen(file.c_str(), "rb");
+	if(!pFile)
+		return nullptr;
+
+	uint64_t size = 0;
+	if(!fileSize(pFile, size))
+	{
+		fclose(pFile);
+		return nullptr;
+	}
+
+	if(backend == IoBackend::ReadAhead)
+		return std::make_unique<ReadAheadSource>(pFile, size);
+	return std::make_unique<StdioSource>(pFile, size);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool fileStamp(const std::string& file, uint64_t& rSize, int64_t& rWriteTime)
+{
+#if defined(_WIN32)
+	WIN32_FILE_ATTRIBUTE_DATA info;
+	if(!GetFileAttributesExA(file.c_str(), GetFileExInfoStandard, &info))
+		return false;
+	rSize = (uint64_t(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+	// FILETIME counts 100 ns since 1601
+	int64_t fileTime = int64_t((uint64_t(info.ftLastWriteTime.dwHighDateTime) << 32) | info.ftLastWriteTime.dwLowDateTime);
+	rWriteTime = (fileTime - 116444736000000000ll) * 100;
+#else
+	struct stat info;
+	if(stat(file.c_str(), &info))
+		return false;
+	rSize = uint64_t(info.st_size);
+#if defined(__APPLE__)
+	const struct timespec& writeTime = info.st_mtimespec;
+#else
+	const struct timespec& writeTime = info.st_mtim;
+#endif
+	rWriteTime = int64_t(writeTime.tv_sec) * 1000000000 + writeTime.tv_nsec;
+#endif
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
\ No newline at end of file
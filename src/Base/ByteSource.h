@@ -0,0 +1,59 @@
+//-----------------------------------------------------------------------------------------------// 
+// ByteSource.h
+//-----------------------------------------------------------------------------------------------// 
+#ifndef MPX_BASE_BYTE_SOURCE_H
+#define MPX_BASE_BYTE_SOURCE_H
+
+#include <Include.h>
+#include <memory>
+#include <string>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// Sequential reader with seeking, all offsets are 64 bit.
+//-----------------------------------------------------------------------------------------------// 
+class ByteSource
+{
+public:
+	virtual ~ByteSource() {}
+
+	// reads up to size bytes, returns the number of bytes read
+	virtual size_t read(void* pDest, size_t size) = 0;
+
+	virtual bool seek(uint64_t offset) = 0;
+	virtual uint64_t tell() const = 0;
+	virtual uint64_t size() const = 0;
+
+	// Zero-copy read of the next size bytes. Returns null if the source has no contiguous view
+	// of them, the position is unchanged then. The memory lives as long as the source.
+	virtual const uint8_t* view(size_t)
+	{
+		return nullptr;
+	}
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+enum class IoBackend
+{
+	Stdio, // buffered stdio reads
+	MemoryMap, // maps the whole file, reads are views into the mapping
+	ReadAhead, // reads large blocks and fetches the next one in the background
+};
+
+const char* toString(IoBackend backend);
+
+// null if the file can't be opened
+std::unique_ptr<ByteSource> openByteSource(const std::string& file, IoBackend backend);
+
+// size and last write time of a file, the time in ns since 1970 with the file system's resolution
+bool fileStamp(const std::string& file, uint64_t& rSize, int64_t& rWriteTime);
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
+
+//-----------------------------------------------------------------------------------------------// 
+
+#endif
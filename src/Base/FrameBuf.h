@@ -4,123 +4,176 @@
 #ifndef MPX_BASE_FRAME_BUF_H
 #define MPX_BASE_FRAME_BUF_H
 
-#include <vector>
+#include <FramePool.h>
+#include <ImageView.h>
+#include <cstring>
+#include <type_traits>
+#include <utility>
 
 //------------------------------------------------------------------------------------------------//
 
 namespace mpx {
 
 //------------------------------------------------------------------------------------------------//
-// Buffer for frame data.
+// Buffer for frame data. Every row starts FrameAlignment aligned, so rows are padded to stride()
+// bytes. The memory comes from an allocator, by default the shared FramePool, and setSize()
+// neither clears it nor reallocates if the new size fits.
 //------------------------------------------------------------------------------------------------//
 template<typename T>
 class FrameBuf
 {
+	static_assert(std::is_pod<T>::value, "FrameBuf leaves its pixels uninitialized");
+
 public:
 	FrameBuf() = default;
 
-	FrameBuf(int width, int height) 
-		: m_data(width * height)
-		, m_width(width)
-		, m_height(height) 
+	explicit FrameBuf(FrameAllocator& rAllocator)
+		: m_pAllocator(&rAllocator)
 	{}
 
+	FrameBuf(int width, int height, FrameAllocator& rAllocator = FramePool::shared())
+		: m_pAllocator(&rAllocator)
+	{
+		setSize(width, height);
+	}
+
+	FrameBuf(const FrameBuf& other)
+		: m_pAllocator(other.m_pAllocator)
+	{
+		setSize(other.m_width, other.m_height);
+		for(int y = 0; y < m_height; y++)
+			memcpy(row(y), other.row(y), m_width * sizeof(T));
+	}
+
 	// todo: can we use the autogenerated one in VS2013 now?
 	FrameBuf(FrameBuf&& other)
-		: m_data(std::move(other.m_data))
-		, m_width(other.m_width)
-		, m_height(other.m_height)		
-	{}
+	{
+		swap(other);
+	}
+
+	~FrameBuf()
+	{
+		release();
+	}
 
 	FrameBuf& operator=(FrameBuf other)
 	{
-		std::swap(m_data, other.m_data);
-		m_width = other.m_width;
-		m_height = other.m_height;		
+		swap(other);
 		return *this;
 	}
 
-	const T* data() const 
-	{ 
-		return m_data.data();
-	}
-		
-	T* data()
-	{ 
-		return m_data.data();
+	void swap(FrameBuf& other)
+	{
+		std::swap(m_pData, other.m_pData);
+		std::swap(m_width, other.m_width);
+		std::swap(m_height, other.m_height);
+		std::swap(m_stride, other.m_stride);
+		std::swap(m_capacity, other.m_capacity);
+		std::swap(m_pAllocator, other.m_pAllocator);
 	}
 
-	const T* begin() const
+	const T* data() const
 	{
-		return m_data.data()
+		return m_pData;
 	}
 
-	T* begin()
+	T* data()
 	{
-		return m_data.data()
+		return m_pData;
 	}
 
-	const T* end() const
+	const T* row(int y) const
 	{
-		return m_data.data() + m_data.size();
+		return reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(m_pData) + y * m_stride);
 	}
 
-	T* end()
+	T* row(int y)
 	{
-		return m_data.data() + m_data.size();
+		return reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(m_pData) + y * m_stride);
 	}
 
-	const T& operator[](int i) const
+	const T& operator()(int x, int y) const
 	{
-		return m_data[i];
+		return row(y)[x];
 	}
 
-	T& operator[](int i)
+	T& operator()(int x, int y)
 	{
-		return m_data[i];
+		return row(y)[x];
 	}
 
-	const T& operator()(int x, int y) const 
-	{ 
-		return m_data[y * m_width + x]; 
+	int width() const
+	{
+		return m_width;
 	}
-		
-	T& operator()(int x, int y) 
+
+	int height() const
 	{
-		return m_data[y * m_width + x]; 
+		return m_height;
 	}
 
-	int index(int x, int y) const
+	// bytes from one row to the next
+	size_t stride() const
 	{
-		return y * m_width + x;
+		return m_stride;
 	}
-	
-	int width() const 
-	{ 
-		return m_width; 
+
+	ImageView<T> view()
+	{
+		return ImageView<T>(m_pData, m_width, m_height, ptrdiff_t(m_stride));
 	}
 
-	int height() const 
-	{ 
-		return m_height; 
+	ImageView<const T> view() const
+	{
+		return ImageView<const T>(m_pData, m_width, m_height, ptrdiff_t(m_stride));
 	}
 
+	// pixels without the padding
 	int size() const
 	{
-		return int(m_data.size());
+		return m_width * m_height;
 	}
 
-	void setSize(int width, int height) 
-	{ 
+	// The content is undefined afterwards. Keeps the memory if it is large enough.
+	void setSize(int width, int height)
+	{
+		size_t stride = (width * sizeof(T) + FrameAlignment - 1) & ~(FrameAlignment - 1);
+		size_t byteSize = stride * height;
+		if(byteSize > m_capacity)
+		{
+			release();
+			m_pData = static_cast<T*>(m_pAllocator->allocate(byteSize));
+			m_capacity = byteSize;
+		}
 		m_width = width;
 		m_height = height;
-		m_data.resize(width * height);
+		m_stride = stride;
+	}
+
+	// gives the memory back to the allocator
+	void release()
+	{
+		if(m_pData)
+			m_pAllocator->free(m_pData, m_capacity);
+		m_pData = nullptr;
+		m_width = 0;
+		m_height = 0;
+		m_stride = 0;
+		m_capacity = 0;
+	}
+
+	FrameAllocator& allocator() const
+	{
+		return *m_pAllocator;
 	}
 
 private:
-	std::vector<T> m_data;
+	T* m_pData = nullptr;
 	int m_width = 0;
 	int m_height = 0;
+	size_t m_stride = 0;
+	size_t m_capacity = 0; // bytes allocated
+	FrameAllocator* m_pAllocator = &FramePool::shared();
 };
 
 //------------------------------------------------------------------------------------------------//
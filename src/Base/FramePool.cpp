@@ -0,0 +1,176 @@
+//-----------------------------------------------------------------------------------------------// 
+// FramePool.cpp
+//-----------------------------------------------------------------------------------------------// 
+
+#include <FramePool.h>
+#include <cstdlib>
+#include <iterator>
+#include <new>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+
+void* alignedAlloc(size_t size, size_t alignment)
+{
+#if defined(_WIN32)
+	void* p = _aligned_malloc(size, alignment);
+#else
+	void* p = nullptr;
+	if(posix_memalign(&p, alignment, size) != 0)
+		p = nullptr;
+#endif
+	if(!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void alignedFree(void* p)
+{
+#if defined(_WIN32)
+	_aligned_free(p);
+#else
+	::free(p);
+#endif
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+class HeapFrameAllocator : public FrameAllocator
+{
+public:
+	void* allocate(size_t size) override
+	{
+		return alignedAlloc(size, FrameAlignment);
+	}
+
+	void free(void* p, size_t) override
+	{
+		alignedFree(p);
+	}
+};
+
+FrameAllocator& heapFrameAllocator()
+{
+	static HeapFrameAllocator s_allocator;
+	return s_allocator;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// FramePool
+//-----------------------------------------------------------------------------------------------// 
+
+FramePool::FramePool(size_t maxFreeBlocks)
+	: m_maxFreeBlocks(maxFreeBlocks)
+{
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+FramePool::~FramePool()
+{
+	trim();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void* FramePool::allocate(size_t size)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_freeBlocks.find(size);
+		if(it != m_freeBlocks.end())
+		{
+			void* p = it->second;
+			m_freeBlocks.erase(it);
+			m_stats.reuses++;
+			m_stats.freeBlocks--;
+			m_stats.freeBytes -= size;
+			return p;
+		}
+		m_stats.heapAllocs++;
+	}
+	return alignedAlloc(size, FrameAlignment);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void FramePool::free(void* p, size_t size)
+{
+	void* pDropped = p;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if(m_freeBlocks.size() < m_maxFreeBlocks)
+		{
+			pDropped = nullptr;
+		}
+		else if(m_maxFreeBlocks > 0)
+		{
+			// the sizes at either end are the ones least likely to be the current frame size
+			auto it = m_freeBlocks.begin();
+			if(it->first == size)
+				it = std::prev(m_freeBlocks.end());
+			if(it->first != size)
+			{
+				pDropped = it->second;
+				m_stats.freeBytes -= it->first;
+				m_freeBlocks.erase(it);
+				m_stats.freeBlocks--;
+			}
+		}
+
+		if(pDropped != p)
+		{
+			m_freeBlocks.insert(std::make_pair(size, p));
+			m_stats.freeBlocks++;
+			m_stats.freeBytes += size;
+		}
+	}
+	if(pDropped)
+		alignedFree(pDropped);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void FramePool::trim()
+{
+	std::multimap<size_t, void*> blocks;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		blocks.swap(m_freeBlocks);
+		m_stats.freeBlocks = 0;
+		m_stats.freeBytes = 0;
+	}
+	for(auto& block : blocks)
+		alignedFree(block.second);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+FramePool::Stats FramePool::stats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+FramePool& FramePool::shared()
+{
+	static FramePool* s_pPool = new FramePool();
+	return *s_pPool;
+}
+
+// VS2013 doesn't make function statics thread safe, so both are created before main()
+static FrameAllocator& s_heapAllocator = heapFrameAllocator();
+static FramePool& s_sharedPool = FramePool::shared();
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
\ No newline at end of file
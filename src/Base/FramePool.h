@@ -0,0 +1,80 @@
+//-----------------------------------------------------------------------------------------------// 
+// FramePool.h
+//-----------------------------------------------------------------------------------------------// 
+#ifndef MPX_BASE_FRAME_POOL_H
+#define MPX_BASE_FRAME_POOL_H
+
+#include <Include.h>
+#include <map>
+#include <mutex>
+
+namespace mpx {
+
+// alignment of frame buffers and of their rows, enough for AVX-512 loads and stores
+const size_t FrameAlignment = 64;
+
+void* alignedAlloc(size_t size, size_t alignment);
+void alignedFree(void* p);
+
+//-----------------------------------------------------------------------------------------------// 
+// Memory for FrameBuf. Blocks are FrameAlignment aligned and not initialized.
+//-----------------------------------------------------------------------------------------------// 
+class FrameAllocator
+{
+public:
+	virtual ~FrameAllocator() {}
+	virtual void* allocate(size_t size) = 0;
+	virtual void free(void* p, size_t size) = 0; // size as passed to allocate
+};
+
+// straight to the heap
+FrameAllocator& heapFrameAllocator();
+
+//-----------------------------------------------------------------------------------------------// 
+// Keeps freed blocks for the next allocation of the same size, so stepping through frames of
+// one size only hits the heap for the first few. Thread safe, frames are often released on
+// another thread than the one that filled them.
+//-----------------------------------------------------------------------------------------------// 
+class FramePool : public FrameAllocator
+{
+public:
+	struct Stats
+	{
+		uint64_t heapAllocs = 0;
+		uint64_t reuses = 0;
+		size_t freeBlocks = 0;
+		size_t freeBytes = 0;
+	};
+
+	// at most maxFreeBlocks are kept, a full pool drops blocks of other sizes first
+	explicit FramePool(size_t maxFreeBlocks = 16);
+	~FramePool();
+
+	void* allocate(size_t size) override;
+	void free(void* p, size_t size) override;
+
+	// returns all free blocks to the heap
+	void trim();
+
+	Stats stats() const;
+
+	// the default allocator of FrameBuf, never destroyed so it outlives static frames
+	static FramePool& shared();
+
+private:
+	FramePool(const FramePool&) = delete;
+	FramePool& operator=(const FramePool&) = delete;
+
+	mutable std::mutex m_mutex;
+	std::multimap<size_t, void*> m_freeBlocks; // by size
+	size_t m_maxFreeBlocks;
+	Stats m_stats;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
+
+//-----------------------------------------------------------------------------------------------// 
+
+#endif
@@ -0,0 +1,142 @@
+//-----------------------------------------------------------------------------------------------// 
+// ImageView.h
+//-----------------------------------------------------------------------------------------------// 
+#ifndef MPX_BASE_IMAGE_VIEW_H
+#define MPX_BASE_IMAGE_VIEW_H
+
+#include <Include.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// Non-owning view of a strided image, e.g. a FrameBuf, a rectangle of it or a decoder plane.
+// Views are cheap to copy and crops share the pixels, so they are passed by value.
+//-----------------------------------------------------------------------------------------------// 
+template<typename T>
+class ImageView
+{
+public:
+	ImageView() = default;
+
+	ImageView(T* pData, int width, int height, ptrdiff_t stride)
+		: m_pData(pData)
+		, m_width(width)
+		, m_height(height)
+		, m_stride(stride)
+	{}
+
+	// ImageView<T> to ImageView<const T>
+	template<typename U, typename = typename std::enable_if<std::is_convertible<U*, T*>::value>::type>
+	ImageView(const ImageView<U>& other)
+		: m_pData(other.data())
+		, m_width(other.width())
+		, m_height(other.height())
+		, m_stride(other.stride())
+	{}
+
+	T* data() const
+	{
+		return m_pData;
+	}
+
+	T* row(int y) const
+	{
+		typedef typename std::conditional<std::is_const<T>::value, const uint8_t, uint8_t>::type Byte;
+		return reinterpret_cast<T*>(reinterpret_cast<Byte*>(m_pData) + y * m_stride);
+	}
+
+	T& operator()(int x, int y) const
+	{
+		return row(y)[x];
+	}
+
+	int width() const
+	{
+		return m_width;
+	}
+
+	int height() const
+	{
+		return m_height;
+	}
+
+	// bytes from one row to the next
+	ptrdiff_t stride() const
+	{
+		return m_stride;
+	}
+
+	bool empty() const
+	{
+		return m_width <= 0 || m_height <= 0;
+	}
+
+	// the rectangle clipped to the view, without copying
+	ImageView crop(int x, int y, int width, int height) const
+	{
+		int x0 = std::max(0, std::min(x, m_width));
+		int y0 = std::max(0, std::min(y, m_height));
+		int x1 = std::max(x0, std::min(x + width, m_width));
+		int y1 = std::max(y0, std::min(y + height, m_height));
+		return ImageView(row(y0) + x0, x1 - x0, y1 - y0, m_stride);
+	}
+
+private:
+	T* m_pData = nullptr;
+	int m_width = 0;
+	int m_height = 0;
+	ptrdiff_t m_stride = 0;
+};
+
+// a single channel, e.g. one plane of a decoded image
+template<typename T>
+using PlaneView = ImageView<T>;
+
+//-----------------------------------------------------------------------------------------------// 
+// Algorithms on views, T has to be trivially copyable.
+//-----------------------------------------------------------------------------------------------// 
+
+template<typename T>
+void fillImage(const ImageView<T>& dest, T value)
+{
+	for(int y = 0; y < dest.height(); y++)
+		std::fill(dest.row(y), dest.row(y) + dest.width(), value);
+}
+
+// copies the overlapping top left part
+template<typename S, typename D>
+void copyImage(const ImageView<S>& src, const ImageView<D>& dest)
+{
+	static_assert(sizeof(S) == sizeof(D), "pixel types differ");
+	int width = std::min(src.width(), dest.width());
+	int height = std::min(src.height(), dest.height());
+	for(int y = 0; y < height; y++)
+		memcpy(dest.row(y), src.row(y), width * sizeof(D));
+}
+
+// same size and pixels, the padding of the rows is ignored
+template<typename A, typename B>
+bool equalImages(const ImageView<A>& a, const ImageView<B>& b)
+{
+	static_assert(sizeof(A) == sizeof(B), "pixel types differ");
+	if(a.width() != b.width() || a.height() != b.height())
+		return false;
+	for(int y = 0; y < a.height(); y++)
+	{
+		if(memcmp(a.row(y), b.row(y), a.width() * sizeof(A)) != 0)
+			return false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
+
+//-----------------------------------------------------------------------------------------------// 
+
+#endif
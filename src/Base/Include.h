@@ -8,6 +8,13 @@
 
 #define MPX_INLINE inline
 
+// enables an instruction set for a single function (msvc allows all intrinsics anyway)
+#if defined(__GNUC__)
+#define MPX_TARGET(isa) __attribute__((target(isa)))
+#else
+#define MPX_TARGET(isa)
+#endif
+
 typedef unsigned int uint;
 
 //-----------------------------------------------------------------------------------------------// 
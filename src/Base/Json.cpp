@@ -0,0 +1,173 @@
+//-----------------------------------------------------------------------------------------------// 
+// Json.cpp
+//-----------------------------------------------------------------------------------------------// 
+
+#include <Json.h>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#pragma warning (disable: 4996) // sprintf, the buffers fit the longest number
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+
+void appendJsonString(std::string& rOut, const char* pText, size_t length)
+{
+	static const char Hex[] = "0123456789abcdef";
+
+	rOut += '"';
+	for(size_t i = 0; i < length; i++)
+	{
+		char c = pText[i];
+		switch(c)
+		{
+		case '"': rOut += "\\\""; break;
+		case '\\': rOut += "\\\\"; break;
+		case '\n': rOut += "\\n"; break;
+		case '\r': rOut += "\\r"; break;
+		case '\t': rOut += "\\t"; break;
+		default:
+			if(uint8_t(c) < 0x20)
+			{
+				rOut += "\\u00";
+				rOut += Hex[uint8_t(c) >> 4];
+				rOut += Hex[uint8_t(c) & 15];
+			}
+			else
+			{
+				// utf-8 passes through
+				rOut += c;
+			}
+		}
+	}
+	rOut += '"';
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// JsonWriter
+//-----------------------------------------------------------------------------------------------// 
+
+void JsonWriter::separate()
+{
+	if(m_afterKey)
+	{
+		m_afterKey = false;
+		return;
+	}
+	if(!m_hasElements.empty())
+	{
+		if(m_hasElements.back())
+			m_rOut += ',';
+		m_hasElements.back() = true;
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void JsonWriter::beginObject()
+{
+	separate();
+	m_rOut += '{';
+	m_hasElements.push_back(false);
+}
+
+void JsonWriter::endObject()
+{
+	m_rOut += '}';
+	m_hasElements.pop_back();
+}
+
+void JsonWriter::beginArray()
+{
+	separate();
+	m_rOut += '[';
+	m_hasElements.push_back(false);
+}
+
+void JsonWriter::endArray()
+{
+	m_rOut += ']';
+	m_hasElements.pop_back();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void JsonWriter::key(const char* pName)
+{
+	separate();
+	appendJsonString(m_rOut, pName, strlen(pName));
+	m_rOut += ':';
+	m_afterKey = true;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void JsonWriter::value(const char* pText)
+{
+	separate();
+	appendJsonString(m_rOut, pText, strlen(pText));
+}
+
+void JsonWriter::value(const std::string& text)
+{
+	separate();
+	appendJsonString(m_rOut, text.data(), text.size());
+}
+
+void JsonWriter::value(bool b)
+{
+	separate();
+	m_rOut += b ? "true" : "false";
+}
+
+void JsonWriter::value(int i)
+{
+	value(int64_t(i));
+}
+
+void JsonWriter::value(uint i)
+{
+	value(uint64_t(i));
+}
+
+void JsonWriter::value(int64_t i)
+{
+	separate();
+	char buf[32];
+	sprintf(buf, "%lld", (long long)i);
+	m_rOut += buf;
+}
+
+void JsonWriter::value(uint64_t i)
+{
+	separate();
+	char buf[32];
+	sprintf(buf, "%llu", (unsigned long long)i);
+	m_rOut += buf;
+}
+
+void JsonWriter::value(double d)
+{
+	if(!std::isfinite(d))
+	{
+		null();
+		return;
+	}
+
+	separate();
+	char buf[32];
+	sprintf(buf, "%.10g", d);
+	m_rOut += buf;
+}
+
+void JsonWriter::null()
+{
+	separate();
+	m_rOut += "null";
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
\ No newline at end of file
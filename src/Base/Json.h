@@ -0,0 +1,78 @@
+//-----------------------------------------------------------------------------------------------// 
+// Json.h
+//-----------------------------------------------------------------------------------------------// 
+#ifndef MPX_BASE_JSON_H
+#define MPX_BASE_JSON_H
+
+#include <Include.h>
+#include <string>
+#include <vector>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+
+// the text as a quoted JSON string, control characters escaped
+void appendJsonString(std::string& rOut, const char* pText, size_t length);
+
+//-----------------------------------------------------------------------------------------------// 
+// Writes compact JSON into a string, the commas are placed automatically. Only the nesting is
+// tracked, it doesn't check that keys and values alternate.
+//
+//     JsonWriter json(line);
+//     json.beginObject();
+//     json.field("frames", frameCount);
+//     json.endObject();
+//-----------------------------------------------------------------------------------------------// 
+class JsonWriter
+{
+public:
+	explicit JsonWriter(std::string& rOut)
+		: m_rOut(rOut)
+		, m_afterKey(false)
+	{
+	}
+
+	void beginObject();
+	void endObject();
+	void beginArray();
+	void endArray();
+
+	void key(const char* pName);
+
+	void value(const char* pText);
+	void value(const std::string& text);
+	void value(bool b);
+	void value(int i);
+	void value(uint i);
+	void value(int64_t i);
+	void value(uint64_t i);
+	void value(double d); // null for nan and infinity, JSON has no such numbers
+	void null();
+
+	template<typename T>
+	void field(const char* pName, const T& v)
+	{
+		key(pName);
+		value(v);
+	}
+
+private:
+	JsonWriter(const JsonWriter&) = delete;
+	JsonWriter& operator=(const JsonWriter&) = delete;
+
+	// the comma before an element, if it isn't the first one of its parent
+	void separate();
+
+	std::string& m_rOut;
+	std::vector<bool> m_hasElements; // one per open object or array
+	bool m_afterKey;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
+
+//-----------------------------------------------------------------------------------------------// 
+
+#endif
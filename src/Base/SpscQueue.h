@@ -0,0 +1,134 @@
+//-----------------------------------------------------------------------------------------------// 
+// SpscQueue.h
+//-----------------------------------------------------------------------------------------------// 
+#ifndef MPX_BASE_SPSC_QUEUE_H
+#define MPX_BASE_SPSC_QUEUE_H
+
+#include <Include.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// Bounded lock-free queue for exactly one producer and one consumer thread.
+//
+// push() blocks while the queue is full, which throttles the producer to the speed of the
+// consumer. The producer calls close() when it is done, pop() then drains the remaining items
+// and returns false. Both block calls give up and return false once rCancel is set.
+//-----------------------------------------------------------------------------------------------// 
+template<typename T>
+class SpscQueue
+{
+public:
+	explicit SpscQueue(size_t capacity)
+		: m_head(0)
+		, m_tail(0)
+		, m_closed(false)
+	{
+		// one slot stays empty to tell full from empty, round up to a power of two for masking
+		size_t size = 2;
+		while(size < capacity + 1)
+			size *= 2;
+		m_slots.resize(size);
+		m_mask = size - 1;
+	}
+
+	size_t capacity() const
+	{
+		return m_slots.size() - 1;
+	}
+
+	// producer side
+	bool tryPush(T& rItem)
+	{
+		size_t tail = m_tail.load(std::memory_order_relaxed);
+		size_t next = (tail + 1) & m_mask;
+		if(next == m_head.load(std::memory_order_acquire))
+			return false; // full
+
+		m_slots[tail] = std::move(rItem);
+		m_tail.store(next, std::memory_order_release);
+		return true;
+	}
+
+	bool push(T& rItem, const std::atomic<bool>& rCancel)
+	{
+		for(int spin = 0; !tryPush(rItem); spin++)
+		{
+			if(rCancel.load(std::memory_order_relaxed))
+				return false;
+			backoff(spin);
+		}
+		return true;
+	}
+
+	void close()
+	{
+		m_closed.store(true, std::memory_order_release);
+	}
+
+	// consumer side
+	bool tryPop(T& rItem)
+	{
+		size_t head = m_head.load(std::memory_order_relaxed);
+		if(head == m_tail.load(std::memory_order_acquire))
+			return false; // empty
+
+		rItem = std::move(m_slots[head]);
+		m_head.store((head + 1) & m_mask, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(T& rItem, const std::atomic<bool>& rCancel)
+	{
+		for(int spin = 0; !tryPop(rItem); spin++)
+		{
+			if(rCancel.load(std::memory_order_relaxed))
+				return false;
+
+			// check for items again after seeing the close, the last push may have raced it
+			if(m_closed.load(std::memory_order_acquire))
+				return tryPop(rItem);
+
+			backoff(spin);
+		}
+		return true;
+	}
+
+private:
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+	// spin briefly, then yield, then sleep so a stalled stage doesn't burn a core
+	static void backoff(int spin)
+	{
+		if(spin < 64)
+			return;
+		if(spin < 256)
+			std::this_thread::yield();
+		else
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+	}
+
+	std::vector<T> m_slots;
+	size_t m_mask;
+
+	// producer and consumer indices on separate cache lines
+	char m_pad0[64];
+	std::atomic<size_t> m_head;
+	char m_pad1[64];
+	std::atomic<size_t> m_tail;
+	char m_pad2[64];
+	std::atomic<bool> m_closed;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
+
+//-----------------------------------------------------------------------------------------------// 
+
+#endif
@@ -0,0 +1,144 @@
+//-----------------------------------------------------------------------------------------------// 
+// ThreadPool.cpp
+//-----------------------------------------------------------------------------------------------// 
+
+#include <ThreadPool.h>
+#include <Trace.h>
+#include <Utils.h>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+
+ThreadPool::ThreadPool(int threadCount)
+	: m_nextItem(0)
+	, m_pendingItems(0)
+{
+	if(threadCount <= 0)
+		threadCount = hardwareThreads();
+
+	for(int i = 1; i < threadCount; i++)
+		m_workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+
+	for(auto& rWorker : m_workers)
+		rWorker.join();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+int ThreadPool::hardwareThreads()
+{
+	int count = int(std::thread::hardware_concurrency());
+	return count > 0 ? count : 1;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void ThreadPool::parallelFor(int count, const std::function<void(int, int)>& func)
+{
+	if(m_workers.empty() || count <= 1)
+	{
+		for(int i = 0; i < count; i++)
+			func(i, 0);
+		return;
+	}
+
+	// publish the job
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pFunc = &func;
+		m_count = count;
+		m_nextItem = 0;
+		m_pendingItems = count;
+		m_error = nullptr;
+		m_generation++;
+	}
+	m_wake.notify_all();
+
+	// help out, then wait until no worker touches the job anymore
+	runItems(0);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done.wait(lock, [this] { return m_pendingItems == 0 && m_busy == 0; });
+	m_pFunc = nullptr;
+
+	if(m_error)
+	{
+		std::exception_ptr error = m_error;
+		m_error = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void ThreadPool::workerLoop(int threadIdx)
+{
+	setTraceThreadName(sprint("pool worker %d", threadIdx).c_str());
+	uint64_t seenGeneration = 0;
+	for(;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [&] { return m_stop || (m_pFunc && m_generation != seenGeneration); });
+			if(m_stop)
+				return;
+
+			seenGeneration = m_generation;
+			m_busy++;
+		}
+
+		runItems(threadIdx);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_busy--;
+		}
+		m_done.notify_all();
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void ThreadPool::runItems(int threadIdx)
+{
+	for(;;)
+	{
+		int item = m_nextItem++;
+		if(item >= m_count)
+			return;
+
+		try
+		{
+			(*m_pFunc)(item, threadIdx);
+		}
+		catch(...)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if(!m_error)
+				m_error = std::current_exception();
+		}
+
+		if(--m_pendingItems == 0)
+		{
+			// notify under the lock so the waiting thread can't miss it
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_done.notify_all();
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
\ No newline at end of file
@@ -0,0 +1,70 @@
+//-----------------------------------------------------------------------------------------------// 
+// ThreadPool.h
+//-----------------------------------------------------------------------------------------------// 
+#ifndef MPX_BASE_THREAD_POOL_H
+#define MPX_BASE_THREAD_POOL_H
+
+#include <Include.h>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// Fixed set of worker threads for fork/join style loops. The calling thread takes part in the
+// work, so a pool of n threads starts n - 1 workers. Only one loop can run at a time.
+//-----------------------------------------------------------------------------------------------// 
+class ThreadPool
+{
+public:
+	// 0 == one thread per core
+	explicit ThreadPool(int threadCount = 0);
+	~ThreadPool();
+
+	int threadCount() const
+	{
+		return int(m_workers.size()) + 1;
+	}
+
+	// calls func(item, threadIdx) for all items in [0, count) and returns when all are done.
+	// threadIdx is in [0, threadCount()), 0 is the calling thread. The first exception thrown
+	// by func is rethrown here.
+	void parallelFor(int count, const std::function<void(int, int)>& func);
+
+	static int hardwareThreads();
+
+private:
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void workerLoop(int threadIdx);
+	void runItems(int threadIdx);
+
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+
+	// current job, guarded by m_mutex except for the atomics
+	const std::function<void(int, int)>* m_pFunc = nullptr;
+	int m_count = 0;
+	uint64_t m_generation = 0;
+	int m_busy = 0;
+	bool m_stop = false;
+	std::atomic<int> m_nextItem;
+	std::atomic<int> m_pendingItems;
+	std::exception_ptr m_error;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
+
+//-----------------------------------------------------------------------------------------------// 
+
+#endif
@@ -0,0 +1,59 @@
+//-----------------------------------------------------------------------------------------------// 
+// Timer.cpp
+//-----------------------------------------------------------------------------------------------// 
+
+#include <Timer.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <chrono>
+#endif
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+
+#if defined(_WIN32)
+
+static double queryTicksPerMs()
+{
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	return double(frequency.QuadPart) / 1000.0;
+}
+
+static const double s_ticksPerMs = queryTicksPerMs();
+
+int64_t timeTicks()
+{
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return counter.QuadPart;
+}
+
+double ticksToMs(int64_t ticks)
+{
+	return double(ticks) / s_ticksPerMs;
+}
+
+#else
+
+int64_t timeTicks()
+{
+	using namespace std::chrono;
+	return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+double ticksToMs(int64_t ticks)
+{
+	return double(ticks) * 1e-6;
+}
+
+#endif
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
\ No newline at end of file
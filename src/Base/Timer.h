@@ -0,0 +1,48 @@
+//-----------------------------------------------------------------------------------------------// 
+// Timer.h
+//-----------------------------------------------------------------------------------------------// 
+#ifndef MPX_BASE_TIMER_H
+#define MPX_BASE_TIMER_H
+
+#include <Include.h>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+
+// high resolution time stamp, std::chrono clocks only have ms resolution in VS2013
+int64_t timeTicks();
+
+double ticksToMs(int64_t ticks);
+
+//-----------------------------------------------------------------------------------------------// 
+// Measures the time since construction or the last restart.
+//-----------------------------------------------------------------------------------------------// 
+class Timer
+{
+public:
+	Timer()
+		: m_start(timeTicks())
+	{}
+
+	void restart()
+	{
+		m_start = timeTicks();
+	}
+
+	double elapsedMs() const
+	{
+		return ticksToMs(timeTicks() - m_start);
+	}
+
+private:
+	int64_t m_start;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
+
+//-----------------------------------------------------------------------------------------------// 
+
+#endif
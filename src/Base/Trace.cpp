@@ -0,0 +1,282 @@
+//-----------------------------------------------------------------------------------------------// 
+// Trace.cpp
+//-----------------------------------------------------------------------------------------------// 
+
+#include <Json.h>
+#include <Trace.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#pragma warning (disable: 4996) // fopen and strncpy
+
+// VS2013 has no thread_local, both of these only take plain data
+#if defined(_MSC_VER)
+#define MPX_THREAD_LOCAL __declspec(thread)
+#else
+#define MPX_THREAD_LOCAL __thread
+#endif
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+
+std::atomic<bool> g_traceEnabled(false);
+
+struct TraceEvent
+{
+	const char* pName;
+	int64_t startTicks;
+	int64_t endTicks;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+// The spans of one thread. The vector grows up to Capacity and is a ring from then on, so
+// short-lived threads only take what they record. A thread that exits keeps its spans in the
+// trace and hands its buffer on to the next new thread, whose spans go on in the same track.
+// So there are only as many buffers as threads ever ran at the same time, and not one per
+// thread of every file a batch run analyses.
+//-----------------------------------------------------------------------------------------------// 
+struct TraceBuffer
+{
+	static const size_t Capacity = 1 << 15;
+
+	std::mutex mutex; // only contended while the trace is written or cleared
+	std::vector<TraceEvent> events;
+	uint64_t recordedCount = 0; // including the overwritten ones
+	int threadId = 0;
+	std::string threadName;
+};
+
+static const size_t ThreadNameSize = 32;
+
+static std::mutex s_buffersMutex;
+static std::vector<std::unique_ptr<TraceBuffer>> s_buffers;
+static std::vector<TraceBuffer*> s_freeBuffers; // of exited threads
+
+static MPX_THREAD_LOCAL TraceBuffer* s_pThreadBuffer = nullptr;
+static MPX_THREAD_LOCAL char s_threadName[ThreadNameSize];
+
+//-----------------------------------------------------------------------------------------------// 
+// Thread exit. The thread locals above have no destructors, the buffer is handed back by a
+// callback of a pthread key or fiber local slot, which holds it for the thread.
+//-----------------------------------------------------------------------------------------------// 
+
+#if defined(_WIN32)
+static void NTAPI releaseThreadBuffer(void* pBuffer)
+#else
+static void releaseThreadBuffer(void* pBuffer)
+#endif
+{
+	if(!pBuffer)
+		return;
+	std::lock_guard<std::mutex> lock(s_buffersMutex);
+	s_freeBuffers.push_back(static_cast<TraceBuffer*>(pBuffer));
+	s_pThreadBuffer = nullptr;
+}
+
+#if defined(_WIN32)
+static DWORD s_exitSlot = FLS_OUT_OF_INDEXES;
+#else
+static pthread_key_t s_exitKey;
+#endif
+static std::once_flag s_exitOnce;
+
+static void watchThreadExit(TraceBuffer* pBuffer)
+{
+#if defined(_WIN32)
+	std::call_once(s_exitOnce, [] { s_exitSlot = FlsAlloc(releaseThreadBuffer); });
+	if(s_exitSlot != FLS_OUT_OF_INDEXES)
+		FlsSetValue(s_exitSlot, pBuffer);
+#else
+	std::call_once(s_exitOnce, [] { pthread_key_create(&s_exitKey, releaseThreadBuffer); });
+	pthread_setspecific(s_exitKey, pBuffer);
+#endif
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+static TraceBuffer& threadBuffer()
+{
+	if(!s_pThreadBuffer)
+	{
+		std::unique_lock<std::mutex> lock(s_buffersMutex);
+		TraceBuffer* pBuffer;
+		if(!s_freeBuffers.empty())
+		{
+			pBuffer = s_freeBuffers.back();
+			s_freeBuffers.pop_back();
+		}
+		else
+		{
+			s_buffers.push_back(std::make_unique<TraceBuffer>());
+			pBuffer = s_buffers.back().get();
+			pBuffer->threadId = int(s_buffers.size());
+		}
+		lock.unlock();
+
+		{
+			std::lock_guard<std::mutex> bufferLock(pBuffer->mutex);
+			pBuffer->threadName = s_threadName;
+		}
+		s_pThreadBuffer = pBuffer;
+		watchThreadExit(pBuffer);
+	}
+	return *s_pThreadBuffer;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void enableTrace(bool enable)
+{
+	g_traceEnabled.store(enable);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void clearTrace()
+{
+	std::lock_guard<std::mutex> lock(s_buffersMutex);
+	for(auto& pBuffer : s_buffers)
+	{
+		std::lock_guard<std::mutex> bufferLock(pBuffer->mutex);
+		pBuffer->events.clear();
+		pBuffer->recordedCount = 0;
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void setTraceThreadName(const char* pName)
+{
+	// kept aside until the thread records, naming a thread doesn't create its buffer
+	strncpy(s_threadName, pName, ThreadNameSize - 1);
+	s_threadName[ThreadNameSize - 1] = 0;
+	if(s_pThreadBuffer)
+	{
+		std::lock_guard<std::mutex> lock(s_pThreadBuffer->mutex);
+		s_pThreadBuffer->threadName = s_threadName;
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void recordTraceSpan(const char* pName, int64_t startTicks, int64_t endTicks)
+{
+	TraceBuffer& rBuffer = threadBuffer();
+	TraceEvent event = { pName, startTicks, endTicks };
+	std::lock_guard<std::mutex> lock(rBuffer.mutex);
+	if(rBuffer.events.size() < TraceBuffer::Capacity)
+		rBuffer.events.push_back(event);
+	else
+		rBuffer.events[size_t(rBuffer.recordedCount % TraceBuffer::Capacity)] = event;
+	rBuffer.recordedCount++;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void writeChromeTrace(std::string& rOut)
+{
+	// copy the spans out first, the threads can go on recording while the JSON is written
+	struct ThreadSpans
+	{
+		int threadId;
+		std::string threadName;
+		std::vector<TraceEvent> events;
+	};
+	std::vector<ThreadSpans> threads;
+	{
+		std::lock_guard<std::mutex> lock(s_buffersMutex);
+		threads.resize(s_buffers.size());
+		for(size_t bufferIdx = 0; bufferIdx < s_buffers.size(); bufferIdx++)
+		{
+			TraceBuffer& rBuffer = *s_buffers[bufferIdx];
+			ThreadSpans& rThread = threads[bufferIdx];
+			std::lock_guard<std::mutex> bufferLock(rBuffer.mutex);
+			rThread.threadId = rBuffer.threadId;
+			rThread.threadName = rBuffer.threadName;
+
+			// oldest first
+			size_t oldest = size_t(rBuffer.recordedCount % std::max<size_t>(rBuffer.events.size(), 1));
+			rThread.events.assign(rBuffer.events.begin() + oldest, rBuffer.events.end());
+			rThread.events.insert(rThread.events.end(), rBuffer.events.begin(), rBuffer.events.begin() + oldest);
+		}
+	}
+
+	int64_t originTicks = INT64_MAX;
+	for(const ThreadSpans& thread : threads)
+	{
+		for(const TraceEvent& event : thread.events)
+			originTicks = std::min(originTicks, event.startTicks);
+	}
+
+	JsonWriter json(rOut);
+	json.beginObject();
+	json.field("displayTimeUnit", "ms");
+	json.key("traceEvents");
+	json.beginArray();
+	for(const ThreadSpans& thread : threads)
+	{
+		if(thread.events.empty())
+			continue;
+
+		if(!thread.threadName.empty())
+		{
+			json.beginObject();
+			json.field("name", "thread_name");
+			json.field("ph", "M");
+			json.field("pid", 1);
+			json.field("tid", thread.threadId);
+			json.key("args");
+			json.beginObject();
+			json.field("name", thread.threadName);
+			json.endObject();
+			json.endObject();
+		}
+
+		for(const TraceEvent& event : thread.events)
+		{
+			json.beginObject();
+			json.field("name", event.pName);
+			json.field("cat", "mpx");
+			json.field("ph", "X");
+			json.field("ts", ticksToMs(event.startTicks - originTicks) * 1000.0);
+			json.field("dur", ticksToMs(event.endTicks - event.startTicks) * 1000.0);
+			json.field("pid", 1);
+			json.field("tid", thread.threadId);
+			json.endObject();
+		}
+	}
+	json.endArray();
+	json.endObject();
+	rOut += '\n';
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool saveChromeTrace(const std::string& file)
+{
+	std::string out;
+	writeChromeTrace(out);
+
+	FILE* pFile = fopen(file.c_str(), "wb");
+	if(!pFile)
+		return false;
+	size_t written = fwrite(out.data(), 1, out.size(), pFile);
+	return fclose(pFile) == 0 && written == out.size();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
\ No newline at end of file
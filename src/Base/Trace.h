@@ -0,0 +1,100 @@
+//-----------------------------------------------------------------------------------------------// 
+// Trace.h
+//-----------------------------------------------------------------------------------------------// 
+#ifndef MPX_BASE_TRACE_H
+#define MPX_BASE_TRACE_H
+
+#include <Include.h>
+#include <Timer.h>
+#include <atomic>
+#include <string>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// Timeline tracing of the hot paths. Spans are recorded per thread into ring buffers, once a
+// buffer is full the newest spans overwrite the oldest. While tracing is off a span costs a
+// relaxed load and a branch, defining MPX_NO_TRACE removes them completely.
+//
+//     void Decoder::decodeNextFrame()
+//     {
+//         MPX_TRACE_SCOPE("Decoder::decodeNextFrame");
+//         ...
+//
+// The recorded spans are written in the Chrome trace event format, which chrome://tracing and
+// Perfetto load as a timeline with one track per thread.
+//-----------------------------------------------------------------------------------------------// 
+
+extern std::atomic<bool> g_traceEnabled;
+
+inline bool traceEnabled()
+{
+	return g_traceEnabled.load(std::memory_order_relaxed);
+}
+
+// spans already recorded stay until clearTrace()
+void enableTrace(bool enable);
+
+void clearTrace();
+
+// the name of the calling thread's track, up to 31 characters are kept
+void setTraceThreadName(const char* pName);
+
+// pName has to stay valid until the trace is written, string literals do
+void recordTraceSpan(const char* pName, int64_t startTicks, int64_t endTicks);
+
+// all recorded spans as Chrome trace event JSON, times are in us since the earliest span
+void writeChromeTrace(std::string& rOut);
+
+// false if the file can't be written
+bool saveChromeTrace(const std::string& file);
+
+//-----------------------------------------------------------------------------------------------// 
+// Records a span from construction to destruction if tracing was on at construction.
+//-----------------------------------------------------------------------------------------------// 
+class TraceSpan
+{
+public:
+	explicit TraceSpan(const char* pName)
+		: m_pName(nullptr)
+		, m_startTicks(0)
+	{
+		if(traceEnabled())
+		{
+			m_pName = pName;
+			m_startTicks = timeTicks();
+		}
+	}
+
+	~TraceSpan()
+	{
+		if(m_pName)
+			recordTraceSpan(m_pName, m_startTicks, timeTicks());
+	}
+
+private:
+	TraceSpan(const TraceSpan&) = delete;
+	TraceSpan& operator=(const TraceSpan&) = delete;
+
+	const char* m_pName;
+	int64_t m_startTicks;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+#define MPX_TRACE_JOIN2(a, b) a##b
+#define MPX_TRACE_JOIN(a, b) MPX_TRACE_JOIN2(a, b)
+
+#if defined(MPX_NO_TRACE)
+#define MPX_TRACE_SCOPE(name)
+#else
+#define MPX_TRACE_SCOPE(name) ::mpx::TraceSpan MPX_TRACE_JOIN(traceSpan, __LINE__)(name)
+#endif
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
+
+//-----------------------------------------------------------------------------------------------// 
+
+#endif
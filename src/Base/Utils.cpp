@@ -3,44 +3,45 @@
 //-----------------------------------------------------------------------------------------------// 
 
 #include <Utils.h>
+#include <algorithm>
 #include <stdarg.h>
 #include <memory>
 #include <cstdlib>
+#include <cstring>
 
-#pragma warning (disable: 4996) // shut up about strcpy
+#pragma warning (disable: 4996) // shut up about vsnprintf
 
 namespace mpx {
 
 //-----------------------------------------------------------------------------------------------// 
 // printf to std::string
 //-----------------------------------------------------------------------------------------------// 
-void sprint(std::string& out, const char* pFormat, ...)
+static void vsprint(std::string& out, const char* pFormat, va_list argList)
 {
 	// start with a buffer twice the size of the format string
 	int lenFormat = static_cast<int>(strlen(pFormat));
-	int lenCurrent = 2 * lenFormat;
+	int lenCurrent = std::max(2 * lenFormat, 16);
 
 	// try until it fits
     std::unique_ptr<char[]> formatted;
-    va_list argList;
     for(;;)
 	{
-		// try with the current length
+		// try with the current length, every try needs its own copy of the arguments
         formatted.reset(new char[lenCurrent]);
-        strcpy(&formatted[0], pFormat);
-        va_start(argList, pFormat);
-        int lenFinal = vsnprintf(&formatted[0], lenCurrent, pFormat, argList);
-        va_end(argList);
+        va_list argCopy;
+        va_copy(argCopy, argList);
+        int lenFinal = vsnprintf(&formatted[0], lenCurrent, pFormat, argCopy);
+        va_end(argCopy);
 
-		if(lenFinal > 0 && lenFinal < lenCurrent)
+		if(lenFinal >= 0 && lenFinal < lenCurrent)
 		{
 			// it fit
 			break;
 		}
 		else
 		{
-			// it didn't
-            lenCurrent += abs(lenFinal - lenCurrent + 1);
+			// it didn't, older runtimes return -1 instead of the length
+            lenCurrent = lenFinal > lenCurrent ? lenFinal + 1 : 2 * lenCurrent;
 		}
     }
 
@@ -50,13 +51,24 @@ void sprint(std::string& out, const char* pFormat, ...)
 
 //-----------------------------------------------------------------------------------------------// 
 
+void sprint(std::string& out, const char* pFormat, ...)
+{
+	va_list argList;
+	va_start(argList, pFormat);
+	vsprint(out, pFormat, argList);
+	va_end(argList);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
 std::string sprint(const char* pFormat, ...)
 {
 	va_list argList; 
 	va_start(argList, pFormat); 
 	
 	std::string out;
-	sprint(out, pFormat);
+	vsprint(out, pFormat, argList);
+	va_end(argList);
 	return out;
 }
 
@@ -0,0 +1,134 @@
+//-----------------------------------------------------------------------------------------------// 
+// YUVFrame.h
+//-----------------------------------------------------------------------------------------------// 
+#ifndef MPX_BASE_YUV_FRAME_H
+#define MPX_BASE_YUV_FRAME_H
+
+#include <Color.h>
+#include <FrameBuf.h>
+#include <ImageView.h>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// Planar 4:2:0 frame, the chroma planes have half the size (rounded up). At 12 bits per pixel
+// for 8-bit samples it takes half the memory of RGB8, so frames are kept in this form and only
+// converted when they are shown. The samples are the decoded ones, for pixel inspection.
+//-----------------------------------------------------------------------------------------------// 
+template<typename T>
+class YUVFrame
+{
+public:
+	YUVFrame() = default;
+
+	YUVFrame(int width, int height)
+	{
+		setSize(width, height);
+	}
+
+	YUVFrame(const YUVFrame&) = default;
+
+	YUVFrame(YUVFrame&& other)
+	{
+		swap(other);
+	}
+
+	YUVFrame& operator=(YUVFrame other)
+	{
+		swap(other);
+		return *this;
+	}
+
+	void swap(YUVFrame& other)
+	{
+		for(int planeIdx = 0; planeIdx < 3; planeIdx++)
+			m_planes[planeIdx].swap(other.m_planes[planeIdx]);
+		std::swap(m_width, other.m_width);
+		std::swap(m_height, other.m_height);
+	}
+
+	// the content is undefined afterwards, the memory is kept if it is large enough
+	void setSize(int width, int height)
+	{
+		m_width = width;
+		m_height = height;
+		m_planes[0].setSize(width, height);
+		m_planes[1].setSize(chromaWidth(), chromaHeight());
+		m_planes[2].setSize(chromaWidth(), chromaHeight());
+	}
+
+	void release()
+	{
+		for(int planeIdx = 0; planeIdx < 3; planeIdx++)
+			m_planes[planeIdx].release();
+		m_width = 0;
+		m_height = 0;
+	}
+
+	int width() const
+	{
+		return m_width;
+	}
+
+	int height() const
+	{
+		return m_height;
+	}
+
+	int chromaWidth() const
+	{
+		return (m_width + 1) >> 1;
+	}
+
+	int chromaHeight() const
+	{
+		return (m_height + 1) >> 1;
+	}
+
+	bool empty() const
+	{
+		return m_width <= 0 || m_height <= 0;
+	}
+
+	// y, u, v
+	PlaneView<T> plane(int planeIdx)
+	{
+		return m_planes[planeIdx].view();
+	}
+
+	PlaneView<const T> plane(int planeIdx) const
+	{
+		return m_planes[planeIdx].view();
+	}
+
+	// samples of the pixel, the chroma ones are shared by 2x2 pixels
+	YUV<T> operator()(int x, int y) const
+	{
+		YUV<T> sample = { m_planes[0](x, y), m_planes[1](x >> 1, y >> 1), m_planes[2](x >> 1, y >> 1) };
+		return sample;
+	}
+
+	// memory held by the planes, padding included
+	size_t byteSize() const
+	{
+		size_t size = 0;
+		for(int planeIdx = 0; planeIdx < 3; planeIdx++)
+			size += m_planes[planeIdx].stride() * m_planes[planeIdx].height();
+		return size;
+	}
+
+private:
+	FrameBuf<T> m_planes[3];
+	int m_width = 0;
+	int m_height = 0;
+};
+
+using I420Frame = YUVFrame<uint8_t>;
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
+
+//-----------------------------------------------------------------------------------------------// 
+
+#endif
@@ -0,0 +1,386 @@
+//-----------------------------------------------------------------------------------------------// 
+// Batch analyzer main function.
+//-----------------------------------------------------------------------------------------------// 
+
+#include <FileAnalysis.h>
+#include <Json.h>
+#include <ThreadPool.h>
+#include <Timer.h>
+#include <Trace.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#pragma warning (disable: 4996) // fopen and vsprintf
+
+using namespace mpx;
+
+//-----------------------------------------------------------------------------------------------// 
+// Command line.
+//-----------------------------------------------------------------------------------------------// 
+
+enum class OutputFormat
+{
+	NdJson,
+	Csv,
+};
+
+struct BatchOptions
+{
+	int jobCount = 0; // files analysed at the same time, 0 == one per core
+	OutputFormat format = OutputFormat::NdJson;
+	std::string outputFile; // stdout if empty
+	bool summaryOnly = false;
+	bool readStdin = false; // file names from stdin
+	std::string traceFile; // Chrome trace of the run if not empty
+	std::vector<std::string> files;
+	AnalysisOptions analysis;
+};
+
+static void printUsage()
+{
+	fprintf(stderr,
+		"usage: Batch [options] <file.webm>... | -\n"
+		"  -j <n>           files analysed at the same time, 0 == one per core (default)\n"
+		"  -f ndjson|csv    output format, default ndjson\n"
+		"  -o <file>        output file, default stdout\n"
+		"  --summary        one record per file, no frame records\n"
+		"  --headers-only   don't decode, only demux and read the frame headers\n"
+		"  --trace <file>   record where the time goes, as Chrome trace event JSON\n"
+		"  -                read the file names from stdin, one per line\n");
+}
+
+static bool parseArgs(int argc, char* argv[], BatchOptions& rOptions)
+{
+	for(int argIdx = 1; argIdx < argc; argIdx++)
+	{
+		std::string arg = argv[argIdx];
+		bool hasValue = argIdx + 1 < argc;
+		if(arg == "-j" && hasValue)
+			rOptions.jobCount = std::max(0, atoi(argv[++argIdx]));
+		else if(arg == "-f" && hasValue)
+		{
+			std::string format = argv[++argIdx];
+			if(format == "ndjson")
+				rOptions.format = OutputFormat::NdJson;
+			else if(format == "csv")
+				rOptions.format = OutputFormat::Csv;
+			else
+				return false;
+		}
+		else if(arg == "-o" && hasValue)
+			rOptions.outputFile = argv[++argIdx];
+		else if(arg == "--summary")
+			rOptions.summaryOnly = true;
+		else if(arg == "--headers-only")
+			rOptions.analysis.decode = false;
+		else if(arg == "--trace" && hasValue)
+			rOptions.traceFile = argv[++argIdx];
+		else if(arg == "-")
+			rOptions.readStdin = true;
+		else if(!arg.empty() && arg[0] == '-')
+			return false;
+		else
+			rOptions.files.push_back(arg);
+	}
+	return rOptions.readStdin || !rOptions.files.empty();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// The files to analyse. Names from stdin are read as the workers ask for them, so a list of any
+// length takes no memory.
+//-----------------------------------------------------------------------------------------------// 
+class FileQueue
+{
+public:
+	FileQueue(const BatchOptions& options)
+		: m_files(options.files)
+		, m_readStdin(options.readStdin)
+	{
+	}
+
+	bool next(std::string& rFile)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if(m_nextFile < m_files.size())
+		{
+			rFile = m_files[m_nextFile++];
+			return true;
+		}
+		while(m_readStdin && std::getline(std::cin, rFile))
+		{
+			if(!rFile.empty() && rFile.back() == '\r')
+				rFile.pop_back();
+			if(!rFile.empty())
+				return true;
+		}
+		return false;
+	}
+
+private:
+	std::mutex m_mutex;
+	const std::vector<std::string>& m_files;
+	size_t m_nextFile = 0;
+	bool m_readStdin;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+// Records. Every line is complete in itself and names its file, so the lines of files analysed
+// at the same time can be interleaved.
+//-----------------------------------------------------------------------------------------------// 
+
+static void appendCsvField(std::string& rOut, const std::string& text)
+{
+	if(text.find_first_of(",\"\r\n") == std::string::npos)
+	{
+		rOut += text;
+		return;
+	}
+
+	rOut += '"';
+	for(char c : text)
+	{
+		if(c == '"')
+			rOut += '"';
+		rOut += c;
+	}
+	rOut += '"';
+}
+
+// only for numbers, they fit the buffer
+static void appendCsvValues(std::string& rOut, const char* pFormat, ...)
+{
+	char buf[512];
+	va_list args;
+	va_start(args, pFormat);
+	vsprintf(buf, pFormat, args);
+	va_end(args);
+	rOut += buf;
+}
+
+static const char* csvHeader(bool summaryOnly)
+{
+	if(summaryOnly)
+		return "file,error,bytes,packets,chunks,frames,shown,key_frames,corrupt,duration_ns,width,height,"
+			   "mean_q_index,decode_ms,total_ms\n";
+	return "file,frame,shown_idx,packet,timestamp_ns,size,key_frame,shown,width,height,q_index,"
+		   "filter_level,decode_ms\n";
+}
+
+static void appendFrame(std::string& rOut, OutputFormat format, const std::string& file, const FrameRecord& record)
+{
+	const FrameHeader& header = record.header;
+	if(format == OutputFormat::Csv)
+	{
+		appendCsvField(rOut, file);
+		appendCsvValues(rOut, ",%llu,%lld,%llu,%llu,%u,%d,%d,%d,%d,%d,%d,%.3f\n",
+						(unsigned long long)record.frameIdx, (long long)record.shownIdx,
+						(unsigned long long)record.packetIdx, (unsigned long long)record.timestamp,
+						header.size, int(header.keyFrame()), int(header.shown()), header.width, header.height,
+						int(header.baseQIndex), int(header.filterLevel), record.decodeMs);
+		return;
+	}
+
+	JsonWriter json(rOut);
+	json.beginObject();
+	json.field("type", "frame");
+	json.field("file", file);
+	json.field("frame", record.frameIdx);
+	json.key("shownIdx");
+	if(record.shownIdx >= 0)
+		json.value(record.shownIdx);
+	else
+		json.null();
+	json.field("packet", record.packetIdx);
+	json.field("timestamp", record.timestamp);
+	json.field("size", header.size);
+	json.field("keyFrame", header.keyFrame());
+	json.field("shown", header.shown());
+	json.field("corrupt", (header.flags & FrameHeader::Corrupt) != 0);
+	json.field("width", header.width);
+	json.field("height", header.height);
+	json.field("qIndex", int(header.baseQIndex));
+	json.field("filterLevel", int(header.filterLevel));
+	json.field("decodeMs", record.decodeMs);
+	json.endObject();
+	rOut += '\n';
+}
+
+static void appendSummary(std::string& rOut, OutputFormat format, const FileSummary& summary)
+{
+	if(format == OutputFormat::Csv)
+	{
+		appendCsvField(rOut, summary.file);
+		rOut += ',';
+		appendCsvField(rOut, summary.error);
+		appendCsvValues(rOut, ",%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%d,%d,%.2f,%.3f,%.3f\n",
+						(unsigned long long)summary.fileBytes, (unsigned long long)summary.packetCount,
+						(unsigned long long)summary.chunkCount, (unsigned long long)summary.frameCount,
+						(unsigned long long)summary.shownCount, (unsigned long long)summary.keyFrameCount,
+						(unsigned long long)summary.corruptCount, (unsigned long long)summary.durationNs,
+						summary.width, summary.height, summary.meanQIndex, summary.decodeMs, summary.totalMs);
+		return;
+	}
+
+	JsonWriter json(rOut);
+	json.beginObject();
+	json.field("type", "file");
+	json.field("file", summary.file);
+	json.key("error");
+	if(summary.error.empty())
+		json.null();
+	else
+		json.value(summary.error);
+	json.field("bytes", summary.fileBytes);
+	json.field("packets", summary.packetCount);
+	json.field("chunks", summary.chunkCount);
+	json.field("frames", summary.frameCount);
+	json.field("shown", summary.shownCount);
+	json.field("keyFrames", summary.keyFrameCount);
+	json.field("corrupt", summary.corruptCount);
+	json.field("durationNs", summary.durationNs);
+	json.field("width", summary.width);
+	json.field("height", summary.height);
+	json.field("meanQIndex", summary.meanQIndex);
+	json.field("decodeMs", summary.decodeMs);
+	json.field("totalMs", summary.totalMs);
+	json.endObject();
+	rOut += '\n';
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// The output shared by the workers. Each worker collects its lines in its own buffer and writes
+// it in one piece once it is large, so the memory stays the same however long the files are.
+//-----------------------------------------------------------------------------------------------// 
+class Output
+{
+public:
+	static const size_t FlushSize = 64 * 1024;
+
+	Output(FILE* pFile)
+		: m_pFile(pFile)
+	{
+	}
+
+	void write(std::string& rBuffer)
+	{
+		if(rBuffer.empty())
+			return;
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		fwrite(rBuffer.data(), 1, rBuffer.size(), m_pFile);
+		rBuffer.clear();
+	}
+
+	void writeIfFull(std::string& rBuffer)
+	{
+		if(rBuffer.size() >= FlushSize)
+			write(rBuffer);
+	}
+
+private:
+	FILE* m_pFile;
+	std::mutex m_mutex;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+int main(int argc, char* argv[])
+{
+	BatchOptions options;
+	if(!parseArgs(argc, argv, options))
+	{
+		printUsage();
+		return 2;
+	}
+
+	FILE* pOutFile = stdout;
+	if(!options.outputFile.empty())
+	{
+		pOutFile = fopen(options.outputFile.c_str(), "wb");
+		if(!pOutFile)
+		{
+			fprintf(stderr, "error: can't write %s\n", options.outputFile.c_str());
+			return 2;
+		}
+	}
+
+	Output output(pOutFile);
+	std::string header;
+	if(options.format == OutputFormat::Csv)
+		header = csvHeader(options.summaryOnly);
+	output.write(header);
+
+	setTraceThreadName("main");
+	enableTrace(!options.traceFile.empty());
+
+	FileQueue files(options);
+	std::atomic<uint64_t> fileCount(0);
+	std::atomic<uint64_t> failedCount(0);
+	std::atomic<uint64_t> frameCount(0);
+	Timer timer;
+
+	// every pool thread is a worker that takes files until there are none left
+	ThreadPool pool(options.jobCount);
+	pool.parallelFor(pool.threadCount(), [&](int, int)
+	{
+		std::string buffer;
+		buffer.reserve(Output::FlushSize + 4096);
+		std::string file;
+		FileSummary summary;
+		while(files.next(file))
+		{
+			FrameRecordVisitor visitFrame;
+			if(!options.summaryOnly)
+			{
+				visitFrame = [&](const FrameRecord& record)
+				{
+					appendFrame(buffer, options.format, file, record);
+					output.writeIfFull(buffer);
+				};
+			}
+
+			analyzeFile(file, options.analysis, visitFrame, summary);
+			if(!summary.error.empty())
+			{
+				fprintf(stderr, "error: %s: %s\n", file.c_str(), summary.error.c_str());
+				failedCount++;
+			}
+
+			// csv has one table, the file rows only go with --summary
+			if(options.summaryOnly || options.format == OutputFormat::NdJson)
+				appendSummary(buffer, options.format, summary);
+			output.write(buffer);
+			fileCount++;
+			frameCount += summary.frameCount;
+		}
+	});
+
+	if(pOutFile != stdout)
+		fclose(pOutFile);
+	else
+		fflush(stdout);
+
+	if(!options.traceFile.empty())
+	{
+		enableTrace(false);
+		if(!saveChromeTrace(options.traceFile))
+			fprintf(stderr, "error: can't write %s\n", options.traceFile.c_str());
+	}
+
+	double seconds = std::max(timer.elapsedMs(), 1e-3) / 1000.0;
+	fprintf(stderr, "%llu files (%llu failed), %llu frames in %.2f s, %d jobs: %.0f files/hour, %.0f frames/s\n",
+			(unsigned long long)fileCount.load(), (unsigned long long)failedCount.load(),
+			(unsigned long long)frameCount.load(), seconds, pool.threadCount(),
+			double(fileCount.load()) * 3600.0 / seconds, double(frameCount.load()) / seconds);
+	return failedCount ? 1 : 0;
+}
+
+//-----------------------------------------------------------------------------------------------// 
\ No newline at end of file
@@ -0,0 +1,1143 @@
+//-----------------------------------------------------------------------------------------------// 
+// Benchmark main function.
+//-----------------------------------------------------------------------------------------------// 
+
+#include <AnalysisJob.h>
+#include <ByteSource.h>
+#include <CompactBitStream.h>
+#include <Convert.h>
+#include <Decode.h>
+#include <Demux.h>
+#include <FileAnalysis.h>
+#include <FileIndex.h>
+#include <FrameBuf.h>
+#include <FramePool.h>
+#include <Json.h>
+#include <Pipeline.h>
+#include <SegmentDecode.h>
+#include <SyntheticClip.h>
+#include <ThreadPool.h>
+#include <Timer.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#pragma warning (disable: 4996) // fopen
+
+using namespace mpx;
+
+//-----------------------------------------------------------------------------------------------// 
+// Results. Every measurement is run several times, the best run counts. The names are stable
+// between runs, so two result files can be compared key by key.
+//-----------------------------------------------------------------------------------------------// 
+
+struct BenchOptions
+{
+	int runCount = 3;
+	int frameCount = 60; // of the synthetic clips
+	std::string clipDir = "."; // synthetic clips are kept here and only encoded once
+	std::vector<std::string> sizes; // of the synthetic clips, all if empty
+	std::vector<std::string> files; // benchmarked in addition to the synthetic clips
+	std::string jsonFile;
+	bool check = false; // only run the checks of the kernels, the segmented decode and the model
+};
+
+struct BenchClip
+{
+	std::string name; // 360p, 1080p, 4k or the file name
+	std::string file;
+	int width = 0;
+	int height = 0;
+	uint64_t frameCount = 0; // shown frames
+	uint64_t bytes = 0;
+	bool synthetic = false; // encoded by the benchmark, its files can be removed
+};
+
+struct BenchResult
+{
+	std::string name; // section/clip/variant
+	std::string unit;
+	double value = 0; // of the best run
+	double bestMs = 0;
+	double meanMs = 0;
+	int runCount = 0;
+};
+
+class BenchReport
+{
+public:
+	void addClip(const BenchClip& clip)
+	{
+		m_clips.push_back(clip);
+	}
+
+	void add(const BenchResult& result)
+	{
+		printf("%-40s %12.1f %-10s best %9.2f ms   mean %9.2f ms\n", result.name.c_str(), result.value,
+			   result.unit.c_str(), result.bestMs, result.meanMs);
+		fflush(stdout);
+		m_results.push_back(result);
+	}
+
+	void writeJson(const std::string& file, const BenchOptions& options) const;
+
+private:
+	std::vector<BenchClip> m_clips;
+	std::vector<BenchResult> m_results;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+void BenchReport::writeJson(const std::string& file, const BenchOptions& options) const
+{
+	std::string out;
+	JsonWriter json(out);
+	json.beginObject();
+	json.field("version", 1);
+	json.key("machine");
+	json.beginObject();
+	json.field("hardwareThreads", ThreadPool::hardwareThreads());
+	json.field("simd", toString(detectSimdLevel()));
+	json.endObject();
+	json.field("runs", options.runCount);
+
+	json.key("clips");
+	json.beginArray();
+	for(const BenchClip& clip : m_clips)
+	{
+		json.beginObject();
+		json.field("name", clip.name);
+		json.field("file", clip.file);
+		json.field("width", clip.width);
+		json.field("height", clip.height);
+		json.field("frames", clip.frameCount);
+		json.field("bytes", clip.bytes);
+		json.endObject();
+	}
+	json.endArray();
+
+	json.key("results");
+	json.beginArray();
+	for(const BenchResult& result : m_results)
+	{
+		json.beginObject();
+		json.field("name", result.name);
+		json.field("unit", result.unit);
+		json.field("value", result.value);
+		json.field("bestMs", result.bestMs);
+		json.field("meanMs", result.meanMs);
+		json.field("runs", result.runCount);
+		json.endObject();
+	}
+	json.endArray();
+	json.endObject();
+	out += '\n';
+
+	FILE* pFile = fopen(file.c_str(), "wb");
+	if(!pFile)
+		throw DecoderError("Can't write " + file);
+	fwrite(out.data(), 1, out.size(), pFile);
+	fclose(pFile);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+// Runs func runCount times. func returns the time that counts in ms, which can be less than the
+// whole run, e.g. only the time spent in libvpx. value is work / best seconds.
+static BenchResult measure(const std::string& name, const char* pUnit, double work, int runCount,
+						   const std::function<double()>& func)
+{
+	BenchResult result;
+	result.name = name;
+	result.unit = pUnit;
+	result.runCount = runCount;
+	double totalMs = 0;
+	for(int run = 0; run < runCount; run++)
+	{
+		double ms = func();
+		result.bestMs = run == 0 ? ms : std::min(result.bestMs, ms);
+		totalMs += ms;
+	}
+	result.meanMs = totalMs / runCount;
+	result.value = work / (std::max(result.bestMs, 1e-6) / 1000.0);
+	return result;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// Demuxes the whole file and touches every page of the chunk data, so zero-copy backends pay
+// for their page faults like the others do for their copies.
+//-----------------------------------------------------------------------------------------------// 
+
+static volatile uint8_t s_sink; // keeps the reads of the chunk bytes alive
+
+struct DemuxResult
+{
+	double ms = 0;
+	uint64_t packetCount = 0;
+	uint64_t chunkBytes = 0;
+};
+
+static DemuxResult benchDemux(const std::string& file, IoBackend backend)
+{
+	DemuxResult result;
+	uint8_t checksum = 0;
+	Timer timer;
+
+	Demuxer demuxer;
+	demuxer.openFile(file, backend);
+	DemuxPacket packet;
+	while(demuxer.readPacket(packet))
+	{
+		for(uint chunkIdx = 0; chunkIdx < packet.chunkCount(); chunkIdx++)
+		{
+			const uint8_t* pData = nullptr;
+			size_t size = 0;
+			packet.chunk(chunkIdx, pData, size);
+			for(size_t i = 0; i < size; i += 4096)
+				checksum ^= pData[i];
+			result.chunkBytes += size;
+		}
+		result.packetCount++;
+	}
+	packet.reset();
+
+	result.ms = timer.elapsedMs();
+	s_sink = checksum;
+	return result;
+}
+
+static void benchDemuxBackends(const BenchClip& clip, int runCount, BenchReport& rReport)
+{
+	// the first run of the first backend reads a cold file if the cache was flushed before
+	const IoBackend backends[] = { IoBackend::Stdio, IoBackend::MemoryMap, IoBackend::ReadAhead };
+	for(IoBackend backend : backends)
+	{
+		DemuxResult demux = benchDemux(clip.file, backend);
+		std::string name = "demux/" + clip.name + "/" + toString(backend);
+		rReport.add(measure(name, "MB/s", double(demux.chunkBytes) / (1 << 20), runCount, [&]
+		{
+			return benchDemux(clip.file, backend).ms;
+		}));
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// Decoding, only the time in vpx_codec_decode counts. The streams of the synthetic clips are
+// frame parallel with several tile columns, so the libvpx threads have work.
+//-----------------------------------------------------------------------------------------------// 
+
+static void benchDecode(const BenchClip& clip, int runCount, BenchReport& rReport)
+{
+	std::vector<int> threadCounts;
+	int hardwareThreads = ThreadPool::hardwareThreads();
+	for(int threadCount = 1; threadCount < hardwareThreads && threadCount <= 8; threadCount *= 2)
+		threadCounts.push_back(threadCount);
+	threadCounts.push_back(hardwareThreads);
+
+	for(int threadCount : threadCounts)
+	{
+		std::string name = "decode/" + clip.name + "/threads=" + std::to_string(threadCount);
+		rReport.add(measure(name, "frames/s", double(clip.frameCount), runCount, [&]
+		{
+			DecoderOptions options;
+			options.threadCount = threadCount;
+			Decoder decoder;
+			decoder.openFile(clip.file, options);
+			DecodeTimings timings;
+			double decodeMs = 0;
+			while(decoder.decodeNextFrame(&timings))
+				decodeMs += timings.decodeMs;
+			return decodeMs;
+		}));
+	}
+
+	// one decoder per keyframe segment, the wall time counts
+	FileIndex index;
+	buildFileIndex(clip.file, index);
+	std::string name = "decode/" + clip.name + "/segmented";
+	rReport.add(measure(name, "frames/s", double(clip.frameCount), runCount, [&]
+	{
+		SegmentDecodeStats stats;
+		decodeSegments(clip.file, index, SegmentDecodeOptions(), [](uint64_t, const Decoder&) {}, &stats);
+		return stats.ms;
+	}));
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// Full passes over the file on a DecodePipeline, the wall time counts: decoding with conversion
+// to RGB on all cores as a player would, and analyzeFile() with decoding as the batch tool runs it.
+//-----------------------------------------------------------------------------------------------// 
+
+static void benchPipeline(const BenchClip& clip, int runCount, BenchReport& rReport)
+{
+	rReport.add(measure("pipeline/" + clip.name + "/convert", "frames/s", double(clip.frameCount), runCount, [&]
+	{
+		Timer timer;
+		PipelineOptions options;
+		options.convertThreads = 0;
+		DecodePipeline pipeline;
+		pipeline.openFile(clip.file, options);
+		PipelineFrame frame;
+		while(pipeline.nextFrame(frame))
+			pipeline.recycleFrame(frame);
+		return timer.elapsedMs();
+	}));
+
+	rReport.add(measure("pipeline/" + clip.name + "/analyze", "frames/s", double(clip.frameCount), runCount, [&]
+	{
+		FileSummary summary;
+		analyzeFile(clip.file, AnalysisOptions(), nullptr, summary);
+		if(!summary.error.empty())
+			throw DecoderError(summary.error);
+		return summary.totalMs;
+	}));
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// Colour conversion of a decoded frame, per instruction set on one thread and with all cores.
+//-----------------------------------------------------------------------------------------------// 
+
+static void benchConvert(const BenchClip& clip, int runCount, BenchReport& rReport)
+{
+	Decoder decoder;
+	decoder.openFile(clip.file);
+	if(!decoder.decodeNextFrame())
+		return;
+
+	// enough conversions for a measurable time, about 100 megapixels
+	double megapixels = double(clip.width) * clip.height / 1e6;
+	int convertCount = std::max(4, int(100 / megapixels));
+	FrameBuf<RGB8> rgb;
+	auto convertFrames = [&]
+	{
+		Timer timer;
+		for(int convertIdx = 0; convertIdx < convertCount; convertIdx++)
+			decoder.convertCurrentFrame(rgb);
+		return timer.elapsedMs();
+	};
+
+	SimdLevel bestLevel = detectSimdLevel();
+	decoder.setConvertThreadCount(1);
+	for(int level = int(SimdLevel::Scalar); level <= int(bestLevel); level++)
+	{
+		decoder.setSimdLevel(SimdLevel(level));
+		std::string name = "convert/" + clip.name + "/" + toString(SimdLevel(level));
+		rReport.add(measure(name, "MP/s", megapixels * convertCount, runCount, convertFrames));
+	}
+
+	decoder.setSimdLevel(bestLevel);
+	decoder.setConvertThreadCount(0);
+	std::string name = "convert/" + clip.name + "/" + toString(bestLevel) + "/threads=" +
+					   std::to_string(decoder.convertThreadCount());
+	rReport.add(measure(name, "MP/s", megapixels * convertCount, runCount, convertFrames));
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// FrameBuf allocation of an RGB frame of the clip's size, from the pool and from the heap. Every
+// page is written once, an untouched allocation would hide the cost of fresh memory.
+//-----------------------------------------------------------------------------------------------// 
+
+static void benchAlloc(const BenchClip& clip, int runCount, BenchReport& rReport)
+{
+	const int AllocCount = 200;
+	FrameAllocator* allocators[] = { &FramePool::shared(), &heapFrameAllocator() };
+	const char* names[] = { "pool", "heap" };
+	for(int allocatorIdx = 0; allocatorIdx < 2; allocatorIdx++)
+	{
+		FrameAllocator& rAllocator = *allocators[allocatorIdx];
+		std::string name = "alloc/" + clip.name + "/" + names[allocatorIdx];
+		BenchResult result = measure(name, "allocs/s", AllocCount, runCount, [&]
+		{
+			uint8_t checksum = 0;
+			Timer timer;
+			for(int allocIdx = 0; allocIdx < AllocCount; allocIdx++)
+			{
+				FrameBuf<RGB8> frame(clip.width, clip.height, rAllocator);
+				uint8_t* pBytes = &frame.data()->r;
+				size_t size = frame.stride() * frame.height();
+				for(size_t i = 0; i < size; i += 4096)
+					pBytes[i] = uint8_t(i);
+				checksum ^= pBytes[size / 2];
+			}
+			s_sink = checksum;
+			return timer.elapsedMs();
+		});
+		rReport.add(result);
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// Opening a file in the viewer with an AnalysisJob: the time until the first frame is there, and
+// until the whole file is scanned. The sidecar is removed before every run, so the scan counts
+// and not the load of the index. A given file keeps its sidecar, the runs open a copy of it in
+// the clip directory.
+//-----------------------------------------------------------------------------------------------// 
+
+static void copyFile(const std::string& from, const std::string& to)
+{
+	FILE* pFrom = fopen(from.c_str(), "rb");
+	if(!pFrom)
+		throw DecoderError("Can't read " + from);
+	FILE* pTo = fopen(to.c_str(), "wb");
+	if(!pTo)
+	{
+		fclose(pFrom);
+		throw DecoderError("Can't write " + to);
+	}
+
+	std::vector<char> buffer(1 << 20);
+	bool ok = true;
+	while(size_t size = fread(buffer.data(), 1, buffer.size(), pFrom))
+		ok = ok && fwrite(buffer.data(), 1, size, pTo) == size;
+	ok = ok && !ferror(pFrom);
+	fclose(pFrom);
+	ok = fclose(pTo) == 0 && ok;
+	if(!ok)
+		throw DecoderError("Can't copy " + from + " to " + to);
+}
+
+// the job's times in ms, until the first frame or until it is done
+static double runAnalysisJob(const std::string& file, bool untilDone)
+{
+	std::remove(sidecarPath(file).c_str());
+	AnalysisJob job;
+	job.openFile(file);
+	AnalysisUpdate update;
+	for(;;)
+	{
+		if(job.takeUpdate(update))
+		{
+			if(!untilDone && update.progress.firstFrameMs >= 0)
+				return update.progress.firstFrameMs;
+			if(update.progress.finished)
+				return update.progress.elapsedMs;
+		}
+		else if(job.done())
+			throw DecoderError("Analysis stopped early");
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+static void benchOpen(const BenchClip& clip, const std::string& clipDir, int runCount, BenchReport& rReport)
+{
+	std::string file = clip.file;
+	if(!clip.synthetic)
+	{
+		file = clipDir + "/mpx-bench-open.webm";
+		copyFile(clip.file, file);
+	}
+
+	rReport.add(measure("open/" + clip.name + "/first-frame", "opens/s", 1, runCount, [&]
+	{
+		return runAnalysisJob(file, false);
+	}));
+	rReport.add(measure("open/" + clip.name + "/scan", "MB/s", double(clip.bytes) / (1 << 20), runCount, [&]
+	{
+		return runAnalysisJob(file, true);
+	}));
+
+	if(!clip.synthetic)
+	{
+		std::remove(sidecarPath(file).c_str());
+		std::remove(file.c_str());
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// The packet model of a long recording, made by repeating the packets of the clip, as flat tables
+// and as CompactBitStream: the size per packet, encoding, a pass with a cursor and single packets
+// at random positions.
+//-----------------------------------------------------------------------------------------------// 
+
+static BitStream repeatPackets(const BitStream& bitStream, size_t packetCount)
+{
+	BitStream result;
+	if(bitStream.packets.empty())
+		return result;
+
+	const BitStream::Packet& last = bitStream.packets.back();
+	uint64_t byteStep = last.range.end;
+	uint64_t packetStep = last.packetIdx + 1;
+	uint64_t timeStep = last.timestamp + (bitStream.packets.size() > 1 ? last.timestamp / (bitStream.packets.size() - 1) : 1);
+	result.packets.reserve(packetCount);
+	for(size_t packetPos = 0; packetPos < packetCount; packetPos++)
+	{
+		uint64_t round = packetPos / bitStream.packets.size();
+		BitStream::Packet packet = bitStream.packets[packetPos % bitStream.packets.size()];
+		BlockU chunks = packet.chunks;
+		packet.packetIdx += round * packetStep;
+		packet.timestamp += round * timeStep;
+		packet.range.begin += round * byteStep;
+		packet.range.end += round * byteStep;
+		packet.chunks.begin = uint(result.chunks.size());
+		for(uint chunkIdx = 0; chunkIdx < chunks.size; chunkIdx++)
+		{
+			BitStream::Chunk chunk = bitStream.chunks[chunks.begin + chunkIdx];
+			chunk.packetIdx = uint(packet.packetIdx);
+			chunk.range.begin += round * byteStep;
+			chunk.range.end += round * byteStep;
+			result.chunks.push_back(chunk);
+		}
+		result.packets.push_back(packet);
+	}
+	return result;
+}
+
+static void benchModel(const BenchClip& clip, int runCount, BenchReport& rReport)
+{
+	const size_t PacketCount = 1 << 20;
+	const size_t LookupCount = 100000;
+	FileIndex index;
+	buildFileIndex(clip.file, index);
+	BitStream bitStream = repeatPackets(index.bitStream, PacketCount);
+	if(bitStream.packets.empty())
+		return;
+
+	CompactBitStream compact;
+	compact.encode(bitStream);
+	size_t flatBytes = bitStream.packets.size() * sizeof(BitStream::Packet) + bitStream.chunks.size() * sizeof(BitStream::Chunk);
+	const char* names[] = { "flat", "compact" };
+	size_t sizes[] = { flatBytes, compact.byteSize() };
+	for(int sizeIdx = 0; sizeIdx < 2; sizeIdx++)
+	{
+		BenchResult result;
+		result.name = "model/" + clip.name + "/" + names[sizeIdx];
+		result.unit = "bytes/packet";
+		result.value = double(sizes[sizeIdx]) / double(PacketCount);
+		result.runCount = 1;
+		rReport.add(result);
+	}
+
+	rReport.add(measure("model/" + clip.name + "/encode", "packets/s", double(PacketCount), runCount, [&]
+	{
+		Timer timer;
+		CompactBitStream encoded;
+		encoded.encode(bitStream);
+		return timer.elapsedMs();
+	}));
+	rReport.add(measure("model/" + clip.name + "/cursor", "packets/s", double(PacketCount), runCount, [&]
+	{
+		Timer timer;
+		uint64_t bytes = 0;
+		CompactBitStream::Cursor cursor(compact);
+		while(cursor.nextBlock())
+		{
+			for(const BitStream::Packet& packet : cursor.packets())
+			{
+				for(uint chunkIdx = 0; chunkIdx < packet.chunks.size; chunkIdx++)
+					bytes += cursor.chunk(packet, chunkIdx).range.end - cursor.chunk(packet, chunkIdx).range.begin;
+			}
+		}
+		s_sink = uint8_t(bytes);
+		return timer.elapsedMs();
+	}));
+	rReport.add(measure("model/" + clip.name + "/random", "packets/s", double(LookupCount), runCount, [&]
+	{
+		Timer timer;
+		BitStream::Packet packet;
+		std::vector<BitStream::Chunk> chunks;
+		uint64_t bytes = 0;
+		for(size_t lookupIdx = 0; lookupIdx < LookupCount; lookupIdx++)
+		{
+			compact.packet(lookupIdx * 7919 % PacketCount, packet, chunks);
+			bytes += packet.range.end - packet.range.begin;
+		}
+		s_sink = uint8_t(bytes);
+		return timer.elapsedMs();
+	}));
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// Check of the conversion kernels (--check): every kernel the cpu has must give the same bytes as
+// toRGB(YUV8). Runs on all 2^24 inputs, on row widths around the 16 pixel steps of the kernels
+// and on whole images of odd sizes with and without a pool.
+//-----------------------------------------------------------------------------------------------// 
+
+static bool sameRGB(RGB8 a, RGB8 b)
+{
+	return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+// the number of pixels of row that differ from toRGB(), reports the first one
+static int checkRow(const char* pName, SimdLevel level, const uint8_t* pY, const uint8_t* pU, const uint8_t* pV,
+					const RGB8* pRow, int width)
+{
+	int mismatchCount = 0;
+	for(int i = 0; i < width; i++)
+	{
+		YUV8 yuv = { pY[i], pU[i >> 1], pV[i >> 1] };
+		RGB8 expected = toRGB(yuv);
+		if(sameRGB(pRow[i], expected))
+			continue;
+		if(mismatchCount++ == 0)
+		{
+			printf("%s/%s: yuv %d %d %d at %d is %d %d %d instead of %d %d %d\n", pName, toString(level), yuv.y, yuv.u,
+				   yuv.v, i, pRow[i].r, pRow[i].g, pRow[i].b, expected.r, expected.g, expected.b);
+		}
+	}
+	return mismatchCount;
+}
+
+// one row per v, y counts up in every run of 256 pixels and u once per run
+static int checkAllInputs(SimdLevel level)
+{
+	const int Width = 1 << 16;
+	std::vector<uint8_t> y(Width), u(Width / 2), v(Width / 2);
+	std::vector<RGB8> row(Width);
+	for(int i = 0; i < Width; i++)
+		y[i] = uint8_t(i);
+	for(int i = 0; i < Width / 2; i++)
+		u[i] = uint8_t(i >> 7);
+
+	ConvertRowFunc convertRow = getConvertRowFunc(level);
+	int mismatchCount = 0;
+	for(int vValue = 0; vValue < 256; vValue++)
+	{
+		std::fill(v.begin(), v.end(), uint8_t(vValue));
+		convertRow(y.data(), u.data(), v.data(), row.data(), Width);
+		mismatchCount += checkRow("inputs", level, y.data(), u.data(), v.data(), row.data(), Width);
+	}
+	return mismatchCount;
+}
+
+// Widths up to three times the widest step and unaligned rows. The pixel after the row must stay
+// untouched.
+static int checkWidths(SimdLevel level)
+{
+	const int MaxWidth = 100;
+	const int MaxOffset = 4;
+	const RGB8 guard = { 0x5a, 0xa5, 0x3c };
+	std::vector<uint8_t> y(MaxWidth + MaxOffset), u(MaxWidth + MaxOffset), v(MaxWidth + MaxOffset);
+	std::vector<RGB8> row(MaxWidth + MaxOffset + 1);
+	uint32_t random = 12345;
+	for(size_t i = 0; i < y.size(); i++)
+	{
+		random = random * 1103515245 + 12345;
+		y[i] = uint8_t(random >> 8);
+		u[i] = uint8_t(random >> 16);
+		v[i] = uint8_t(random >> 24);
+	}
+
+	ConvertRowFunc convertRow = getConvertRowFunc(level);
+	int mismatchCount = 0;
+	for(int offset = 0; offset < MaxOffset; offset++)
+	{
+		for(int width = 1; width <= MaxWidth; width++)
+		{
+			std::fill(row.begin(), row.end(), guard);
+			convertRow(&y[offset], &u[offset], &v[offset], &row[offset], width);
+			mismatchCount += checkRow("widths", level, &y[offset], &u[offset], &v[offset], &row[offset], width);
+			if(!sameRGB(row[offset + width], guard))
+			{
+				printf("widths/%s: width %d writes past the row\n", toString(level), width);
+				mismatchCount++;
+			}
+		}
+	}
+	return mismatchCount;
+}
+
+// convertI420() on odd widths and heights, the chroma planes are rounded up
+static int checkImages(SimdLevel level, ThreadPool* pPool)
+{
+	const int sizes[][2] = { { 1, 1 }, { 3, 5 }, { 17, 3 }, { 33, 9 }, { 95, 67 }, { 641, 361 } };
+	int mismatchCount = 0;
+	for(const auto& size : sizes)
+	{
+		int width = size[0];
+		int height = size[1];
+		int chromaWidth = (width + 1) / 2;
+		int chromaHeight = (height + 1) / 2;
+		std::vector<uint8_t> planes[3];
+		planes[0].resize(width * height);
+		planes[1].resize(chromaWidth * chromaHeight);
+		planes[2].resize(chromaWidth * chromaHeight);
+		uint32_t random = uint32_t(width * 31 + height);
+		for(std::vector<uint8_t>& rPlane : planes)
+		{
+			for(uint8_t& rValue : rPlane)
+			{
+				random = random * 1103515245 + 12345;
+				rValue = uint8_t(random >> 16);
+			}
+		}
+
+		I420Planes src;
+		for(int planeIdx = 0; planeIdx < 3; planeIdx++)
+		{
+			src.pPlanes[planeIdx] = planes[planeIdx].data();
+			src.strides[planeIdx] = planeIdx == 0 ? width : chromaWidth;
+		}
+		src.width = width;
+		src.height = height;
+
+		FrameBuf<RGB8> rgb;
+		convertI420(src, rgb, level, pPool);
+		for(int j = 0; j < height; j++)
+		{
+			const uint8_t* pY = src.pPlanes[0] + j * src.strides[0];
+			const uint8_t* pU = src.pPlanes[1] + (j >> 1) * src.strides[1];
+			const uint8_t* pV = src.pPlanes[2] + (j >> 1) * src.strides[2];
+			mismatchCount += checkRow(pPool ? "images/pool" : "images", level, pY, pU, pV, rgb.row(j), width);
+		}
+	}
+	return mismatchCount;
+}
+
+// the number of mismatches of all kernels
+static int checkConvert()
+{
+	ThreadPool pool;
+	int mismatchCount = 0;
+	SimdLevel bestLevel = detectSimdLevel();
+	for(int level = int(SimdLevel::Scalar); level <= int(bestLevel); level++)
+	{
+		int levelMismatches = checkAllInputs(SimdLevel(level)) + checkWidths(SimdLevel(level)) +
+							  checkImages(SimdLevel(level), nullptr) + checkImages(SimdLevel(level), &pool);
+		printf("convert/%-10s %s\n", toString(SimdLevel(level)), levelMismatches == 0 ? "ok" : "FAILED");
+		fflush(stdout);
+		mismatchCount += levelMismatches;
+	}
+	return mismatchCount;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// Clips
+//-----------------------------------------------------------------------------------------------// 
+
+static bool fileExists(const std::string& file)
+{
+	FILE* pFile = fopen(file.c_str(), "rb");
+	if(pFile)
+		fclose(pFile);
+	return pFile != nullptr;
+}
+
+// the size and frame count from a pass over the headers
+static BenchClip describeClip(const std::string& name, const std::string& file)
+{
+	BenchClip clip;
+	clip.name = name;
+	clip.file = file;
+
+	FileIndex index;
+	buildFileIndex(file, index);
+	for(const FrameHeader& header : index.bitStream.frames)
+	{
+		if(clip.width == 0 && header.width > 0)
+		{
+			clip.width = header.width;
+			clip.height = header.height;
+		}
+		clip.bytes += header.size;
+	}
+	clip.frameCount = index.keyFrameIndex.frameCount();
+	return clip;
+}
+
+static BenchClip syntheticClip(const std::string& size, const BenchOptions& options)
+{
+	SyntheticClipOptions clipOptions;
+	clipOptions.frameCount = options.frameCount;
+	if(size == "360p")
+	{
+		clipOptions.width = 640;
+		clipOptions.height = 360;
+	}
+	else if(size == "1080p")
+	{
+		clipOptions.width = 1920;
+		clipOptions.height = 1080;
+	}
+	else if(size == "4k")
+	{
+		clipOptions.width = 3840;
+		clipOptions.height = 2160;
+	}
+	else
+	{
+		throw DecoderError("Unknown clip size " + size);
+	}
+
+	std::string file = options.clipDir + "/mpx-bench-" + size + "-" + std::to_string(options.frameCount) + ".webm";
+	if(!fileExists(file))
+	{
+		printf("encoding %s\n", file.c_str());
+		fflush(stdout);
+		encodeSyntheticClip(file, clipOptions);
+	}
+	BenchClip clip = describeClip(size, file);
+	clip.synthetic = true;
+	return clip;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// Check of the segmented decode (--check): decodeSegments() has to give the same frames as one
+// decoder going from the start. The clip has alt-ref frames, so segments begin after superframes
+// whose hidden frames must not shift the frame numbers.
+//-----------------------------------------------------------------------------------------------// 
+
+// FNV-1a over the pixels of the planes, the padding is left out
+static uint64_t hashPlanes(const I420Planes& planes)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for(int planeIdx = 0; planeIdx < 3; planeIdx++)
+	{
+		PlaneView<const uint8_t> plane = planes.plane(planeIdx);
+		for(int y = 0; y < plane.height(); y++)
+		{
+			const uint8_t* pRow = plane.row(y);
+			for(int x = 0; x < plane.width(); x++)
+				hash = (hash ^ pRow[x]) * 1099511628211ull;
+		}
+	}
+	return hash;
+}
+
+static uint64_t currentFrameHash(const Decoder& decoder)
+{
+	I420Planes planes;
+	return decoder.currentPlanes(planes) ? hashPlanes(planes) : 0;
+}
+
+// the clip of the checks, encoded once
+static std::string checkClip(const std::string& clipDir)
+{
+	SyntheticClipOptions clipOptions;
+	clipOptions.width = 320;
+	clipOptions.height = 180;
+	clipOptions.frameCount = 60;
+	clipOptions.keyFrameInterval = 10;
+	clipOptions.altRef = true;
+	std::string file = clipDir + "/mpx-check-altref.webm";
+	if(!fileExists(file))
+	{
+		printf("encoding %s\n", file.c_str());
+		fflush(stdout);
+		encodeSyntheticClip(file, clipOptions);
+	}
+	return file;
+}
+
+// the number of frames that differ
+static int checkSegments(const std::string& file)
+{
+	FileIndex index;
+	buildFileIndex(file, index);
+	uint64_t frameCount = index.keyFrameIndex.frameCount();
+	if(index.bitStream.frames.size() <= frameCount || index.keyFrameIndex.keyFrames().size() < 2)
+		throw DecoderError(file + " has no hidden frames or only one segment");
+
+	std::vector<uint64_t> serialHashes;
+	Decoder decoder;
+	decoder.openFile(file);
+	while(decoder.decodeNextFrame())
+		serialHashes.push_back(currentFrameHash(decoder));
+
+	SegmentDecodeOptions options;
+	std::vector<uint64_t> segmentHashes = mapFrames<uint64_t>(file, index, options, [](uint64_t, const Decoder& decoder)
+	{
+		return currentFrameHash(decoder);
+	});
+
+	int mismatchCount = serialHashes.size() == frameCount ? 0 : 1;
+	for(size_t frameIdx = 0; frameIdx < segmentHashes.size(); frameIdx++)
+	{
+		if(frameIdx >= serialHashes.size() || segmentHashes[frameIdx] != serialHashes[frameIdx])
+		{
+			if(mismatchCount == 0)
+				printf("frame %llu differs\n", (unsigned long long)frameIdx);
+			mismatchCount++;
+		}
+	}
+	printf("segments/%-9s %s\n", "altref", mismatchCount == 0 ? "ok" : "FAILED");
+	fflush(stdout);
+	return mismatchCount;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// Check of the packet model (--check): a CompactBitStream, encoded at once or appended in
+// batches, has to give back the packets and chunks of the flat BitStream, decoded as a whole,
+// as single packets and through cursors that start anywhere, inside a block or on a checkpoint.
+//-----------------------------------------------------------------------------------------------// 
+
+static bool samePacket(const BitStream::Packet& a, const BitStream::Packet& b)
+{
+	return a.packetIdx == b.packetIdx && a.timestamp == b.timestamp && a.range.begin == b.range.begin &&
+		   a.range.end == b.range.end && a.trackIdx == b.trackIdx && a.chunks.begin == b.chunks.begin &&
+		   a.chunks.size == b.chunks.size;
+}
+
+static bool sameChunk(const BitStream::Chunk& a, const BitStream::Chunk& b)
+{
+	return a.chunkIdx == b.chunkIdx && a.packetIdx == b.packetIdx && a.range.begin == b.range.begin &&
+		   a.range.end == b.range.end && a.keyFrame == b.keyFrame && a.shown == b.shown;
+}
+
+// Packets no encoder writes: up to three chunks with gaps, timestamps that jump and go back,
+// packet numbers with holes and several tracks. Every difference the model predicts is off.
+static BitStream irregularPackets(size_t packetCount)
+{
+	BitStream bitStream;
+	uint32_t random = 12345;
+	auto next = [&random](uint32_t range)
+	{
+		random = random * 1664525 + 1013904223;
+		return (random >> 8) % range;
+	};
+
+	uint64_t packetIdx = 0;
+	uint64_t timestamp = 1000000000;
+	uint64_t offset = 4096;
+	for(size_t packetPos = 0; packetPos < packetCount; packetPos++)
+	{
+		BitStream::Packet packet;
+		packetIdx += 1 + (next(8) == 0 ? next(1000) : 0);
+		timestamp = next(16) == 0 ? timestamp - next(100000000) : timestamp + 33366667 + next(1000);
+		offset += next(4) == 0 ? next(1 << 20) : 0;
+		packet.packetIdx = packetIdx;
+		packet.timestamp = timestamp;
+		packet.range.begin = offset;
+		packet.trackIdx = next(3);
+		packet.chunks.begin = uint(bitStream.chunks.size());
+		packet.chunks.size = 1 + next(3);
+		uint64_t chunkEnd = offset + next(16);
+		for(uint chunkIdx = 0; chunkIdx < packet.chunks.size; chunkIdx++)
+		{
+			BitStream::Chunk chunk;
+			chunk.chunkIdx = chunkIdx;
+			chunk.packetIdx = uint(packetIdx);
+			chunk.range.begin = chunkEnd + next(4);
+			chunk.range.end = chunk.range.begin + (next(32) == 0 ? next(1 << 24) : next(5000));
+			chunk.keyFrame = next(30) == 0;
+			chunk.shown = next(5) != 0;
+			chunkEnd = chunk.range.end;
+			bitStream.chunks.push_back(chunk);
+		}
+		packet.range.end = chunkEnd + next(16);
+		offset = packet.range.end;
+		bitStream.packets.push_back(packet);
+	}
+	return bitStream;
+}
+
+// the number of packets and chunks of model that differ from bitStream
+static int compareModel(const BitStream& bitStream, const CompactBitStream& model)
+{
+	int mismatchCount = 0;
+	if(model.packetCount() != bitStream.packets.size() || model.chunkCount() != bitStream.chunks.size())
+		return 1;
+
+	BitStream decoded;
+	model.decode(decoded);
+	for(size_t packetPos = 0; packetPos < bitStream.packets.size(); packetPos++)
+		mismatchCount += samePacket(decoded.packets[packetPos], bitStream.packets[packetPos]) ? 0 : 1;
+	for(size_t chunkPos = 0; chunkPos < bitStream.chunks.size(); chunkPos++)
+		mismatchCount += sameChunk(decoded.chunks[chunkPos], bitStream.chunks[chunkPos]) ? 0 : 1;
+
+	// single packets around the checkpoints and spread over the rest
+	size_t blockPackets = CompactBitStream::BlockPackets;
+	std::vector<size_t> positions = { 0, 1, blockPackets - 1, blockPackets, blockPackets + 1, bitStream.packets.size() - 1 };
+	for(size_t packetPos = 0; packetPos < bitStream.packets.size(); packetPos += 37)
+		positions.push_back(packetPos);
+	BitStream::Packet packet;
+	std::vector<BitStream::Chunk> chunks;
+	for(size_t packetPos : positions)
+	{
+		if(packetPos >= bitStream.packets.size())
+			continue;
+		const BitStream::Packet& expected = bitStream.packets[packetPos];
+		model.packet(packetPos, packet, chunks);
+		bool same = samePacket(packet, expected) && chunks.size() == expected.chunks.size;
+		for(uint chunkIdx = 0; same && chunkIdx < expected.chunks.size; chunkIdx++)
+			same = sameChunk(chunks[chunkIdx], bitStream.chunk(expected, chunkIdx));
+		mismatchCount += same ? 0 : 1;
+	}
+
+	// cursors from the same positions to the end
+	for(size_t firstPacket : positions)
+	{
+		if(firstPacket >= bitStream.packets.size())
+			continue;
+		CompactBitStream::Cursor cursor(model, firstPacket);
+		size_t packetPos = firstPacket;
+		while(cursor.nextBlock())
+		{
+			if(cursor.firstPacket() != packetPos)
+			{
+				mismatchCount++;
+				break;
+			}
+			for(const BitStream::Packet& cursorPacket : cursor.packets())
+			{
+				const BitStream::Packet& expected = bitStream.packets[packetPos++];
+				bool same = samePacket(cursorPacket, expected);
+				for(uint chunkIdx = 0; same && chunkIdx < expected.chunks.size; chunkIdx++)
+					same = sameChunk(cursor.chunk(cursorPacket, chunkIdx), bitStream.chunk(expected, chunkIdx));
+				mismatchCount += same ? 0 : 1;
+			}
+		}
+		mismatchCount += packetPos == bitStream.packets.size() ? 0 : 1;
+	}
+	return mismatchCount;
+}
+
+// the number of differences of the clip's packets, repeated over many blocks, and of irregular ones
+static int checkModel(const std::string& file)
+{
+	FileIndex index;
+	buildFileIndex(file, index);
+	const BitStream bitStreams[] = { repeatPackets(index.bitStream, 1000), irregularPackets(1000) };
+	const char* names[] = { "clip", "irregular" };
+
+	int mismatchCount = 0;
+	for(int streamIdx = 0; streamIdx < 2; streamIdx++)
+	{
+		const BitStream& bitStream = bitStreams[streamIdx];
+		CompactBitStream encoded;
+		encoded.encode(bitStream);
+
+		// batches of a running scan, with sizes around the block size
+		CompactBitStream appended;
+		BitStream scanned;
+		scanned.chunks = bitStream.chunks;
+		size_t batchSizes[] = { 1, 62, 64, 65, 127 };
+		for(size_t packetPos = 0, batchIdx = 0; packetPos < bitStream.packets.size(); batchIdx++)
+		{
+			size_t batchEnd = std::min(packetPos + batchSizes[batchIdx % 5], bitStream.packets.size());
+			scanned.packets.assign(bitStream.packets.begin(), bitStream.packets.begin() + batchEnd);
+			appended.append(scanned, packetPos);
+			packetPos = batchEnd;
+		}
+
+		int streamMismatches = compareModel(bitStream, encoded) + compareModel(bitStream, appended);
+		printf("model/%-12s %s\n", names[streamIdx], streamMismatches == 0 ? "ok" : "FAILED");
+		fflush(stdout);
+		mismatchCount += streamMismatches;
+	}
+	return mismatchCount;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+static bool parseArgs(int argc, char* argv[], BenchOptions& rOptions)
+{
+	bool synthetic = true;
+	for(int argIdx = 1; argIdx < argc; argIdx++)
+	{
+		std::string arg = argv[argIdx];
+		bool hasValue = argIdx + 1 < argc;
+		if(arg == "-o" && hasValue)
+			rOptions.jsonFile = argv[++argIdx];
+		else if(arg == "--runs" && hasValue)
+			rOptions.runCount = std::max(1, atoi(argv[++argIdx]));
+		else if(arg == "--frames" && hasValue)
+			rOptions.frameCount = std::max(1, atoi(argv[++argIdx]));
+		else if(arg == "--clips" && hasValue)
+			rOptions.clipDir = argv[++argIdx];
+		else if(arg == "--sizes" && hasValue)
+		{
+			std::string sizes = argv[++argIdx];
+			for(size_t begin = 0; begin <= sizes.size();)
+			{
+				size_t end = std::min(sizes.find(',', begin), sizes.size());
+				if(end > begin)
+					rOptions.sizes.push_back(sizes.substr(begin, end - begin));
+				begin = end + 1;
+			}
+		}
+		else if(arg == "--no-synthetic")
+			synthetic = false;
+		else if(arg == "--check")
+			rOptions.check = true;
+		else if(!arg.empty() && arg[0] == '-')
+			return false;
+		else
+			rOptions.files.push_back(arg);
+	}
+
+	if(rOptions.check)
+		return true;
+	if(!synthetic)
+		rOptions.sizes.clear();
+	else if(rOptions.sizes.empty())
+		rOptions.sizes = { "360p", "1080p", "4k" };
+	return !rOptions.sizes.empty() || !rOptions.files.empty();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+int main(int argc, char* argv[])
+{
+	BenchOptions options;
+	if(!parseArgs(argc, argv, options))
+	{
+		printf("usage: Bench [options] [file.webm...]\n"
+			   "  -o <file.json>     write the results as JSON\n"
+			   "  --runs <n>         runs per measurement, the best one counts (default 3)\n"
+			   "  --sizes <list>     synthetic clips, any of 360p,1080p,4k (default all)\n"
+			   "  --frames <n>       frames of the synthetic clips (default 60)\n"
+			   "  --clips <dir>      where the synthetic clips are kept (default .)\n"
+			   "  --no-synthetic     only the given files\n"
+			   "  --check            only check the conversion kernels against toRGB(), the segmented\n"
+			   "                     decode against a serial one and the packet model, exits with 2 on\n"
+			   "                     a mismatch\n");
+		return 1;
+	}
+
+	if(options.check)
+	{
+		try
+		{
+			std::string file = checkClip(options.clipDir);
+			int mismatchCount = checkConvert() + checkSegments(file) + checkModel(file);
+			return mismatchCount == 0 ? 0 : 2;
+		}
+		catch(DecoderError& error)
+		{
+			printf("error: %s\n", error.what());
+			return 1;
+		}
+	}
+
+	try
+	{
+		std::vector<BenchClip> clips;
+		for(const std::string& size : options.sizes)
+			clips.push_back(syntheticClip(size, options));
+		for(const std::string& file : options.files)
+			clips.push_back(describeClip(file, file));
+
+		BenchReport report;
+		for(const BenchClip& clip : clips)
+		{
+			printf("\n%s: %dx%d, %llu frames, %.1f MB\n", clip.name.c_str(), clip.width, clip.height,
+				   (unsigned long long)clip.frameCount, double(clip.bytes) / (1 << 20));
+			report.addClip(clip);
+			benchDemuxBackends(clip, options.runCount, report);
+			benchDecode(clip, options.runCount, report);
+			benchPipeline(clip, options.runCount, report);
+			benchConvert(clip, options.runCount, report);
+			benchAlloc(clip, options.runCount, report);
+			benchOpen(clip, options.clipDir, options.runCount, report);
+			benchModel(clip, options.runCount, report);
+		}
+
+		if(!options.jsonFile.empty())
+			report.writeJson(options.jsonFile, options);
+	}
+	catch(DecoderError& error)
+	{
+		printf("error: %s\n", error.what());
+		return 1;
+	}
+	return 0;
+}
+
+//-----------------------------------------------------------------------------------------------// 
\ No newline at end of file
@@ -0,0 +1,91 @@
+//-----------------------------------------------------------------------------------------------// 
+// Filmstrip.cpp
+//-----------------------------------------------------------------------------------------------// 
+#include <Filmstrip.qt.h>
+#include <QtWidgets>
+#include <Trace.h>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+
+Filmstrip::Filmstrip(QWidget* pParent)
+	: QListWidget(pParent)
+{
+	// a few thousand items at most, a thumbnail of every frame of a long clip would take
+	// gigabytes and the list view would crawl
+	m_options.maxThumbnails = 2000;
+	// the analysis job of the MainWindow scans the file anyway, its index comes with
+	// setKeyFrameIndex()
+	m_options.scanForIndex = false;
+
+	setViewMode(QListView::IconMode);
+	setFlow(QListView::LeftToRight);
+	setWrapping(false);
+	setMovement(QListView::Static);
+	setUniformItemSizes(true);
+	setIconSize(QSize(m_options.maxWidth, m_options.maxHeight));
+	setFixedHeight(m_options.maxHeight + 50);
+	setHorizontalScrollMode(QAbstractItemView::ScrollPerPixel);
+
+	m_pTimer = new QTimer(this);
+	connect(m_pTimer, SIGNAL(timeout()), this, SLOT(collectThumbnails()));
+	connect(this, SIGNAL(itemClicked(QListWidgetItem*)), this, SLOT(selectItem(QListWidgetItem*)));
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void Filmstrip::openFile(const QString& file)
+{
+	clear();
+	m_generator.openFile(file.toStdString(), m_options);
+	m_pTimer->start(40);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void Filmstrip::setKeyFrameIndex(std::shared_ptr<const KeyFrameIndex> pIndex)
+{
+	m_generator.setKeyFrameIndex(pIndex);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void Filmstrip::collectThumbnails()
+{
+	MPX_TRACE_SCOPE("Filmstrip::collectThumbnails");
+	try
+	{
+		// a limited batch per tick, so a fast worker doesn't stall the event loop
+		Thumbnail thumbnail;
+		for(int count = 0; count < 64 && m_generator.nextThumbnail(thumbnail); count++)
+		{
+			const FrameBuf<RGB8>& rImage = thumbnail.image;
+			QImage image(&rImage.data()->r, rImage.width(), rImage.height(), int(rImage.stride()),
+						 QImage::Format_RGB888);
+			QListWidgetItem* pItem = new QListWidgetItem(QIcon(QPixmap::fromImage(image)),
+														 QString::number(thumbnail.frameIdx), this);
+			pItem->setData(Qt::UserRole, qulonglong(thumbnail.frameIdx));
+		}
+	}
+	catch(const std::exception& e)
+	{
+		m_pTimer->stop();
+		QMessageBox::information(this, tr("MUH PIXELS"), tr("Cannot make thumbnails: %1").arg(e.what()));
+		return;
+	}
+
+	if(m_generator.done())
+		m_pTimer->stop();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void Filmstrip::selectItem(QListWidgetItem* pItem)
+{
+	emit frameSelected(pItem->data(Qt::UserRole).toULongLong());
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
\ No newline at end of file
@@ -0,0 +1,51 @@
+//-----------------------------------------------------------------------------------------------// 
+// Filmstrip.qt.h
+//-----------------------------------------------------------------------------------------------// 
+#ifndef MPX_GUI_FILMSTRIP_H
+#define MPX_GUI_FILMSTRIP_H
+
+#include <QListWidget>
+#include <Thumbnails.h>
+
+QT_BEGIN_NAMESPACE
+class QTimer;
+QT_END_NAMESPACE
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// Thumbnails of the whole clip in a row, filled in while they are made in the background.
+//-----------------------------------------------------------------------------------------------// 
+class Filmstrip : public QListWidget
+{
+    Q_OBJECT
+
+public:
+	Filmstrip(QWidget* pParent = nullptr);
+
+	// starts the thumbnails of the file, the job of the previous one is cancelled
+	void openFile(const QString& file);
+
+	// the keyframes of the open file, the thumbnails only start with them
+	void setKeyFrameIndex(std::shared_ptr<const KeyFrameIndex> pIndex);
+
+signals:
+	void frameSelected(quint64 frameIdx);
+
+private slots:
+	void collectThumbnails();
+	void selectItem(QListWidgetItem* pItem);
+
+private:
+	ThumbnailGenerator m_generator;
+	ThumbnailOptions m_options;
+	QTimer* m_pTimer;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
+
+//-----------------------------------------------------------------------------------------------// 
+
+#endif
@@ -3,10 +3,7 @@
 //-----------------------------------------------------------------------------------------------// 
 #include <QtWidgets>
 #include <FrameView.qt.h>
-#include <BitStream.h>
-#include <FrameBuf.h>
-#include <Color.h>
-#include <Decode.h>
+#include <Trace.h>
 
 namespace mpx {
 
@@ -14,22 +11,109 @@ namespace mpx {
 
 FrameView::FrameView(QWidget* pParent)
 	: QGraphicsView(pParent)
+	, m_tilePixmaps(256 * 1024)
+	, m_simdLevel(detectSimdLevel())
+	, m_fitToWindow(false)
 {
-	m_pGraphicsScene = new QGraphicsScene();
+	m_pGraphicsScene = new QGraphicsScene(this);
 	setScene(m_pGraphicsScene);
+	setDragMode(QGraphicsView::ScrollHandDrag);
+	setTransformationAnchor(QGraphicsView::AnchorViewCenter);
+	show();
+}
 
-#if 1
-  	BitStream bsInfo;
-	FrameBuf<RGB8> firstFrame;
-	//modelBitStream("S:\\my\\data\\knk.webm", bsInfo, firstFrame);
-	modelBitStream("S:\\my\\data\\rgs-op.webm", bsInfo, firstFrame);
-	QImage image(&firstFrame.data()->r, firstFrame.width(), firstFrame.height(), QImage::Format_RGB888);
-	QPixmap pixmap = QPixmap::fromImage(image);
-	QGraphicsPixmapItem* pPixmapItem = new QGraphicsPixmapItem(pixmap);
-	m_pGraphicsScene->addItem(pPixmapItem);
-#endif
+//-----------------------------------------------------------------------------------------------// 
 
-	show();
+void FrameView::setFrame(std::shared_ptr<const I420Frame> pFrame)
+{
+	m_tiles.setFrame(pFrame);
+	m_tilePixmaps.clear();
+	setSceneRect(0, 0, m_tiles.width(), m_tiles.height());
+	if(m_fitToWindow && hasFrame())
+		fitInView(sceneRect(), Qt::KeepAspectRatio);
+	viewport()->update();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool FrameView::hasFrame() const
+{
+	return m_tiles.width() > 0;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+double FrameView::zoom() const
+{
+	return transform().m11();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void FrameView::setZoom(double zoom)
+{
+	setTransform(QTransform::fromScale(zoom, zoom));
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void FrameView::setFitToWindow(bool fit)
+{
+	m_fitToWindow = fit;
+	if(m_fitToWindow && hasFrame())
+		fitInView(sceneRect(), Qt::KeepAspectRatio);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void FrameView::resizeEvent(QResizeEvent* pEvent)
+{
+	QGraphicsView::resizeEvent(pEvent);
+	if(m_fitToWindow && hasFrame())
+		fitInView(sceneRect(), Qt::KeepAspectRatio);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void FrameView::drawBackground(QPainter* pPainter, const QRectF& rect)
+{
+	MPX_TRACE_SCOPE("FrameView::drawBackground");
+	QGraphicsView::drawBackground(pPainter, rect);
+	QRectF visible = rect.intersected(sceneRect());
+	if(!hasFrame() || visible.isEmpty())
+		return;
+
+	// smooth when shrinking, magnified pixels stay sharp for inspection
+	double scale = zoom();
+	pPainter->setRenderHint(QPainter::SmoothPixmapTransform, scale < 1);
+
+	// rect is only the exposed part, e.g. the strip uncovered by a scroll
+	int level = m_tiles.pyramid().levelForScale(scale);
+	m_tiles.visibleTiles(level, visible.left(), visible.top(), visible.right(), visible.bottom(), m_visibleTiles);
+	for(const TileKey& key : m_visibleTiles)
+	{
+		double x, y, width, height;
+		m_tiles.tileRect(key, x, y, width, height);
+		const QPixmap& pixmap = tilePixmap(key);
+		pPainter->drawPixmap(QRectF(x, y, width, height), pixmap, QRectF(pixmap.rect()));
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+const QPixmap& FrameView::tilePixmap(const TileKey& key)
+{
+	quint64 cacheKey = (quint64(key.level) << 48) | (quint64(key.row) << 24) | quint64(key.col);
+	if(QPixmap* pPixmap = m_tilePixmaps.object(cacheKey))
+		return *pPixmap;
+
+	MPX_TRACE_SCOPE("FrameView render tile");
+	m_tiles.renderTile(key, m_tileRgb, m_simdLevel);
+	QImage image(&m_tileRgb.data()->r, m_tileRgb.width(), m_tileRgb.height(), int(m_tileRgb.stride()),
+				 QImage::Format_RGB888);
+	QPixmap* pPixmap = new QPixmap(QPixmap::fromImage(image));
+	m_tilePixmaps.insert(cacheKey, pPixmap, m_tileRgb.width() * m_tileRgb.height() * 4 / 1024);
+	return *pPixmap;
 }
 
 //-----------------------------------------------------------------------------------------------// 
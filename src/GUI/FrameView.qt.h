@@ -4,7 +4,12 @@
 #ifndef MPX_GUI_FRAME_VIEW_H
 #define MPX_GUI_FRAME_VIEW_H
 
+#include <FrameTiles.h>
+#include <QCache>
 #include <QGraphicsView>
+#include <QPixmap>
+#include <memory>
+#include <vector>
 
 QT_BEGIN_NAMESPACE
 class QGraphicsScene;
@@ -13,7 +18,8 @@ QT_END_NAMESPACE
 namespace mpx {
 
 //-----------------------------------------------------------------------------------------------// 
-// Analysing view of a single frame
+// Analysing view of a single frame. The frame is drawn in tiles from its mip pyramid, only the
+// tiles in the viewport are converted, at the level that matches the zoom.
 //-----------------------------------------------------------------------------------------------// 
 class FrameView : public QGraphicsView
 {
@@ -22,8 +28,30 @@ class FrameView : public QGraphicsView
 public:
 	FrameView(QWidget* pParent = nullptr);
 
+	void setFrame(std::shared_ptr<const I420Frame> pFrame);
+	bool hasFrame() const;
+
+	// display pixels per frame pixel
+	double zoom() const;
+	void setZoom(double zoom);
+
+	// keeps the whole frame in the window, also when it is resized
+	void setFitToWindow(bool fit);
+
+protected:
+	void drawBackground(QPainter* pPainter, const QRectF& rect) override;
+	void resizeEvent(QResizeEvent* pEvent) override;
+
 private:
+	const QPixmap& tilePixmap(const TileKey& key);
+
 	QGraphicsScene* m_pGraphicsScene;
+	FrameTiles m_tiles;
+	QCache<quint64, QPixmap> m_tilePixmaps; // of the current frame, the cost is in KB
+	std::vector<TileKey> m_visibleTiles;
+	FrameBuf<RGB8> m_tileRgb;
+	SimdLevel m_simdLevel;
+	bool m_fitToWindow;
 };
 
 //-----------------------------------------------------------------------------------------------// 
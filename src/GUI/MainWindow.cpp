@@ -1,19 +1,23 @@
 //-----------------------------------------------------------------------------------------------// 
 // MainWindow.cpp
 //-----------------------------------------------------------------------------------------------// 
-#include <BitStream.h>
 #include <Color.h>
 #include <Decode.h>
+#include <Filmstrip.qt.h>
 #include <FrameView.qt.h>
 #include <MainWindow.qt.h>
 #include <QtWidgets>
 #include <RawFileMap.qt.h>
+#include <Trace.h>
+#include <YUVFrame.h>
 
 namespace mpx {
 
 //-----------------------------------------------------------------------------------------------// 
 
 MainWindow::MainWindow()
+	: m_pendingFrameIdx(-1)
+	, m_scaleFactor(1.0)
 {
 	// Setup the central widget.
 	m_pFrameView = new FrameView(this);
@@ -21,13 +25,31 @@ MainWindow::MainWindow()
 
 	createActions();
 	createMenus();
-	    
+
+	// Add the thumbnails of the clip above the frame.
+	QDockWidget* pFilmstripDock = new QDockWidget(tr("Filmstrip"), this);
+	pFilmstripDock->setAllowedAreas(Qt::TopDockWidgetArea | Qt::BottomDockWidgetArea);
+	addDockWidget(Qt::TopDockWidgetArea, pFilmstripDock);
+	m_pFilmstrip = new Filmstrip(this);
+	pFilmstripDock->setWidget(m_pFilmstrip);
+	connect(m_pFilmstrip, SIGNAL(frameSelected(quint64)), this, SLOT(showFrame(quint64)));
+
 	// Add raw file map as a docked widget.	
 	QDockWidget* pDock = new QDockWidget(tr("Raw File Map"), this);
 	pDock->setAllowedAreas(Qt::TopDockWidgetArea | Qt::BottomDockWidgetArea);
 	addDockWidget(Qt::BottomDockWidgetArea, pDock);
 	m_pRawFileMap = new RawFileMap(this);	
 	pDock->setWidget(m_pRawFileMap);
+	connect(m_pRawFileMap, SIGNAL(frameSelected(quint64)), this, SLOT(showFrame(quint64)));
+
+	// Progress of the analysis of the open file.
+	m_pAnalysisProgress = new QProgressBar(this);
+	m_pAnalysisProgress->setRange(0, 1000);
+	m_pAnalysisProgress->setMaximumWidth(200);
+	m_pAnalysisProgress->hide();
+	statusBar()->addPermanentWidget(m_pAnalysisProgress);
+	m_pAnalysisTimer = new QTimer(this);
+	connect(m_pAnalysisTimer, SIGNAL(timeout()), this, SLOT(pollAnalysis()));
 
 	setWindowTitle(tr("MUH PIXELS"));
 	resize(1280, 720);
@@ -40,21 +62,32 @@ void MainWindow::open()
     QString fileName = QFileDialog::getOpenFileName(this,
                                     tr("Open File"), QDir::currentPath());
     if (!fileName.isEmpty()) {
-        QImage image(fileName);
-        if (image.isNull()) {
+        try {
+            // the decoders get the keyframes of the analysis job, a scan of their own would
+            // block the GUI thread
+            FrameCacheOptions cacheOptions;
+            cacheOptions.scanForIndex = false;
+            m_frameCache.openFile(fileName.toStdString(), cacheOptions);
+        }
+        catch (const std::exception& e) {
             QMessageBox::information(this, tr("MUH PIXELS"),
-                                     tr("Cannot load %1.").arg(fileName));
+                                     tr("Cannot load %1: %2").arg(fileName, e.what()));
             return;
         }
 
-        //m_pImageLabel->setPixmap(QPixmap::fromImage(image));
-        m_scaleFactor = 1.0;
-
-        m_pFitToWindowAct->setEnabled(true);
-        updateActions();
-
-        //if (!m_pFitToWindowAct->isChecked())
-        //    m_pImageLabel->adjustSize();
+        // Nothing here waits for the file, the first frame and the packets come from the
+        // analysis job as it finds them (see pollAnalysis).
+        m_pendingFrameIdx = -1;
+        m_pFrameView->setFrame(nullptr);
+        m_pRawFileMap->beginFile(QFileInfo(fileName).size());
+        m_pFilmstrip->openFile(fileName);
+        m_analysisJob.openFile(fileName.toStdString());
+
+        m_pAnalysisProgress->setValue(0);
+        m_pAnalysisProgress->show();
+        m_pCancelAnalysisAct->setEnabled(true);
+        statusBar()->showMessage(tr("Analyzing %1").arg(QFileInfo(fileName).fileName()));
+        m_pAnalysisTimer->start(30);
     }
 }
 
@@ -76,20 +109,107 @@ void MainWindow::zoomOut()
 
 void MainWindow::normalSize()
 {
-    //m_pImageLabel->adjustSize();
     m_scaleFactor = 1.0;
+    m_pFrameView->setZoom(m_scaleFactor);
+    updateActions();
 }
 
 //-----------------------------------------------------------------------------------------------// 
 
 void MainWindow::fitToWindow()
 {
-    //bool fitToWindow = m_pFitToWindowAct->isChecked();
-    //m_pScrollArea->setWidgetResizable(fitToWindow);
-    //if (!fitToWindow) {
-    //    normalSize();
-    //}
-    //updateActions();
+    bool fitToWindow = m_pFitToWindowAct->isChecked();
+    m_pFrameView->setFitToWindow(fitToWindow);
+    if (fitToWindow)
+        m_scaleFactor = m_pFrameView->zoom();
+    else
+        normalSize();
+    updateActions();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void MainWindow::recordTrace(bool record)
+{
+    if (record)
+        clearTrace();
+    enableTrace(record);
+    m_pSaveTraceAct->setEnabled(!record);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void MainWindow::saveTrace()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Save Trace"), QDir::currentPath(),
+                                                    tr("Chrome Trace (*.json)"));
+    if (!fileName.isEmpty() && !saveChromeTrace(fileName.toStdString()))
+        QMessageBox::information(this, tr("MUH PIXELS"), tr("Cannot write %1").arg(fileName));
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void MainWindow::cancelAnalysis()
+{
+    // the job hands out what it has found so far, pollAnalysis shows it and stops
+    m_analysisJob.cancel();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void MainWindow::pollAnalysis()
+{
+    MPX_TRACE_SCOPE("MainWindow::pollAnalysis");
+    AnalysisUpdate update;
+    try {
+        if (!m_analysisJob.takeUpdate(update)) {
+            if (m_analysisJob.done())
+                endAnalysis();
+            return;
+        }
+    }
+    catch (const std::exception& e) {
+        endAnalysis();
+        statusBar()->clearMessage();
+        QMessageBox::information(this, tr("MUH PIXELS"), tr("Cannot analyze the file: %1").arg(e.what()));
+        return;
+    }
+
+    if (update.pFirstFrame) {
+        m_pFrameView->setFrame(update.pFirstFrame);
+        if (!m_pFitToWindowAct->isChecked())
+            normalSize();
+
+        m_pFitToWindowAct->setEnabled(true);
+        updateActions();
+    }
+
+    if (update.pKeyFrameIndex) {
+        m_frameCache.setKeyFrameIndex(update.pKeyFrameIndex);
+        m_pFilmstrip->setKeyFrameIndex(update.pKeyFrameIndex);
+        if (m_pendingFrameIdx >= 0)
+            showFrame(quint64(m_pendingFrameIdx));
+    }
+
+    const AnalysisProgress& progress = update.progress;
+    m_pRawFileMap->addPackets(update.packets, update.chunks, progress.scannedBytes);
+    if (progress.fileSize > 0)
+        m_pAnalysisProgress->setValue(int(1000 * progress.scannedBytes / progress.fileSize));
+
+    QString state = progress.finished ? (progress.fromSidecar ? tr("loaded") : tr("done"))
+                  : progress.cancelled ? tr("cancelled")
+                  : tr("%1 MB").arg(progress.scannedBytes >> 20);
+    QString firstFrame = progress.firstFrameMs >= 0 ? tr("%1 ms").arg(progress.firstFrameMs, 0, 'f', 1) : tr("none");
+    statusBar()->showMessage(tr("First frame %1, %2 frames (%3 key, %4 hidden) in %5 packets, %6")
+        .arg(firstFrame)
+        .arg(qulonglong(progress.shownCount))
+        .arg(qulonglong(progress.keyFrameCount))
+        .arg(qulonglong(progress.frameCount - progress.shownCount))
+        .arg(qulonglong(progress.packetCount))
+        .arg(state));
+
+    if (m_analysisJob.done())
+        endAnalysis();
 }
 
 //-----------------------------------------------------------------------------------------------// 
@@ -104,6 +224,29 @@ void MainWindow::about()
 
 //-----------------------------------------------------------------------------------------------// 
 
+void MainWindow::showFrame(quint64 frameIdx)
+{
+    MPX_TRACE_SCOPE("MainWindow::showFrame");
+    std::shared_ptr<const I420Frame> pFrame;
+    try {
+        pFrame = m_frameCache.frame(frameIdx);
+    }
+    catch (const std::exception& e) {
+        QMessageBox::information(this, tr("MUH PIXELS"),
+                                 tr("Cannot show frame %1: %2").arg(frameIdx).arg(e.what()));
+        return;
+    }
+
+    // a frame that can't be decoded yet is shown when the analysis hands out the keyframes
+    m_pendingFrameIdx = !pFrame && !m_frameCache.canDecode() ? qint64(frameIdx) : -1;
+
+    // the view keeps its zoom, the frames of a clip have the same size
+    if (pFrame)
+        m_pFrameView->setFrame(pFrame);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
 void MainWindow::createActions()
 {
     m_pOpenAct = new QAction(tr("&Open..."), this);
@@ -135,6 +278,19 @@ void MainWindow::createActions()
     m_pFitToWindowAct->setShortcut(tr("Ctrl+F"));
     connect(m_pFitToWindowAct, SIGNAL(triggered()), this, SLOT(fitToWindow()));
 
+    m_pRecordTraceAct = new QAction(tr("&Record Trace"), this);
+    m_pRecordTraceAct->setCheckable(true);
+    connect(m_pRecordTraceAct, SIGNAL(toggled(bool)), this, SLOT(recordTrace(bool)));
+
+    m_pSaveTraceAct = new QAction(tr("&Save Trace..."), this);
+    m_pSaveTraceAct->setEnabled(false);
+    connect(m_pSaveTraceAct, SIGNAL(triggered()), this, SLOT(saveTrace()));
+
+    m_pCancelAnalysisAct = new QAction(tr("&Cancel Analysis"), this);
+    m_pCancelAnalysisAct->setShortcut(tr("Esc"));
+    m_pCancelAnalysisAct->setEnabled(false);
+    connect(m_pCancelAnalysisAct, SIGNAL(triggered()), this, SLOT(cancelAnalysis()));
+
     m_pAboutAct = new QAction(tr("&About"), this);
     connect(m_pAboutAct, SIGNAL(triggered()), this, SLOT(about()));
 }
@@ -155,11 +311,18 @@ void MainWindow::createMenus()
     m_pViewMenu->addSeparator();
     m_pViewMenu->addAction(m_pFitToWindowAct);
 
+    m_pToolsMenu = new QMenu(tr("&Tools"), this);
+    m_pToolsMenu->addAction(m_pRecordTraceAct);
+    m_pToolsMenu->addAction(m_pSaveTraceAct);
+    m_pToolsMenu->addSeparator();
+    m_pToolsMenu->addAction(m_pCancelAnalysisAct);
+
     m_pHelpMenu = new QMenu(tr("&Help"), this);
     m_pHelpMenu->addAction(m_pAboutAct);
 
     menuBar()->addMenu(m_pFileMenu);
     menuBar()->addMenu(m_pViewMenu);
+    menuBar()->addMenu(m_pToolsMenu);
     menuBar()->addMenu(m_pHelpMenu);
 }
 
@@ -176,15 +339,12 @@ void MainWindow::updateActions()
 
 void MainWindow::scaleImage(double factor)
 {
-    //Q_ASSERT(m_pImageLabel->pixmap());
+    // the view keeps its center, the tiles follow the zoom level
     m_scaleFactor *= factor;
- 	//m_pImageLabel->resize(m_scaleFactor * m_pImageLabel->pixmap()->size());
-
-    //adjustScrollBar(m_pScrollArea->horizontalScrollBar(), factor);
-    //adjustScrollBar(m_pScrollArea->verticalScrollBar(), factor);
+    m_pFrameView->setZoom(m_scaleFactor);
 
-    m_pZoomInAct->setEnabled(m_scaleFactor < 3.0);
-    m_pZoomOutAct->setEnabled(m_scaleFactor > 0.333);
+    m_pZoomInAct->setEnabled(m_scaleFactor < 32.0);
+    m_pZoomOutAct->setEnabled(m_scaleFactor > 1.0 / 32);
 }
 
 //-----------------------------------------------------------------------------------------------// 
@@ -197,4 +357,13 @@ void MainWindow::adjustScrollBar(QScrollBar* scrollBar, double factor)
 
 //-----------------------------------------------------------------------------------------------// 
 
-} // mpx
\ No newline at end of file
+void MainWindow::endAnalysis()
+{
+    m_pAnalysisTimer->stop();
+    m_pAnalysisProgress->hide();
+    m_pCancelAnalysisAct->setEnabled(false);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
@@ -4,18 +4,23 @@
 #ifndef MPX_GUI_MAIN_WINDOW_QT_H
 #define MPX_GUI_MAIN_WINDOW_QT_H
 
+#include <AnalysisJob.h>
+#include <FrameCache.h>
 #include <QMainWindow>
 
 QT_BEGIN_NAMESPACE
 class QAction;
 class QLabel;
 class QMenu;
+class QProgressBar;
 class QScrollArea;
 class QScrollBar;
+class QTimer;
 QT_END_NAMESPACE
 
 namespace mpx {
 
+class Filmstrip;
 class FrameView;
 class RawFileMap;
 
@@ -35,7 +40,12 @@ private slots:
     void zoomOut();
     void normalSize();
     void fitToWindow();
+    void recordTrace(bool record);
+    void saveTrace();
+    void cancelAnalysis();
+    void pollAnalysis();
     void about();
+    void showFrame(quint64 frameIdx);
 
 private:
     void createActions();
@@ -43,9 +53,16 @@ private:
     void updateActions();
     void scaleImage(double factor);
     void adjustScrollBar(QScrollBar* scrollBar, double factor);
+    void endAnalysis();
 
 	FrameView* m_pFrameView;
+	Filmstrip* m_pFilmstrip;
 	RawFileMap* m_pRawFileMap;
+	FrameCache m_frameCache; // frames of the open file for the view
+	AnalysisJob m_analysisJob; // first frame and packet layout of the open file
+	QTimer* m_pAnalysisTimer; // polls the job while it runs
+	QProgressBar* m_pAnalysisProgress;
+	qint64 m_pendingFrameIdx; // picked before the frames could be decoded, -1 for none
 	
 	double m_scaleFactor;
 
@@ -55,10 +72,14 @@ private:
     QAction* m_pZoomOutAct;
     QAction* m_pNormalSizeAct;
     QAction* m_pFitToWindowAct;
+    QAction* m_pRecordTraceAct;
+    QAction* m_pSaveTraceAct;
+    QAction* m_pCancelAnalysisAct;
     QAction* m_pAboutAct;
 
     QMenu* m_pFileMenu;
     QMenu* m_pViewMenu;
+    QMenu* m_pToolsMenu;
     QMenu* m_pHelpMenu;
 };
 
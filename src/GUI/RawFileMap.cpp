@@ -3,6 +3,10 @@
 //-----------------------------------------------------------------------------------------------// 
 #include <QtWidgets>
 #include <RawFileMap.qt.h>
+#include <Trace.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 
 namespace mpx {
 
@@ -10,49 +14,294 @@ namespace mpx {
 
 RawFileMap::RawFileMap(QWidget* pParent)
 	: QWidget(pParent)
+	, m_scannedBytes(0)
+	, m_viewBegin(0)
+	, m_viewEnd(0)
+	, m_dragging(false)
+	, m_dragX(0)
+	, m_dragViewBegin(0)
+	, m_selecting(false)
+	, m_selectionBegin(0)
+	, m_selectionEnd(0)
 {
 	setMinimumHeight(100);
-	
+	setMouseTracking(true);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void RawFileMap::beginFile(uint64_t fileSize)
+{
+	m_bitStream.clear();
+	m_byteMap.reset(fileSize);
+	m_packetIndex.clear();
+	m_scannedBytes = 0;
+	m_selectionBegin = m_selectionEnd = 0;
+	m_viewBegin = 0;
+	m_viewEnd = m_byteMap.fileSize();
+	update();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void RawFileMap::addPackets(const std::vector<BitStream::Packet>& packets, const std::vector<BitStream::Chunk>& chunks,
+							uint64_t scannedBytes)
+{
+	size_t firstPacket = m_bitStream.packets.size();
+	m_bitStream.packets.insert(m_bitStream.packets.end(), packets.begin(), packets.end());
+	m_bitStream.chunks.insert(m_bitStream.chunks.end(), chunks.begin(), chunks.end());
+	m_byteMap.addPackets(m_bitStream, firstPacket);
+	m_packetIndex.append(m_bitStream, firstPacket);
+	m_scannedBytes = std::min(scannedBytes, m_byteMap.fileSize());
+	update();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void RawFileMap::clear()
+{
+	m_bitStream.clear();
+	m_byteMap.clear();
+	m_packetIndex.clear();
+	m_scannedBytes = 0;
+	m_selectionBegin = m_selectionEnd = 0;
+	m_viewBegin = 0;
+	m_viewEnd = 0;
+	update();
 }
 
 //-----------------------------------------------------------------------------------------------// 
 
 void RawFileMap::paintEvent(QPaintEvent*)
 {
+	MPX_TRACE_SCOPE("RawFileMap::paintEvent");
 	QPainter painter(this);
+	painter.fillRect(rect(), QColor(32, 32, 32));
+	if(m_viewEnd <= m_viewBegin || width() <= 0)
+		return;
+
+	int columnCount = width();
+	m_byteMap.aggregate(m_viewBegin, m_viewEnd, columnCount, m_columns);
+
+	const int Margin = 3;
+	const int StripHeight = 6;
+	int stripTop = height() - Margin - StripHeight;
+	int barBottom = stripTop - 2;
+	int barHeight = barBottom - Margin;
+
+	// Square root scale, keyframes are many times larger than the frames between them. The
+	// strip below gets brighter the more of the column's bytes are frame data.
+	double maxPacketSize = std::max<double>(m_byteMap.maxPacketSize(), 1);
+	QVector<QLine> keyLines;
+	QVector<QLine> hiddenLines;
+	QVector<QLine> interLines;
+	QImage strip(columnCount, 1, QImage::Format_RGB32);
+	for(int x = 0; x < columnCount; x++)
+	{
+		const ByteBucket& column = m_columns[x];
+		int density = column.bytes ? int(255 * column.frameBytes / column.bytes) : 0;
+		strip.setPixel(x, 0, qRgb(density, density, density));
+		if(column.maxPacketSize == 0)
+			continue;
 
-	QPen pen(Qt::black);
-	pen.setWidth(2);
+		int lineHeight = std::max(1, int(barHeight * std::sqrt(column.maxPacketSize / maxPacketSize) + 0.5));
+		QLine line(x, barBottom, x, barBottom - lineHeight + 1);
+		if(column.keyFrameBytes)
+			keyLines.append(line);
+		else if(column.hiddenFrameBytes * 2 > column.frameBytes)
+			hiddenLines.append(line);
+		else
+			interLines.append(line);
+	}
 
-	QBrush brush(Qt::blue);
-    painter.setPen(pen);
-    painter.setBrush(brush);
+	painter.drawImage(QRect(0, stripTop, columnCount, StripHeight), strip);
+	painter.setPen(QColor(70, 130, 220));
+	painter.drawLines(interLines);
+	painter.setPen(QColor(90, 190, 90));
+	painter.drawLines(hiddenLines);
+	painter.setPen(QColor(230, 70, 50));
+	painter.drawLines(keyLines);
 
-	int margin = 3;
-	int barHeight = height() - 2 * margin;
-	int barWidth = 5;
-	QRect rect(margin, margin, barWidth, barHeight);
-	for(int i = 0; i < 20; i++)
+	double pixelsPerByte = double(columnCount) / double(m_viewEnd - m_viewBegin);
+	if(m_scannedBytes < m_viewEnd)
 	{
-		painter.drawRect(rect);
-		rect.setLeft(rect.left() + margin + barWidth);
-		rect.setRight(rect.right() + margin + barWidth);
+		double left = (double(std::max(m_scannedBytes, m_viewBegin)) - double(m_viewBegin)) * pixelsPerByte;
+		painter.fillRect(QRectF(left, 0, columnCount - left, height()), QBrush(QColor(64, 64, 64), Qt::BDiagPattern));
+	}
+
+	uint64_t selectionBegin = std::min(m_selectionBegin, m_selectionEnd);
+	uint64_t selectionEnd = std::max(m_selectionBegin, m_selectionEnd);
+	if(selectionEnd > m_viewBegin && selectionBegin < m_viewEnd)
+	{
+		double left = (double(std::max(selectionBegin, m_viewBegin)) - double(m_viewBegin)) * pixelsPerByte;
+		double right = (double(std::min(selectionEnd, m_viewEnd)) - double(m_viewBegin)) * pixelsPerByte;
+		painter.fillRect(QRectF(left, 0, std::max(right - left, 1.0), height()), QColor(255, 255, 255, 48));
 	}
 }
 
 //-----------------------------------------------------------------------------------------------// 
 
+void RawFileMap::mousePressEvent(QMouseEvent* pEvent)
+{
+	if(pEvent->button() != Qt::LeftButton)
+		return;
+
+	m_dragX = pEvent->x();
+	if(pEvent->modifiers() & Qt::ShiftModifier)
+	{
+		m_selecting = true;
+		m_selectionBegin = m_selectionEnd = offsetAt(m_dragX);
+		update();
+		return;
+	}
+
+	m_dragging = true;
+	m_dragViewBegin = m_viewBegin;
+	setCursor(Qt::ClosedHandCursor);
+}
+
+//-----------------------------------------------------------------------------------------------// 
 
 void RawFileMap::mouseMoveEvent(QMouseEvent* pEvent)
 {
-	pEvent;
+	if(m_viewEnd <= m_viewBegin || width() <= 0)
+		return;
+
+	if(m_dragging)
+	{
+		double viewSize = double(m_viewEnd - m_viewBegin);
+		double shift = (pEvent->x() - m_dragX) * viewSize / width();
+		setView(double(m_dragViewBegin) - shift, viewSize);
+		return;
+	}
+
+	if(m_selecting)
+	{
+		m_selectionEnd = offsetAt(pEvent->x());
+		update();
+		return;
+	}
+
+	// the bytes under the pixel
+	int x = pEvent->x();
+	uint64_t begin = offsetAt(x);
+	uint64_t end = std::max(offsetAt(x + 1), begin + 1);
+	QToolTip::showText(pEvent->globalPos(), tr("Offset %1\n").arg(qulonglong(begin)) + describeRange(begin, end), this);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void RawFileMap::mouseReleaseEvent(QMouseEvent* pEvent)
+{
+	if(pEvent->button() != Qt::LeftButton || m_viewEnd <= m_viewBegin)
+		return;
+
+	if(m_selecting)
+	{
+		m_selecting = false;
+		m_selectionEnd = offsetAt(pEvent->x());
+		uint64_t begin = std::min(m_selectionBegin, m_selectionEnd);
+		uint64_t end = std::max(m_selectionBegin, m_selectionEnd);
+		if(end > begin)
+			QToolTip::showText(pEvent->globalPos(), tr("Selected %1 bytes\n").arg(qulonglong(end - begin)) + describeRange(begin, end), this);
+		update();
+		return;
+	}
+
+	m_dragging = false;
+	unsetCursor();
+
+	// a click without a drag shows the frame of the chunk there, or of the next one
+	if(std::abs(pEvent->x() - m_dragX) <= 2)
+	{
+		// hidden chunks at the end of a scan have no shown frame after them yet, they go to the
+		// last one
+		Range<size_t> chunks = m_packetIndex.chunksIn(offsetAt(pEvent->x()), m_byteMap.fileSize());
+		if(chunks.begin < chunks.end && m_packetIndex.shownCount() > 0)
+			emit frameSelected(std::min(m_packetIndex.chunk(chunks.begin).frameIdx, m_packetIndex.shownCount() - 1));
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void RawFileMap::wheelEvent(QWheelEvent* pEvent)
+{
+	if(m_viewEnd <= m_viewBegin || width() <= 0)
+		return;
+
+	// the offset under the cursor stays in place
+	int x = pEvent->pos().x();
+	double anchor = double(offsetAt(x));
+	double viewSize = double(m_viewEnd - m_viewBegin) * std::pow(0.8, pEvent->angleDelta().y() / 120.0);
+	setView(anchor - viewSize * x / width(), viewSize);
+	pEvent->accept();
 }
 
 //-----------------------------------------------------------------------------------------------// 
 
 void RawFileMap::resizeEvent(QResizeEvent* pEvent)
 {
-	pEvent;
+	QWidget::resizeEvent(pEvent);
+	if(m_viewEnd > m_viewBegin)
+		setView(double(m_viewBegin), double(m_viewEnd - m_viewBegin));
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+uint64_t RawFileMap::offsetAt(int x) const
+{
+	double viewSize = double(m_viewEnd - m_viewBegin);
+	return m_viewBegin + uint64_t(std::max(0.0, viewSize * x / std::max(width(), 1)));
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+QString RawFileMap::describeRange(uint64_t begin, uint64_t end) const
+{
+	Range<size_t> chunks = m_packetIndex.chunksIn(begin, end);
+	if(chunks.begin == chunks.end)
+		return tr("container data");
+
+	if(chunks.end - chunks.begin == 1)
+	{
+		const PacketIndex::ChunkEntry& chunk = m_packetIndex.chunk(chunks.begin);
+		const char* pType = chunk.keyFrame ? "key frame" : chunk.shown ? "inter frame" : "hidden frame";
+		return tr("Packet %1, chunk %2, %3 bytes\nFrame %4, %5")
+			.arg(chunk.packetPos)
+			.arg(chunk.chunkIdx)
+			.arg(qulonglong(chunk.range.end - chunk.range.begin))
+			.arg(qulonglong(chunk.frameIdx))
+			.arg(tr(pType));
+	}
+
+	// many chunks, the counts come from the positions and the byte shares from the byte map,
+	// so a selection of the whole file costs no more than one of two packets
+	Range<size_t> packets = m_packetIndex.packetsIn(begin, end);
+	std::vector<ByteBucket> total;
+	m_byteMap.aggregate(begin, end, 1, total);
+	const ByteBucket& bucket = total[0];
+	return tr("Packets %1 to %2, frames %3 to %4\n%5 chunks, %6% frame data, %7% keyframes")
+		.arg(m_packetIndex.packet(packets.begin).packetPos)
+		.arg(m_packetIndex.packet(packets.end - 1).packetPos)
+		.arg(qulonglong(m_packetIndex.chunk(chunks.begin).frameIdx))
+		.arg(qulonglong(m_packetIndex.chunk(chunks.end - 1).frameIdx))
+		.arg(qulonglong(chunks.end - chunks.begin))
+		.arg(qulonglong(bucket.bytes ? 100 * bucket.frameBytes / bucket.bytes : 0))
+		.arg(qulonglong(bucket.bytes ? 100 * bucket.keyFrameBytes / bucket.bytes : 0));
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void RawFileMap::setView(double begin, double size)
+{
+	double fileSize = double(m_byteMap.fileSize());
+	double minSize = std::min(fileSize, double(m_byteMap.baseBucketSize()) * std::max(width(), 1));
+	size = std::max(minSize, std::min(size, fileSize));
+	begin = std::max(0.0, std::min(begin, fileSize - size));
+
+	m_viewBegin = uint64_t(begin + 0.5);
+	m_viewEnd = std::min(m_viewBegin + uint64_t(size + 0.5), m_byteMap.fileSize());
+	update();
 }
 
 //-----------------------------------------------------------------------------------------------// 
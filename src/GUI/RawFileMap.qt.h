@@ -4,12 +4,21 @@
 #ifndef MPX_GUI_RAW_FILE_MAP_H
 #define MPX_GUI_RAW_FILE_MAP_H
 
+#include <ByteMap.h>
+#include <PacketIndex.h>
 #include <QWidget>
+#include <vector>
 
 namespace mpx {
 
 //-----------------------------------------------------------------------------------------------// 
-// Representation of the raw file data.
+// Representation of the raw file data. The x axis is the file offset, every pixel column shows
+// the largest packet in its bytes, coloured by the frame types there, over a strip that is the
+// brighter the more of the bytes are frame data. The wheel zooms around the cursor, dragging
+// pans, a click shows the frame under the cursor and shift+drag selects a range. Painting reads
+// the ByteMap level that matches the zoom and the tooltips ask the PacketIndex, so both take the
+// same time for any file length. A file that is still being scanned fills in from the left,
+// the bytes past the scan are shaded.
 //-----------------------------------------------------------------------------------------------// 
 class RawFileMap : public QWidget
 {
@@ -18,12 +27,51 @@ class RawFileMap : public QWidget
 public:
 	RawFileMap(QWidget* pParent = nullptr);
 
+	// an empty map of the whole file, the packets come with addPackets() as a scan finds them
+	void beginFile(uint64_t fileSize);
+
+	// The packets and their chunks follow the ones added before, the chunk blocks of the packets
+	// count from the first chunk of the file. The scan has read the file up to scannedBytes.
+	void addPackets(const std::vector<BitStream::Packet>& packets, const std::vector<BitStream::Chunk>& chunks,
+					uint64_t scannedBytes);
+
+	void clear();
+
     void paintEvent(QPaintEvent* pEvent) override;
+    void mousePressEvent(QMouseEvent* pEvent) override;
     void mouseMoveEvent(QMouseEvent* pEvent) override;
+    void mouseReleaseEvent(QMouseEvent* pEvent) override;
+    void wheelEvent(QWheelEvent* pEvent) override;
     void resizeEvent(QResizeEvent* pEvent) override;
 
+signals:
+    void frameSelected(quint64 frameIdx);
+
 private:
-	
+	// file offset at the x position in widget pixels
+	uint64_t offsetAt(int x) const;
+
+	// sets the visible range, clamped to the file and to one base bucket per pixel
+	void setView(double begin, double size);
+
+	// what lies in the byte range, for the tooltips
+	QString describeRange(uint64_t begin, uint64_t end) const;
+
+	BitStream m_bitStream; // only the packets and chunks
+	ByteMap m_byteMap;
+	PacketIndex m_packetIndex;
+	uint64_t m_scannedBytes;
+	uint64_t m_viewBegin;
+	uint64_t m_viewEnd;
+	std::vector<ByteBucket> m_columns; // of the last paint, reused
+
+	bool m_dragging;
+	int m_dragX;
+	uint64_t m_dragViewBegin;
+
+	bool m_selecting;
+	uint64_t m_selectionBegin; // where the selection started, can be after the end
+	uint64_t m_selectionEnd;
 };
 
 //-----------------------------------------------------------------------------------------------// 
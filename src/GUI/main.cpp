@@ -4,12 +4,14 @@
 
 #include <QApplication>
 #include <MainWindow.qt.h>
+#include <Trace.h>
 
 //-----------------------------------------------------------------------------------------------// 
 
 int main(int argc, char *argv[])
 {
     QApplication app(argc, argv);
+    mpx::setTraceThreadName("gui");
     mpx::MainWindow mpxWindow;
     mpxWindow.show();
     return app.exec();
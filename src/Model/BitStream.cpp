@@ -4,4 +4,18 @@
 
 #include <BitStream.h>
 
+namespace mpx {
+
 //-----------------------------------------------------------------------------------------------// 
+
+void BitStream::clear()
+{
+	// swapped out, clear() would keep the memory
+	std::vector<Packet>().swap(packets);
+	std::vector<Chunk>().swap(chunks);
+	std::vector<FrameHeader>().swap(frames);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
@@ -4,32 +4,47 @@
 #ifndef MPX_MODEL_BIT_STREAM_H
 #define MPX_MODEL_BIT_STREAM_H
 
+#include <FrameHeader.h>
 #include <Range.h>
 #include <vector>
 
 namespace mpx {
 
 //-----------------------------------------------------------------------------------------------// 
-// Bitstream infos.
+// Bitstream infos. The packets and the chunks of all packets are two flat tables, a packet refers
+// to its run of chunks by position. Building the model is a push_back of plain records, with no
+// allocation per packet, and clearing it frees a handful of blocks however long the file is.
 //-----------------------------------------------------------------------------------------------// 
 struct BitStream
 {
 	struct Chunk
 	{
-		uint chunkIdx;
-		uint packetIdx;		
+		uint chunkIdx; // in the packet
+		uint packetIdx;
 		RangeU64 range;
+		bool keyFrame;
+		bool shown; // decoding it outputs a frame
 	};
 
 	struct Packet
 	{
 		uint64_t packetIdx;
-		uint trackIdx;
-		std::vector<Chunk> chunks;
+		uint64_t timestamp; // in ns
 		RangeU64 range;
+		uint trackIdx;
+		BlockU chunks; // in BitStream::chunks
 	};
 
 	std::vector<Packet> packets;
+	std::vector<Chunk> chunks; // of all packets, packet by packet
+	std::vector<FrameHeader> frames; // all frames in decode order, hidden ones included
+
+	const Chunk& chunk(const Packet& packet, uint chunkIdx) const
+	{
+		return chunks[packet.chunks.begin + chunkIdx];
+	}
+
+	void clear();
 };
 
 //-----------------------------------------------------------------------------------------------// 
@@ -0,0 +1,234 @@
+//-----------------------------------------------------------------------------------------------// 
+// CompactBitStream.cpp
+//-----------------------------------------------------------------------------------------------// 
+
+#include <CompactBitStream.h>
+#include <algorithm>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// Varints: 7 bits per byte, low bits first, the top bit says another byte follows. Signed values
+// are zigzag mapped first, so small negative differences stay short too.
+//-----------------------------------------------------------------------------------------------// 
+
+static void putVarint(std::vector<uint8_t>& rData, uint64_t value)
+{
+	while(value >= 0x80)
+	{
+		rData.push_back(uint8_t(value | 0x80));
+		value >>= 7;
+	}
+	rData.push_back(uint8_t(value));
+}
+
+static void putSigned(std::vector<uint8_t>& rData, int64_t value)
+{
+	putVarint(rData, (uint64_t(value) << 1) ^ uint64_t(value >> 63));
+}
+
+static uint64_t getVarint(const uint8_t*& rpData)
+{
+	uint64_t value = 0;
+	for(int shift = 0; ; shift += 7)
+	{
+		uint8_t byte = *rpData++;
+		value |= uint64_t(byte & 0x7f) << shift;
+		if(byte < 0x80)
+			return value;
+	}
+}
+
+static int64_t getSigned(const uint8_t*& rpData)
+{
+	uint64_t value = getVarint(rpData);
+	return int64_t(value >> 1) ^ -int64_t(value & 1);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+const size_t CompactBitStream::BlockPackets;
+
+//-----------------------------------------------------------------------------------------------// 
+
+CompactBitStream::CompactBitStream()
+{
+	clear();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void CompactBitStream::clear()
+{
+	std::vector<uint8_t>().swap(m_data);
+	std::vector<Checkpoint>().swap(m_checkpoints);
+	m_predictor = Predictor();
+	m_packetCount = 0;
+	m_chunkCount = 0;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void CompactBitStream::encode(const BitStream& bitStream)
+{
+	clear();
+	append(bitStream, 0);
+	m_data.shrink_to_fit();
+	m_checkpoints.shrink_to_fit();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void CompactBitStream::append(const BitStream& bitStream, size_t firstPacket)
+{
+	for(size_t packetPos = firstPacket; packetPos < bitStream.packets.size(); packetPos++)
+	{
+		if(m_packetCount % BlockPackets == 0)
+		{
+			Checkpoint checkpoint = { m_predictor, m_data.size(), m_chunkCount };
+			m_checkpoints.push_back(checkpoint);
+		}
+
+		const BitStream::Packet& packet = bitStream.packets[packetPos];
+		int64_t timestampStep = int64_t(packet.timestamp - m_predictor.timestamp);
+		putSigned(m_data, int64_t(packet.packetIdx - m_predictor.packetIdx) - 1);
+		putSigned(m_data, timestampStep - m_predictor.timestampStep);
+		putSigned(m_data, int64_t(packet.range.begin - m_predictor.end));
+		putVarint(m_data, packet.range.end - packet.range.begin);
+		putVarint(m_data, packet.trackIdx);
+		putVarint(m_data, packet.chunks.size);
+
+		// the flags go into the low bits of the size
+		uint64_t chunkEnd = packet.range.begin;
+		for(uint chunkIdx = 0; chunkIdx < packet.chunks.size; chunkIdx++)
+		{
+			const BitStream::Chunk& chunk = bitStream.chunk(packet, chunkIdx);
+			putSigned(m_data, int64_t(chunk.range.begin - chunkEnd));
+			putVarint(m_data, ((chunk.range.end - chunk.range.begin) << 2) | (chunk.keyFrame ? 1 : 0) | (chunk.shown ? 2 : 0));
+			chunkEnd = chunk.range.end;
+		}
+
+		m_predictor.packetIdx = packet.packetIdx;
+		m_predictor.timestamp = packet.timestamp;
+		m_predictor.timestampStep = timestampStep;
+		m_predictor.end = packet.range.end;
+		m_packetCount++;
+		m_chunkCount += packet.chunks.size;
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void CompactBitStream::decodePackets(size_t begin, size_t end, std::vector<BitStream::Packet>& rPackets,
+									 std::vector<BitStream::Chunk>& rChunks) const
+{
+	end = std::min(end, m_packetCount);
+	if(begin >= end)
+		return;
+
+	const Checkpoint& checkpoint = m_checkpoints[begin / BlockPackets];
+	Predictor predictor = checkpoint.predictor;
+	const uint8_t* pData = m_data.data() + checkpoint.dataOffset;
+	uint64_t chunkPos = checkpoint.chunkPos;
+	for(size_t packetPos = begin - begin % BlockPackets; packetPos < end; packetPos++)
+	{
+		BitStream::Packet packet;
+		packet.packetIdx = predictor.packetIdx + 1 + getSigned(pData);
+		int64_t timestampStep = predictor.timestampStep + getSigned(pData);
+		packet.timestamp = predictor.timestamp + timestampStep;
+		packet.range.begin = predictor.end + getSigned(pData);
+		packet.range.end = packet.range.begin + getVarint(pData);
+		packet.trackIdx = uint(getVarint(pData));
+		packet.chunks.begin = uint(chunkPos);
+		packet.chunks.size = uint(getVarint(pData));
+
+		// the packets before begin in its block are only read for the predictor
+		bool keep = packetPos >= begin;
+		uint64_t chunkEnd = packet.range.begin;
+		for(uint chunkIdx = 0; chunkIdx < packet.chunks.size; chunkIdx++)
+		{
+			BitStream::Chunk chunk;
+			chunk.chunkIdx = chunkIdx;
+			chunk.packetIdx = uint(packet.packetIdx);
+			chunk.range.begin = chunkEnd + getSigned(pData);
+			uint64_t sizeAndFlags = getVarint(pData);
+			chunk.range.end = chunk.range.begin + (sizeAndFlags >> 2);
+			chunk.keyFrame = (sizeAndFlags & 1) != 0;
+			chunk.shown = (sizeAndFlags & 2) != 0;
+			chunkEnd = chunk.range.end;
+			if(keep)
+				rChunks.push_back(chunk);
+		}
+		if(keep)
+			rPackets.push_back(packet);
+
+		predictor.packetIdx = packet.packetIdx;
+		predictor.timestamp = packet.timestamp;
+		predictor.timestampStep = timestampStep;
+		predictor.end = packet.range.end;
+		chunkPos += packet.chunks.size;
+	}
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void CompactBitStream::decode(BitStream& rBitStream) const
+{
+	rBitStream.packets.clear();
+	rBitStream.chunks.clear();
+	rBitStream.packets.reserve(m_packetCount);
+	rBitStream.chunks.reserve(m_chunkCount);
+	decodePackets(0, m_packetCount, rBitStream.packets, rBitStream.chunks);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+size_t CompactBitStream::byteSize() const
+{
+	return m_data.capacity() + m_checkpoints.capacity() * sizeof(Checkpoint);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void CompactBitStream::packet(size_t packetPos, BitStream::Packet& rPacket, std::vector<BitStream::Chunk>& rChunks) const
+{
+	std::vector<BitStream::Packet> packets;
+	rChunks.clear();
+	decodePackets(packetPos, packetPos + 1, packets, rChunks);
+	if(!packets.empty())
+		rPacket = packets[0];
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// Cursor
+//-----------------------------------------------------------------------------------------------// 
+
+CompactBitStream::Cursor::Cursor(const CompactBitStream& stream, size_t firstPacket)
+	: m_stream(stream)
+	, m_nextPacket(firstPacket)
+	, m_firstPacket(firstPacket)
+	, m_firstChunk(0)
+{
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool CompactBitStream::Cursor::nextBlock()
+{
+	m_packets.clear();
+	m_chunks.clear();
+	if(m_nextPacket >= m_stream.packetCount())
+		return false;
+
+	// up to the next checkpoint, a cursor that started inside a block gets the rest of it first
+	size_t end = (m_nextPacket / BlockPackets + 1) * BlockPackets;
+	m_stream.decodePackets(m_nextPacket, end, m_packets, m_chunks);
+	m_firstPacket = m_nextPacket;
+	m_firstChunk = m_packets[0].chunks.begin;
+	m_nextPacket += m_packets.size();
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
\ No newline at end of file
@@ -0,0 +1,129 @@
+//-----------------------------------------------------------------------------------------------// 
+// CompactBitStream.h
+//-----------------------------------------------------------------------------------------------// 
+#ifndef MPX_MODEL_COMPACT_BIT_STREAM_H
+#define MPX_MODEL_COMPACT_BIT_STREAM_H
+
+#include <BitStream.h>
+#include <cstddef>
+#include <vector>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// The packets and chunks of a BitStream packed into a byte stream, for keeping the models of many
+// long files in memory. Every field is stored as the varint of its difference to what the packet
+// or chunk before it predicts: the packet begins where the previous one ended, a chunk where the
+// previous chunk of its packet ended, and the timestamps advance by the step before. A packet
+// with one chunk takes 12 to 14 bytes instead of the 80 of the flat tables.
+//
+// Every BlockPackets packets there is a checkpoint with the absolute values, so a packet is found
+// by decoding at most one block. The frame headers aren't part of it, they stay in
+// BitStream::frames.
+//-----------------------------------------------------------------------------------------------// 
+class CompactBitStream
+{
+public:
+	static const size_t BlockPackets = 64; // packets from one checkpoint to the next
+
+	CompactBitStream();
+
+	// replaces the model with the packets and chunks of bitStream
+	void encode(const BitStream& bitStream);
+
+	// adds bitStream.packets from firstPacket on, e.g. the batches of a running scan
+	void append(const BitStream& bitStream, size_t firstPacket);
+
+	// the packets and chunks, as encode() got them, rBitStream.frames is left alone
+	void decode(BitStream& rBitStream) const;
+
+	void clear();
+
+	size_t packetCount() const
+	{
+		return m_packetCount;
+	}
+
+	size_t chunkCount() const
+	{
+		return m_chunkCount;
+	}
+
+	// memory in use, without the object itself
+	size_t byteSize() const;
+
+	// A single packet by position. rChunks gets its chunks, rPacket.chunks.begin counts in all
+	// chunks of the model.
+	void packet(size_t packetPos, BitStream::Packet& rPacket, std::vector<BitStream::Chunk>& rChunks) const;
+
+	// Decodes the packets a block at a time, for passes over the whole model or a long stretch.
+	class Cursor
+	{
+	public:
+		Cursor(const CompactBitStream& stream, size_t firstPacket = 0);
+
+		// decodes the next block, false at the end
+		bool nextBlock();
+
+		// of the current block, chunks.begin of the packets counts in all chunks of the model
+		const std::vector<BitStream::Packet>& packets() const
+		{
+			return m_packets;
+		}
+
+		const BitStream::Chunk& chunk(const BitStream::Packet& packet, uint chunkIdx) const
+		{
+			return m_chunks[packet.chunks.begin - m_firstChunk + chunkIdx];
+		}
+
+		// position of packets()[0] in the model
+		size_t firstPacket() const
+		{
+			return m_firstPacket;
+		}
+
+	private:
+		const CompactBitStream& m_stream;
+		size_t m_nextPacket;
+		size_t m_firstPacket;
+		size_t m_firstChunk;
+		std::vector<BitStream::Packet> m_packets;
+		std::vector<BitStream::Chunk> m_chunks;
+	};
+
+private:
+	// what the next packet is predicted from
+	struct Predictor
+	{
+		uint64_t packetIdx;
+		uint64_t timestamp;
+		int64_t timestampStep;
+		uint64_t end;
+	};
+
+	struct Checkpoint
+	{
+		Predictor predictor; // before the first packet of the block
+		uint64_t dataOffset;
+		uint64_t chunkPos;
+	};
+
+	// appends the packets [begin, end) and their chunks, decoding starts at the checkpoint before
+	// begin
+	void decodePackets(size_t begin, size_t end, std::vector<BitStream::Packet>& rPackets,
+					   std::vector<BitStream::Chunk>& rChunks) const;
+
+	std::vector<uint8_t> m_data;
+	std::vector<Checkpoint> m_checkpoints;
+	Predictor m_predictor; // after the last packet
+	size_t m_packetCount;
+	size_t m_chunkCount;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
+
+//-----------------------------------------------------------------------------------------------// 
+
+#endif
@@ -0,0 +1,373 @@
+//-----------------------------------------------------------------------------------------------// 
+// FrameHeader.cpp
+//-----------------------------------------------------------------------------------------------// 
+
+#include <FrameHeader.h>
+#include <algorithm>
+#include <cstring>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// Big endian bit reader, reads past the end return zeros and are reported by overrun().
+//-----------------------------------------------------------------------------------------------// 
+class HeaderBits
+{
+public:
+	HeaderBits(const uint8_t* pData, size_t size) : m_pData(pData), m_size(size) {}
+
+	uint read(int bitCount)
+	{
+		uint value = 0;
+		for(int i = 0; i < bitCount; i++, m_bitPos++)
+		{
+			uint bit = 0;
+			if(m_bitPos / 8 < m_size)
+				bit = (m_pData[m_bitPos / 8] >> (7 - m_bitPos % 8)) & 1;
+			value = (value << 1) | bit;
+		}
+		return value;
+	}
+
+	bool overrun() const
+	{
+		return m_bitPos > m_size * 8;
+	}
+
+private:
+	const uint8_t* m_pData;
+	size_t m_size;
+	size_t m_bitPos = 0;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool superframeSizes(const uint8_t* pData, size_t size, std::vector<size_t>& rSizes)
+{
+	if(size == 0)
+		return false;
+
+	uint8_t marker = pData[size - 1];
+	if((marker & 0xe0) != 0xc0)
+		return false;
+
+	uint frameCount = (marker & 0x7) + 1;
+	uint byteCount = ((marker >> 3) & 0x3) + 1;
+	size_t indexSize = 2 + byteCount * frameCount;
+	if(size < indexSize || pData[size - indexSize] != marker)
+		return false;
+
+	rSizes.clear();
+	const uint8_t* pIndex = pData + size - indexSize + 1;
+	for(uint frame = 0; frame < frameCount; frame++)
+	{
+		size_t frameSize = 0;
+		for(uint byte = 0; byte < byteCount; byte++)
+			frameSize |= size_t(*pIndex++) << (byte * 8);
+		rSizes.push_back(frameSize);
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+// first byte: frame marker (2 bits), version, reserved, show existing frame, frame type, show frame
+uint8_t peekFrameFlags(const uint8_t* pData, size_t size)
+{
+	if(size == 0 || (pData[0] >> 6) != 2)
+		return FrameHeader::Corrupt;
+	if(pData[0] & 0x08)
+		return FrameHeader::ShowExisting | FrameHeader::Shown;
+
+	uint8_t flags = 0;
+	if(!(pData[0] & 0x04))
+		flags |= FrameHeader::KeyFrame;
+	if(pData[0] & 0x02)
+		flags |= FrameHeader::Shown;
+	return flags;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// FrameHeaderParser
+//-----------------------------------------------------------------------------------------------// 
+
+FrameHeaderParser::FrameHeaderParser()
+{
+	reset();
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void FrameHeaderParser::reset()
+{
+	std::fill(m_refWidth, m_refWidth + 8, 0);
+	std::fill(m_refHeight, m_refHeight + 8, 0);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool FrameHeaderParser::parseChunk(const uint8_t* pData, size_t size, uint packetIdx, uint chunkIdx,
+								   std::vector<FrameHeader>& rHeaders)
+{
+	FrameHeader header;
+	std::vector<size_t> sizes;
+	if(!superframeSizes(pData, size, sizes))
+	{
+		bool ok = parseFrame(pData, size, header);
+		header.packetIdx = packetIdx;
+		header.chunkIdx = uint16_t(chunkIdx);
+		rHeaders.push_back(header);
+		return ok;
+	}
+
+	// the frames are decoded in order, all but the last are usually hidden
+	bool ok = true;
+	size_t offset = 0;
+	for(size_t frameIdx = 0; frameIdx < sizes.size(); frameIdx++)
+	{
+		if(offset + sizes[frameIdx] > size)
+		{
+			memset(&header, 0, sizeof(header));
+			header.flags = FrameHeader::Corrupt;
+			ok = false;
+		}
+		else if(!parseFrame(pData + offset, sizes[frameIdx], header))
+		{
+			ok = false;
+		}
+		header.packetIdx = packetIdx;
+		header.chunkIdx = uint16_t(chunkIdx);
+		header.superframeIdx = uint8_t(frameIdx);
+		header.flags |= FrameHeader::InSuperframe;
+		rHeaders.push_back(header);
+
+		if(header.flags & FrameHeader::Corrupt)
+			break;
+		offset += sizes[frameIdx];
+	}
+	return ok;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool FrameHeaderParser::parseFrame(const uint8_t* pData, size_t size, FrameHeader& rHeader)
+{
+	memset(&rHeader, 0, sizeof(rHeader));
+	rHeader.size = uint(size);
+
+	HeaderBits bits(pData, size);
+	if(bits.read(2) != 2)
+	{
+		rHeader.flags = FrameHeader::Corrupt; // frame marker
+		return false;
+	}
+
+	rHeader.profile = uint8_t(bits.read(1));
+	bits.read(1); // reserved
+	if(bits.read(1))
+	{
+		rHeader.flags = FrameHeader::ShowExisting | FrameHeader::Shown;
+		rHeader.frameToShow = uint8_t(bits.read(3));
+		rHeader.width = m_refWidth[rHeader.frameToShow];
+		rHeader.height = m_refHeight[rHeader.frameToShow];
+		if(bits.overrun())
+		{
+			rHeader.flags |= FrameHeader::Corrupt;
+			return false;
+		}
+		return true;
+	}
+
+	bool keyFrame = !bits.read(1);
+	bool showFrame = bits.read(1) != 0;
+	bool errorResilient = bits.read(1) != 0;
+	rHeader.flags = uint8_t((keyFrame ? FrameHeader::KeyFrame : 0) | (showFrame ? FrameHeader::Shown : 0) |
+							(errorResilient ? FrameHeader::ErrorResilient : 0));
+
+	auto fail = [&]
+	{
+		rHeader.flags |= FrameHeader::Corrupt;
+		return false;
+	};
+	auto readFrameSize = [&]
+	{
+		rHeader.width = int(bits.read(16)) + 1;
+		rHeader.height = int(bits.read(16)) + 1;
+	};
+	auto skipDisplaySize = [&]
+	{
+		if(bits.read(1))
+			bits.read(32);
+	};
+
+	const uint SyncCode = 0x498342;
+	if(keyFrame)
+	{
+		if(bits.read(24) != SyncCode)
+			return fail();
+		if(bits.read(3) != 7) // not sRGB
+		{
+			bits.read(1); // color range
+			if(rHeader.profile == 1)
+				bits.read(3); // subsampling, extra plane
+		}
+		else if(rHeader.profile == 1)
+		{
+			bits.read(1); // extra plane
+		}
+		rHeader.refreshFrameFlags = 0xff;
+		readFrameSize();
+		skipDisplaySize();
+	}
+	else
+	{
+		bool intraOnly = showFrame ? false : bits.read(1) != 0;
+		if(intraOnly)
+			rHeader.flags |= FrameHeader::IntraOnly;
+		if(!errorResilient)
+			bits.read(2); // reset frame context
+
+		if(intraOnly)
+		{
+			if(bits.read(24) != SyncCode)
+				return fail();
+			rHeader.refreshFrameFlags = uint8_t(bits.read(8));
+			readFrameSize();
+			skipDisplaySize();
+		}
+		else
+		{
+			rHeader.refreshFrameFlags = uint8_t(bits.read(8));
+			uint refSlots[3];
+			for(int i = 0; i < 3; i++)
+			{
+				refSlots[i] = bits.read(3);
+				bits.read(1); // sign bias
+			}
+
+			bool sizeFromRef = false;
+			for(int i = 0; i < 3 && !sizeFromRef; i++)
+			{
+				if(bits.read(1))
+				{
+					rHeader.width = m_refWidth[refSlots[i]];
+					rHeader.height = m_refHeight[refSlots[i]];
+					sizeFromRef = true;
+				}
+			}
+			if(!sizeFromRef)
+				readFrameSize();
+			skipDisplaySize();
+
+			bits.read(1); // high precision mv
+			if(!bits.read(1))
+				bits.read(2); // interpolation filter
+		}
+	}
+	if(rHeader.width == 0 || rHeader.height == 0)
+		return fail(); // size from a reference frame that wasn't parsed
+
+	// error resilient frames are always frame parallel
+	bool frameParallel = errorResilient;
+	if(!errorResilient)
+	{
+		bits.read(1); // refresh frame context
+		frameParallel = bits.read(1) != 0;
+	}
+	if(frameParallel)
+		rHeader.flags |= FrameHeader::FrameParallel;
+	rHeader.frameContextIdx = uint8_t(bits.read(2));
+
+	// loop filter
+	rHeader.filterLevel = uint8_t(bits.read(6));
+	rHeader.sharpness = uint8_t(bits.read(3));
+	if(bits.read(1) && bits.read(1))
+	{
+		for(int i = 0; i < 4 + 2; i++) // ref and mode deltas
+		{
+			if(bits.read(1))
+				bits.read(7);
+		}
+	}
+
+	// quantizer
+	rHeader.baseQIndex = uint8_t(bits.read(8));
+	for(int i = 0; i < 3; i++) // y dc, uv dc and uv ac deltas
+	{
+		if(bits.read(1))
+			bits.read(5);
+	}
+
+	// segmentation
+	if(bits.read(1))
+	{
+		if(bits.read(1))
+		{
+			for(int i = 0; i < 7; i++) // tree probs
+			{
+				if(bits.read(1))
+					bits.read(8);
+			}
+			if(bits.read(1))
+			{
+				for(int i = 0; i < 3; i++) // prediction probs
+				{
+					if(bits.read(1))
+						bits.read(8);
+				}
+			}
+		}
+		if(bits.read(1))
+		{
+			bits.read(1); // abs delta
+			static const int featureBits[4] = { 8, 6, 2, 0 };
+			static const int featureSigned[4] = { 1, 1, 0, 0 };
+			for(int segment = 0; segment < 8; segment++)
+			{
+				for(int feature = 0; feature < 4; feature++)
+				{
+					if(bits.read(1))
+						bits.read(featureBits[feature] + featureSigned[feature]);
+				}
+			}
+		}
+	}
+
+	// tile columns, the range of allowed values follows from the width in superblocks
+	int sbCols = (rHeader.width + 63) / 64;
+	int minLog2 = 0;
+	while((64 << minLog2) < sbCols)
+		minLog2++;
+	int maxLog2 = 0;
+	while((sbCols >> maxLog2) >= 4)
+		maxLog2++;
+	maxLog2 = std::max(maxLog2 - 1, 0);
+
+	int log2TileColumns = minLog2;
+	while(log2TileColumns < maxLog2 && bits.read(1))
+		log2TileColumns++;
+	rHeader.log2TileColumns = uint8_t(log2TileColumns);
+
+	uint log2TileRows = bits.read(1);
+	if(log2TileRows)
+		log2TileRows += bits.read(1);
+	rHeader.log2TileRows = uint8_t(log2TileRows);
+
+	rHeader.compressedHeaderSize = uint16_t(bits.read(16));
+	if(bits.overrun() || rHeader.compressedHeaderSize == 0)
+		return fail();
+
+	for(int slot = 0; slot < 8; slot++)
+	{
+		if(rHeader.refreshFrameFlags & (1 << slot))
+		{
+			m_refWidth[slot] = rHeader.width;
+			m_refHeight[slot] = rHeader.height;
+		}
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
\ No newline at end of file
@@ -0,0 +1,101 @@
+//-----------------------------------------------------------------------------------------------// 
+// FrameHeader.h
+//-----------------------------------------------------------------------------------------------// 
+#ifndef MPX_MODEL_FRAME_HEADER_H
+#define MPX_MODEL_FRAME_HEADER_H
+
+#include <Include.h>
+#include <cstddef>
+#include <vector>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// Per-frame record from the VP9 uncompressed header, 32 bytes so a whole file fits in memory.
+// A chunk holds one frame, or several in a superframe.
+//-----------------------------------------------------------------------------------------------// 
+struct FrameHeader
+{
+	enum Flags
+	{
+		KeyFrame = 1 << 0,
+		Shown = 1 << 1, // decoding it outputs a frame
+		ShowExisting = 1 << 2, // only shows the reference frame frameToShow
+		IntraOnly = 1 << 3,
+		ErrorResilient = 1 << 4,
+		InSuperframe = 1 << 5,
+		FrameParallel = 1 << 6, // no backward adaptation, libvpx 1.3 only decodes tiles in parallel then
+		Corrupt = 1 << 7, // the header ends early or has invalid values, fields after that are 0
+	};
+
+	uint packetIdx;
+	uint size; // in bytes
+	int width;
+	int height;
+	uint16_t chunkIdx;
+	uint16_t compressedHeaderSize;
+	uint8_t superframeIdx; // position in the superframe, 0 for plain frames
+	uint8_t flags;
+	uint8_t profile;
+	uint8_t baseQIndex;
+	uint8_t filterLevel;
+	uint8_t sharpness;
+	uint8_t log2TileColumns;
+	uint8_t log2TileRows;
+	uint8_t refreshFrameFlags; // one bit per reference slot
+	uint8_t frameToShow; // reference slot of a ShowExisting frame
+	uint8_t frameContextIdx;
+	uint8_t reserved;
+
+	bool keyFrame() const
+	{
+		return (flags & KeyFrame) != 0;
+	}
+
+	bool shown() const
+	{
+		return (flags & Shown) != 0;
+	}
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+// Sizes of the frames in a superframe, false for a plain frame. The index sits at the end of
+// the chunk and starts and ends with the same marker byte.
+bool superframeSizes(const uint8_t* pData, size_t size, std::vector<size_t>& rSizes);
+
+// KeyFrame, Shown and ShowExisting from the first header byte, Corrupt without a frame marker
+uint8_t peekFrameFlags(const uint8_t* pData, size_t size);
+
+//-----------------------------------------------------------------------------------------------// 
+// Reads the uncompressed headers of a stream. Inter frames may take their size from a reference
+// frame, so the parser tracks the sizes in the reference slots and the chunks have to be parsed
+// in decode order. The fields are those read by libvpx 1.3.
+//-----------------------------------------------------------------------------------------------// 
+class FrameHeaderParser
+{
+public:
+	FrameHeaderParser();
+
+	// forget the reference frames, e.g. after a seek
+	void reset();
+
+	// Appends the headers of all frames in the chunk. Returns false if one of them is corrupt.
+	bool parseChunk(const uint8_t* pData, size_t size, uint packetIdx, uint chunkIdx,
+					std::vector<FrameHeader>& rHeaders);
+
+	// a single frame, without superframe handling
+	bool parseFrame(const uint8_t* pData, size_t size, FrameHeader& rHeader);
+
+private:
+	int m_refWidth[8];
+	int m_refHeight[8];
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
+
+//-----------------------------------------------------------------------------------------------// 
+
+#endif
@@ -0,0 +1,89 @@
+//-----------------------------------------------------------------------------------------------// 
+// FrameModeInfo.cpp
+//-----------------------------------------------------------------------------------------------// 
+
+#include <FrameModeInfo.h>
+#include <utility>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+
+static const uint8_t s_blockWidthLog2[BlockSizeCount] = { 2, 2, 3, 3, 3, 4, 4, 4, 5, 5, 5, 6, 6 };
+static const uint8_t s_blockHeightLog2[BlockSizeCount] = { 2, 3, 2, 3, 4, 3, 4, 5, 4, 5, 6, 5, 6 };
+
+int blockWidth(BlockSize size)
+{
+	return 1 << s_blockWidthLog2[size];
+}
+
+int blockHeight(BlockSize size)
+{
+	return 1 << s_blockHeightLog2[size];
+}
+
+//-----------------------------------------------------------------------------------------------// 
+// FrameModeInfo
+//-----------------------------------------------------------------------------------------------// 
+
+FrameModeInfo::FrameModeInfo(FrameModeInfo&& other)
+	: cols(other.cols)
+	, rows(other.rows)
+	, blockSizes(std::move(other.blockSizes))
+	, modes(std::move(other.modes))
+	, refFrames(std::move(other.refFrames))
+	, flags(std::move(other.flags))
+	, mvs(std::move(other.mvs))
+{
+	other.cols = other.rows = 0;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+FrameModeInfo& FrameModeInfo::operator=(FrameModeInfo&& other)
+{
+	cols = other.cols;
+	rows = other.rows;
+	blockSizes = std::move(other.blockSizes);
+	modes = std::move(other.modes);
+	refFrames = std::move(other.refFrames);
+	flags = std::move(other.flags);
+	mvs = std::move(other.mvs);
+	other.cols = other.rows = 0;
+	return *this;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void FrameModeInfo::resize(int newCols, int newRows)
+{
+	cols = newCols;
+	rows = newRows;
+	size_t count = blockCount();
+	blockSizes.resize(count);
+	modes.resize(count);
+	refFrames.resize(count);
+	flags.resize(count);
+	mvs.resize(count * 2);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+void FrameModeInfo::clear()
+{
+	resize(0, 0);
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+bool FrameModeInfo::blockOrigin(int col, int row) const
+{
+	BlockSize size = blockSize(index(col, row));
+	int cols8 = (blockWidth(size) + 7) / 8;
+	int rows8 = (blockHeight(size) + 7) / 8;
+	return col % cols8 == 0 && row % rows8 == 0;
+}
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
\ No newline at end of file
@@ -0,0 +1,142 @@
+//-----------------------------------------------------------------------------------------------// 
+// FrameModeInfo.h
+//-----------------------------------------------------------------------------------------------// 
+#ifndef MPX_MODEL_FRAME_MODE_INFO_H
+#define MPX_MODEL_FRAME_MODE_INFO_H
+
+#include <Include.h>
+#include <cstddef>
+#include <vector>
+
+namespace mpx {
+
+//-----------------------------------------------------------------------------------------------// 
+// Values as in libvpx 1.3 (BLOCK_SIZE, MB_PREDICTION_MODE, MV_REFERENCE_FRAME + 1).
+//-----------------------------------------------------------------------------------------------// 
+enum BlockSize
+{
+	Block4x4, Block4x8, Block8x4, Block8x8, Block8x16, Block16x8, Block16x16, Block16x32,
+	Block32x16, Block32x32, Block32x64, Block64x32, Block64x64, BlockSizeCount
+};
+
+enum PredictionMode
+{
+	DcPred, VPred, HPred, D45Pred, D135Pred, D117Pred, D153Pred, D207Pred, D63Pred, TmPred,
+	NearestMv, NearMv, ZeroMv, NewMv, PredictionModeCount
+};
+
+enum RefFrame
+{
+	RefNone, RefIntra, RefLast, RefGolden, RefAltRef
+};
+
+// in 1/8 pixels
+struct MotionVector
+{
+	int16_t row;
+	int16_t col;
+};
+
+// in pixels
+int blockWidth(BlockSize size);
+int blockHeight(BlockSize size);
+
+//-----------------------------------------------------------------------------------------------// 
+// Mode info of a frame per 8x8 block, as a structure of arrays with 12 bytes per block. Larger
+// blocks repeat their values in every 8x8 block they cover, blocks are aligned to their size so
+// the partitioning follows from the block sizes. Blocks smaller than 8x8 keep the mode and
+// motion vectors of their last 4x4 block.
+//-----------------------------------------------------------------------------------------------// 
+struct FrameModeInfo
+{
+	enum FlagBits
+	{
+		TxSizeMask = 0x3, // TX_4X4 .. TX_32X32
+		SkipBit = 1 << 2, // no coefficients
+		SegmentShift = 3,
+	};
+
+	int cols = 0; // in 8x8 blocks
+	int rows = 0;
+	std::vector<uint8_t> blockSizes; // BlockSize
+	std::vector<uint8_t> modes; // y mode | uv mode << 4
+	std::vector<uint8_t> refFrames; // RefFrame of the first | second predictor << 4
+	std::vector<uint8_t> flags; // FlagBits
+	std::vector<MotionVector> mvs; // two per block, the second is used with compound prediction
+
+	FrameModeInfo() {}
+	FrameModeInfo(const FrameModeInfo&) = default;
+	FrameModeInfo(FrameModeInfo&& other);
+	FrameModeInfo& operator=(const FrameModeInfo&) = default;
+	FrameModeInfo& operator=(FrameModeInfo&& other);
+
+	// keeps the memory when the size stays the same
+	void resize(int newCols, int newRows);
+	void clear();
+
+	size_t blockCount() const
+	{
+		return size_t(cols) * rows;
+	}
+
+	size_t index(int col, int row) const
+	{
+		return size_t(row) * cols + col;
+	}
+
+	BlockSize blockSize(size_t i) const
+	{
+		return BlockSize(blockSizes[i]);
+	}
+
+	PredictionMode yMode(size_t i) const
+	{
+		return PredictionMode(modes[i] & 0xf);
+	}
+
+	PredictionMode uvMode(size_t i) const
+	{
+		return PredictionMode(modes[i] >> 4);
+	}
+
+	RefFrame refFrame(size_t i, int predictor) const
+	{
+		return RefFrame((refFrames[i] >> (predictor * 4)) & 0xf);
+	}
+
+	bool inter(size_t i) const
+	{
+		return refFrame(i, 0) > RefIntra;
+	}
+
+	int txSize(size_t i) const // 4 << txSize pixels
+	{
+		return flags[i] & TxSizeMask;
+	}
+
+	bool skip(size_t i) const
+	{
+		return (flags[i] & SkipBit) != 0;
+	}
+
+	int segmentId(size_t i) const
+	{
+		return flags[i] >> SegmentShift;
+	}
+
+	MotionVector mv(size_t i, int predictor) const
+	{
+		return mvs[i * 2 + predictor];
+	}
+
+	// the 8x8 block is the top left one of its block
+	bool blockOrigin(int col, int row) const;
+};
+
+//-----------------------------------------------------------------------------------------------// 
+
+} // mpx
+
+//-----------------------------------------------------------------------------------------------// 
+
+#endif